@@ -0,0 +1,201 @@
+/**
+ *
+ * Benchmark do custo por chamada da API do motor (cruzamento.h).
+ *
+ *      Cria muitas instâncias independentes no mesmo processo e as conduz lado a lado: a cada passo do relógio virtual, injeta em cada
+ * uma as chegadas sorteadas para o passo (carros a cada 2 a 9 segundos por direção e uma ambulância a cada 60 a 179 segundos) e avança
+ * o relógio dela até o fim do passo. Mede o tempo médio de motor_criar(), motor_chegada(), motor_avancar() e motor_destruir() e o custo
+ * médio por evento processado.
+ *
+ * Uso: bench/bench_api [-i INSTANCIAS] [-d DURACAO] [-p PASSO] [-l]
+ *
+ *   -i INSTANCIAS número de instâncias simuladas (padrão 1000)
+ *   -d DURACAO    duração simulada, em segundos (padrão 3600)
+ *   -p PASSO      intervalo do relógio virtual entre duas chamadas de motor_avancar() (padrão 1)
+ *   -l            injeta as chegadas de cada passo de uma instância em um único lote (motor_chegadas()), em vez de uma chamada de
+ *                 motor_chegada() por veículo
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cruzamento.h"
+
+#define USO "Uso: %s [-i INSTANCIAS] [-d DURACAO] [-p PASSO] [-l]\n"
+
+/**
+ * @brief Próximas chegadas sorteadas de uma instância
+ *
+ */
+typedef struct{
+    Motor *motor;
+    double proximo_carro[NUM_DIRECOES];
+    double proxima_ambulancia;
+    uint64_t semente_carros[NUM_DIRECOES], semente_ambulancias;  // Um gerador por fluxo de chegadas: os sorteios não dependem do passo
+} Instancia;
+
+/**
+ * @brief Agenda uma chegada na hora ou a acumula no lote do passo
+ *
+ */
+static void injetar(Motor *motor, Chegada *lote, int *num_lote, Direcao dir, TipoVeiculo tipo, double instante){
+    if(lote == NULL){
+        motor_chegada(motor, dir, tipo, instante);
+        return;
+    }
+    lote[*num_lote].instante = instante;
+    lote[*num_lote].direcao = dir;
+    lote[*num_lote].tipo = tipo;
+    (*num_lote)++;
+}
+
+/**
+ * @brief Gerador xorshift64*, o mesmo de sortear() em cruzamento.c
+ *
+ * @return int valor uniforme em [minimo, minimo + faixa)
+ */
+static int sortear(uint64_t *semente, int minimo, int faixa){
+    *semente ^= *semente >> 12;
+    *semente ^= *semente << 25;
+    *semente ^= *semente >> 27;
+    return minimo + (int) (((*semente * 0x2545F4914F6CDD1DULL) >> 33) % (uint64_t) faixa);
+}
+
+static double agora_ns(void){
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+int main(int argc, char *argv[]){
+    Instancia *instancias;
+    EstatisticasMotor e;
+    Chegada *lote = NULL;
+    int num_instancias = 1000, opcao, i, d, processados, num_lote, capacidade_lote = 0;
+    bool em_lote = false;
+    double duracao = 3600, passo = 1, t, inicio, ns_criar, ns_chegada = 0, ns_avancar = 0, ns_destruir, espera = 0;
+    uint64_t chegadas = 0, avancos = 0, eventos = 0, travessias = 0, entradas = 0, presentes = 0;
+
+    while((opcao = getopt(argc, argv, "i:d:p:l")) != -1){
+        switch(opcao){
+        case 'i': num_instancias = atoi(optarg); break;
+        case 'd': duracao = atof(optarg); break;
+        case 'p': passo = atof(optarg); break;
+        case 'l': em_lote = true; break;
+        default:
+            fprintf(stderr, USO, argv[0]);
+            return 1;
+        }
+    }
+    if(num_instancias < 1 || duracao <= 0 || passo <= 0){
+        fprintf(stderr, USO, argv[0]);
+        return 1;
+    }
+
+    // Cada direção recebe no máximo um carro a cada 2 segundos e as ambulâncias chegam a cada 60 segundos ou mais
+    if(em_lote){
+        capacidade_lote = NUM_DIRECOES * ((int) (passo / 2) + 1) + (int) (passo / 60) + 1;
+        lote = malloc(capacidade_lote * sizeof(Chegada));
+        if(lote == NULL){
+            perror("malloc");
+            return 1;
+        }
+    }
+
+    instancias = calloc(num_instancias, sizeof(Instancia));
+    if(instancias == NULL){
+        perror("calloc");
+        return 1;
+    }
+
+    inicio = agora_ns();
+    for(i = 0; i < num_instancias; i++){
+        instancias[i].motor = motor_criar(NULL);
+        if(instancias[i].motor == NULL){
+            perror("motor_criar");
+            return 1;
+        }
+    }
+    ns_criar = agora_ns() - inicio;
+
+    for(i = 0; i < num_instancias; i++){
+        for(d = 0; d < NUM_DIRECOES; d++){
+            instancias[i].semente_carros[d] = 0x9E3779B97F4A7C15ULL * (uint64_t) (NUM_DIRECOES * i + d + 1);
+            instancias[i].proximo_carro[d] = sortear(&instancias[i].semente_carros[d], 2, 8);
+        }
+        instancias[i].semente_ambulancias = 0xBF58476D1CE4E5B9ULL * (uint64_t) (i + 1);
+        instancias[i].proxima_ambulancia = sortear(&instancias[i].semente_ambulancias, 60, 120);
+    }
+
+    for(t = passo; t <= duracao + 1e-9; t += passo){
+        // Injeção das chegadas do passo em todas as instâncias
+        inicio = agora_ns();
+        for(i = 0; i < num_instancias; i++){
+            Instancia *x = &instancias[i];
+            num_lote = 0;
+            for(d = 0; d < NUM_DIRECOES; d++){
+                while(x->proximo_carro[d] <= t){
+                    injetar(x->motor, lote, &num_lote, (Direcao) d, TIPO_CARRO, x->proximo_carro[d]);
+                    x->proximo_carro[d] += sortear(&x->semente_carros[d], 2, 8);
+                    chegadas++;
+                }
+            }
+            while(x->proxima_ambulancia <= t){
+                injetar(x->motor, lote, &num_lote, (Direcao) sortear(&x->semente_ambulancias, 0, NUM_DIRECOES), TIPO_AMBULANCIA, x->proxima_ambulancia);
+                x->proxima_ambulancia += sortear(&x->semente_ambulancias, 60, 120);
+                chegadas++;
+            }
+            if(num_lote > 0) motor_chegadas(x->motor, lote, num_lote);
+        }
+        ns_chegada += agora_ns() - inicio;
+
+        // Avanço do relógio de todas as instâncias até o fim do passo
+        inicio = agora_ns();
+        for(i = 0; i < num_instancias; i++){
+            processados = motor_avancar(instancias[i].motor, t);
+            if(processados < 0){
+                perror("motor_avancar");
+                return 1;
+            }
+            eventos += (uint64_t) processados;
+        }
+        ns_avancar += agora_ns() - inicio;
+        avancos += (uint64_t) num_instancias;
+    }
+
+    for(i = 0; i < num_instancias; i++){
+        motor_estatisticas(instancias[i].motor, &e);
+        for(d = 0; d < NUM_DIRECOES; d++){
+            travessias += e.travessias[TIPO_CARRO][d];
+            presentes += (uint64_t) (e.carros_esperando[d] + e.ambulancias_esperando[d]);
+        }
+        presentes += (uint64_t) (e.carros_no_cruzamento + e.ambulancias_no_cruzamento);
+        // A espera é somada na entrada no cruzamento: os carros ainda atravessando também entram na média
+        entradas += (uint64_t) e.carros_no_cruzamento;
+        espera += e.espera_soma[TIPO_CARRO];
+    }
+    entradas += travessias;
+
+    inicio = agora_ns();
+    for(i = 0; i < num_instancias; i++) motor_destruir(instancias[i].motor);
+    ns_destruir = agora_ns() - inicio;
+    free(instancias);
+    free(lote);
+
+    printf("instancias=%d duracao=%.0f passo=%g lote=%s\n", num_instancias, duracao, passo, em_lote ? "sim" : "nao");
+    printf("%-16s %14s %12s\n", "operacao", "chamadas", "ns/chamada");
+    printf("%-16s %14d %12.1f\n", "motor_criar", num_instancias, ns_criar / num_instancias);
+    printf("%-16s %14llu %12.1f\n", "motor_chegada", (unsigned long long) chegadas, chegadas > 0 ? ns_chegada / chegadas : 0);
+    printf("%-16s %14llu %12.1f\n", "motor_avancar", (unsigned long long) avancos, ns_avancar / avancos);
+    printf("%-16s %14llu %12.1f\n", "evento", (unsigned long long) eventos, eventos > 0 ? ns_avancar / eventos : 0);
+    printf("%-16s %14d %12.1f\n", "motor_destruir", num_instancias, ns_destruir / num_instancias);
+    printf("RESUMO travessias=%llu espera_media=%.3f eventos_por_segundo=%.0f veiculos_presentes=%llu\n", (unsigned long long) travessias,
+        entradas > 0 ? espera / entradas : 0, ns_avancar > 0 ? eventos / (ns_avancar / 1e9) : 0, (unsigned long long) presentes);
+    return 0;
+}
@@ -0,0 +1,177 @@
+/**
+ *
+ * Um dia útil de demanda no motor (cruzamento.h), hora a hora.
+ *
+ *      Cada instância recebe, em cada direção, chegadas de Poisson com a taxa variando pelo perfil de um dia útil (madrugada vazia e
+ * picos às 8h e às 18h), com média de TAXA carros por hora, e ambulâncias de Poisson. Com -P, o eixo Leste-Oeste recebe a mesma demanda
+ * em pelotões, como a saída de um cruzamento a montante. As chegadas são geradas por demanda_gerar() em lotes de um passo e injetadas
+ * com motor_chegadas(). Ao fim de cada hora simulada imprime as chegadas, travessias, espera média e fila das instâncias, e ao fim o custo
+ * médio da geração por chegada.
+ *
+ * Uso: bench/bench_demanda [-i INSTANCIAS] [-t TAXA] [-a TAXA] [-P TAMANHO] [-f NS,LO] [-s SEMENTE]
+ *
+ *   -i INSTANCIAS número de instâncias simuladas (padrão 100)
+ *   -t TAXA       carros por hora em cada direção, na média do dia (padrão 300)
+ *   -a TAXA       ambulâncias por hora em cada direção (padrão 0.5)
+ *   -P TAMANHO    carros Leste-Oeste em pelotões de TAMANHO carros, a cada INTERVALO_SATURACAO segundos
+ *   -f NS,LO      faixas das aproximações Norte-Sul e Leste-Oeste (padrão 1,1)
+ *   -s SEMENTE    semente dos geradores (padrão 1)
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cruzamento.h"
+
+#define USO "Uso: %s [-i INSTANCIAS] [-t TAXA] [-a TAXA] [-P TAMANHO] [-f NS,LO] [-s SEMENTE]\n"
+#define PASSO 60                        // Intervalo do relógio virtual entre dois lotes de chegadas
+#define CAPACIDADE_LOTE 1024
+
+// Demanda de cada hora de um dia útil em relação à média do dia
+static const double perfil_dia[24] = {
+    0.15, 0.10, 0.08, 0.08, 0.12, 0.35, 0.90, 1.60, 1.80, 1.20, 0.95, 1.00,
+    1.10, 1.05, 1.00, 1.10, 1.40, 1.90, 1.70, 1.10, 0.80, 0.60, 0.40, 0.25
+};
+
+static double agora_ns(void){
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+int main(int argc, char *argv[]){
+    Motor **motores;
+    Demanda **demandas;
+    ConfigMotor config;
+    ProcessoChegada carros, ambulancias;
+    EstatisticasMotor e;
+    Chegada lote[CAPACIDADE_LOTE];
+    int num_instancias = 100, pelotao = 0, faixas_ns = FAIXAS_NS, faixas_lo = FAIXAS_LO, opcao, i, d, h, n, hora;
+    double taxa = 300, taxa_ambulancias = 0.5, soma_perfil = 0, t, inicio, ns_gerar = 0, espera, espera_anterior = 0;
+    uint64_t semente = 1, geradas = 0, chegadas, chegadas_anterior = 0, travessias, travessias_anterior = 0, entradas, entradas_anterior = 0;
+    long fila;
+
+    while((opcao = getopt(argc, argv, "i:t:a:P:f:s:")) != -1){
+        switch(opcao){
+        case 'i': num_instancias = atoi(optarg); break;
+        case 't': taxa = atof(optarg); break;
+        case 'a': taxa_ambulancias = atof(optarg); break;
+        case 'P': pelotao = atoi(optarg); break;
+        case 'f':
+            if(sscanf(optarg, "%d,%d", &faixas_ns, &faixas_lo) != 2){
+                fprintf(stderr, USO, argv[0]);
+                return 1;
+            }
+            break;
+        case 's': semente = strtoull(optarg, NULL, 10); break;
+        default:
+            fprintf(stderr, USO, argv[0]);
+            return 1;
+        }
+    }
+    if(num_instancias < 1 || taxa < 0 || taxa_ambulancias < 0 || pelotao < 0){
+        fprintf(stderr, USO, argv[0]);
+        return 1;
+    }
+
+    motor_config_padrao(&config);
+    config.faixas[NORTE] = config.faixas[SUL] = faixas_ns;
+    config.faixas[LESTE] = config.faixas[OESTE] = faixas_lo;
+
+    // Perfil de um dia em trechos de uma hora, normalizado para a média 'taxa'
+    for(h = 0; h < 24; h++) soma_perfil += perfil_dia[h];
+    carros.tipo = PROCESSO_PERFIL;
+    carros.num_trechos = 24;
+    carros.duracao_trecho = 3600;
+    for(h = 0; h < 24; h++) carros.taxa_trecho[h] = taxa * perfil_dia[h] * 24 / soma_perfil;
+    ambulancias.tipo = PROCESSO_POISSON;
+    ambulancias.taxa = taxa_ambulancias;
+
+    motores = calloc(num_instancias, sizeof(Motor*));
+    demandas = calloc(num_instancias, sizeof(Demanda*));
+    if(motores == NULL || demandas == NULL){
+        perror("calloc");
+        return 1;
+    }
+    for(i = 0; i < num_instancias; i++){
+        motores[i] = motor_criar(&config);
+        demandas[i] = demanda_criar(semente * 1000003 + (uint64_t) i);
+        if(motores[i] == NULL || demandas[i] == NULL){
+            perror("motor_criar");
+            return 1;
+        }
+        for(d = 0; d < NUM_DIRECOES; d++){
+            if(pelotao > 0 && (d == LESTE || d == OESTE)){
+                ProcessoChegada pelotoes = carros;
+                pelotoes.tipo = PROCESSO_PELOTAO;
+                pelotoes.tamanho_pelotao = pelotao;
+                pelotoes.intervalo_pelotao = INTERVALO_SATURACAO;
+                for(h = 0; h < 24; h++) pelotoes.taxa_trecho[h] /= pelotao;
+                demanda_fluxo(demandas[i], (Direcao) d, TIPO_CARRO, &pelotoes);
+            }
+            else demanda_fluxo(demandas[i], (Direcao) d, TIPO_CARRO, &carros);
+            demanda_fluxo(demandas[i], (Direcao) d, TIPO_AMBULANCIA, &ambulancias);
+        }
+    }
+
+    printf("instancias=%d taxa=%.0f ambulancias=%g pelotao=%d faixas=%d,%d\n", num_instancias, taxa, taxa_ambulancias, pelotao,
+        faixas_ns, faixas_lo);
+    printf("%4s %10s %12s %12s %12s %12s\n", "hora", "taxa", "chegadas", "travessias", "espera_media", "fila_final");
+    for(hora = 0; hora < 24; hora++){
+        for(t = hora * 3600 + PASSO; t <= (hora + 1) * 3600; t += PASSO){
+            for(i = 0; i < num_instancias; i++){
+                // Gera e injeta as chegadas do passo em lotes de até CAPACIDADE_LOTE
+                do{
+                    inicio = agora_ns();
+                    n = demanda_gerar(demandas[i], t, lote, CAPACIDADE_LOTE);
+                    ns_gerar += agora_ns() - inicio;
+                    geradas += (uint64_t) n;
+                    if(n > 0 && motor_chegadas(motores[i], lote, n) < 0){
+                        perror("motor_chegadas");
+                        return 1;
+                    }
+                } while(n == CAPACIDADE_LOTE);
+                if(motor_avancar(motores[i], t) < 0){
+                    perror("motor_avancar");
+                    return 1;
+                }
+            }
+        }
+
+        chegadas = travessias = entradas = 0;
+        espera = 0;
+        fila = 0;
+        for(i = 0; i < num_instancias; i++){
+            motor_estatisticas(motores[i], &e);
+            for(d = 0; d < NUM_DIRECOES; d++){
+                chegadas += e.chegadas[TIPO_CARRO][d];
+                travessias += e.travessias[TIPO_CARRO][d];
+                fila += e.carros_esperando[d];
+            }
+            entradas += (uint64_t) e.carros_no_cruzamento;
+            espera += e.espera_soma[TIPO_CARRO];
+        }
+        entradas += travessias;
+        printf("%4d %10.0f %12.1f %12.1f %12.2f %12.1f\n", hora, carros.taxa_trecho[hora],
+            (double) (chegadas - chegadas_anterior) / num_instancias, (double) (travessias - travessias_anterior) / num_instancias,
+            entradas > entradas_anterior ? (espera - espera_anterior) / (entradas - entradas_anterior) : 0, (double) fila / num_instancias);
+        chegadas_anterior = chegadas;
+        travessias_anterior = travessias;
+        entradas_anterior = entradas;
+        espera_anterior = espera;
+    }
+    printf("RESUMO geradas=%llu ns_por_chegada_gerada=%.1f\n", (unsigned long long) geradas, geradas > 0 ? ns_gerar / geradas : 0);
+
+    for(i = 0; i < num_instancias; i++){
+        motor_destruir(motores[i]);
+        demanda_destruir(demandas[i]);
+    }
+    free(motores);
+    free(demandas);
+    return 0;
+}
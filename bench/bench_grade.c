@@ -0,0 +1,246 @@
+/**
+ *
+ * Uma grade de cruzamentos conduzida pelo escalonador com roubo de tarefas (cruzamento.h).
+ *
+ *      A grade tem LADO x LADO instâncias do motor, com chegadas de Poisson em cada direção. Os cruzamentos do centro (a menos de LADO/4
+ * do meio da grade, em cada eixo) recebem FATOR vezes a demanda dos demais, como o centro de uma cidade: são eles que concentram o
+ * trabalho de cada passo. A cada rodada, cada tarefa gera as chegadas de um cruzamento até o fim do passo, injeta-as com motor_chegadas()
+ * e avança a instância com motor_avancar(). Com -e, cada thread executa só o seu bloco contíguo de cruzamentos, sem roubo, e o bloco
+ * que contém o centro segura a rodada. Ao fim imprime o tempo real, a utilização das threads (tempo de CPU somado sobre threads vezes
+ * tempo real), o desequilíbrio (tempo de CPU da thread mais ocupada de cada rodada sobre a média das threads), os roubos, as
+ * travessias, que não dependem do escalonamento, e a vazão em cruzamentos-passo por segundo. Com -a as threads são fixadas nos
+ * processadores, e com -L cada cruzamento é criado na primeira rodada pela thread dona do seu bloco, e não pela main, de modo que a sua
+ * memória fica no nó NUMA dessa thread. Com -P as controladoras usam a política max-pressure, e entre as rodadas cada instância recebe
+ * de motor_jusante() as filas dos vizinhos para onde os seus carros seguem (ver informar_jusante()).
+ *
+ * Uso: bench/bench_grade [-l LADO] [-n THREADS] [-d DURACAO] [-p PASSO] [-t TAXA] [-c FATOR] [-s SEMENTE] [-e] [-a] [-L] [-P]
+ *
+ *   -l LADO       cruzamentos em cada lado da grade (padrão 32)
+ *   -n THREADS    threads do escalonador (padrão: processadores disponíveis)
+ *   -d DURACAO    tempo simulado em segundos (padrão 3600)
+ *   -p PASSO      tempo simulado por rodada em segundos (padrão 60)
+ *   -t TAXA       carros por hora em cada direção fora do centro (padrão 100)
+ *   -c FATOR      multiplicador da demanda no centro (padrão 8)
+ *   -s SEMENTE    semente dos geradores (padrão 1)
+ *   -e            particionamento estático, sem roubo de tarefas
+ *   -a            fixa cada thread do escalonador em um processador
+ *   -L            cria cada cruzamento na thread dona do seu bloco (alocação no nó NUMA local)
+ *   -P            política max-pressure, com a jusante de cada cruzamento lida dos vizinhos a cada rodada
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include "cruzamento.h"
+
+#define USO "Uso: %s [-l LADO] [-n THREADS] [-d DURACAO] [-p PASSO] [-t TAXA] [-c FATOR] [-s SEMENTE] [-e] [-a] [-L] [-P]\n"
+#define CAPACIDADE_LOTE 1024
+#define TAXA_AMBULANCIAS 0.5            // Ambulâncias por hora em cada direção
+
+/**
+ * @brief Grade simulada, seus parâmetros e o fim do passo corrente, contexto das tarefas
+ *
+ */
+typedef struct{
+    Motor **motores;
+    Demanda **demandas;
+    int lado;
+    double taxa, fator;
+    uint64_t semente;
+    PoliticaControle politica;
+    double ate;
+} Grade;
+
+// Deslocamento na grade, por Direcao de origem, até o cruzamento seguinte dos carros: x cresce de Oeste para Leste e y de Norte para Sul
+static const int passo_x[NUM_DIRECOES] = {0, 0, -1, 1}, passo_y[NUM_DIRECOES] = {1, -1, 0, 0};
+
+/**
+ * @brief Cria a instância e os fluxos de chegadas de um cruzamento. Os cruzamentos do centro, a menos de lado/4 do meio da grade nos
+ * dois eixos (distâncias em dobro para evitar frações), recebem 'fator' vezes a taxa. Uma falha deixa o ponteiro nulo.
+ *
+ */
+static void criar_cruzamento(int indice, void *contexto){
+    Grade *g = contexto;
+    ConfigMotor config;
+    ProcessoChegada carros, ambulancias;
+    int x = indice % g->lado, y = indice / g->lado, d;
+
+    motor_config_padrao(&config);
+    config.politica = g->politica;
+    carros.tipo = PROCESSO_POISSON;
+    carros.taxa = (abs(2 * x + 1 - g->lado) < g->lado / 2 && abs(2 * y + 1 - g->lado) < g->lado / 2) ? g->taxa * g->fator : g->taxa;
+    ambulancias.tipo = PROCESSO_POISSON;
+    ambulancias.taxa = TAXA_AMBULANCIAS;
+    g->motores[indice] = motor_criar(&config);
+    g->demandas[indice] = demanda_criar(g->semente * 1000003 + (uint64_t) indice);
+    if(g->demandas[indice] == NULL) return;
+    for(d = 0; d < NUM_DIRECOES; d++){
+        demanda_fluxo(g->demandas[indice], (Direcao) d, TIPO_CARRO, &carros);
+        demanda_fluxo(g->demandas[indice], (Direcao) d, TIPO_AMBULANCIA, &ambulancias);
+    }
+}
+
+/**
+ * @brief Passo de um cruzamento: gera e injeta as chegadas até 'ate' em lotes de até CAPACIDADE_LOTE e avança o relógio da instância.
+ * Uma falha do motor encerra o programa: a tarefa não tem como devolvê-la ao escalonador.
+ *
+ */
+static void passo_cruzamento(int indice, void *contexto){
+    Grade *g = contexto;
+    Chegada lote[CAPACIDADE_LOTE];
+    int n;
+
+    do{
+        n = demanda_gerar(g->demandas[indice], g->ate, lote, CAPACIDADE_LOTE);
+        if(n > 0 && motor_chegadas(g->motores[indice], lote, n) < 0){
+            perror("motor_chegadas");
+            exit(1);
+        }
+    } while(n == CAPACIDADE_LOTE);
+    if(motor_avancar(g->motores[indice], g->ate) < 0){
+        perror("motor_avancar");
+        exit(1);
+    }
+}
+
+/**
+ * @brief Informa a cada instância a fila de jusante de cada direção (motor_jusante()): os carros que esperam na mesma direção no vizinho
+ * para onde os carros dela seguem, ou 0 na borda da grade. As instâncias não trocam veículos, então a jusante é uma amostra do estado
+ * dos vizinhos: ela é lida entre as rodadas, com todas as instâncias paradas, e vale pela rodada seguinte inteira. 'filas' é o espaço
+ * para a amostra, com uma linha por cruzamento.
+ *
+ */
+static int informar_jusante(Grade *g, int (*filas)[NUM_DIRECOES]){
+    EstatisticasMotor em;
+    int jusante[NUM_DIRECOES];
+    int i, d, x, y;
+
+    for(i = 0; i < g->lado * g->lado; i++){
+        motor_estatisticas(g->motores[i], &em);
+        for(d = 0; d < NUM_DIRECOES; d++) filas[i][d] = em.carros_esperando[d];
+    }
+    for(i = 0; i < g->lado * g->lado; i++){
+        for(d = 0; d < NUM_DIRECOES; d++){
+            x = i % g->lado + passo_x[d];
+            y = i / g->lado + passo_y[d];
+            jusante[d] = (x >= 0 && x < g->lado && y >= 0 && y < g->lado) ? filas[y * g->lado + x][d] : 0;
+        }
+        if(motor_jusante(g->motores[i], jusante) < 0) return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]){
+    Grade g;
+    Escalonador *e;
+    EstatisticasMotor em;
+    EstatisticasEscalonador ee;
+    int lado = 32, num_threads = (int) sysconf(_SC_NPROCESSORS_ONLN), num_cruzamentos, opcao, i, d;
+    double duracao = 3600, passo = 60;
+    uint64_t travessias = 0;
+    bool roubo = true, fixar = false, local = false;
+    int (*filas)[NUM_DIRECOES] = NULL;      // Amostra das filas de cada cruzamento para informar_jusante() (-P)
+
+    g.taxa = 100;
+    g.fator = 8;
+    g.semente = 1;
+    g.politica = POLITICA_DEMANDA;
+    while((opcao = getopt(argc, argv, "l:n:d:p:t:c:s:eaLP")) != -1){
+        switch(opcao){
+        case 'l': lado = atoi(optarg); break;
+        case 'n': num_threads = atoi(optarg); break;
+        case 'd': duracao = atof(optarg); break;
+        case 'p': passo = atof(optarg); break;
+        case 't': g.taxa = atof(optarg); break;
+        case 'c': g.fator = atof(optarg); break;
+        case 's': g.semente = strtoull(optarg, NULL, 10); break;
+        case 'e': roubo = false; break;
+        case 'a': fixar = true; break;
+        case 'L': local = true; break;
+        case 'P': g.politica = POLITICA_PRESSAO; break;
+        default:
+            fprintf(stderr, USO, argv[0]);
+            return 1;
+        }
+    }
+    if(lado < 1 || num_threads < 1 || !(duracao > 0) || !(passo > 0) || g.taxa < 0 || g.fator < 0){
+        fprintf(stderr, USO, argv[0]);
+        return 1;
+    }
+    num_cruzamentos = lado * lado;
+    g.lado = lado;
+
+    g.motores = calloc(num_cruzamentos, sizeof(Motor*));
+    g.demandas = calloc(num_cruzamentos, sizeof(Demanda*));
+    if(g.politica == POLITICA_PRESSAO) filas = calloc(num_cruzamentos, sizeof(*filas));
+    if(g.motores == NULL || g.demandas == NULL || (g.politica == POLITICA_PRESSAO && filas == NULL)){
+        perror("calloc");
+        return 1;
+    }
+
+    e = escalonador_criar(num_threads, roubo);
+    if(e == NULL){
+        perror("escalonador_criar");
+        return 1;
+    }
+    if(fixar && escalonador_fixar(e) != 0){
+        perror("escalonador_fixar");
+        return 1;
+    }
+    // Um escalonador à parte, sem roubo, cria os cruzamentos nos mesmos blocos (e com -a nos mesmos processadores) que as threads do
+    // escalonador da simulação vão avançar, sem entrar nas estatísticas da simulação
+    if(local){
+        Escalonador *criacao = escalonador_criar(num_threads, false);
+        if(criacao == NULL || (fixar && escalonador_fixar(criacao) != 0)
+            || escalonador_executar(criacao, num_cruzamentos, criar_cruzamento, &g) != 0){
+            perror("escalonador");
+            return 1;
+        }
+        escalonador_destruir(criacao);
+    }
+    else for(i = 0; i < num_cruzamentos; i++) criar_cruzamento(i, &g);
+    for(i = 0; i < num_cruzamentos; i++){
+        if(g.motores[i] == NULL || g.demandas[i] == NULL){
+            perror("motor_criar");
+            return 1;
+        }
+    }
+    for(g.ate = passo; g.ate <= duracao; g.ate += passo){
+        if(filas != NULL && informar_jusante(&g, filas) < 0){
+            perror("motor_jusante");
+            return 1;
+        }
+        if(escalonador_executar(e, num_cruzamentos, passo_cruzamento, &g) != 0){
+            perror("escalonador_executar");
+            return 1;
+        }
+    }
+    escalonador_estatisticas(e, &ee);
+
+    for(i = 0; i < num_cruzamentos; i++){
+        motor_estatisticas(g.motores[i], &em);
+        for(d = 0; d < NUM_DIRECOES; d++) travessias += em.travessias[TIPO_CARRO][d] + em.travessias[TIPO_AMBULANCIA][d];
+    }
+    printf("RESUMO cruzamentos=%d politica=%s threads=%d roubo=%s afinidade=%s local=%s rodadas=%llu segundos=%.3f passos_por_s=%.0f "
+        "utilizacao=%.2f desequilibrio=%.2f roubos=%llu travessias=%llu\n", num_cruzamentos,
+        g.politica == POLITICA_PRESSAO ? "pressao" : "demanda", num_threads, roubo ? "sim" : "nao",
+        fixar ? "sim" : "nao", local ? "sim" : "nao", (unsigned long long) ee.rodadas, ee.segundos,
+        ee.segundos > 0 ? ee.tarefas / ee.segundos : 0,
+        ee.segundos > 0 ? ee.ocupado / (num_threads * ee.segundos) : 0,
+        ee.ocupado > 0 ? ee.ocupado_maximo / (ee.ocupado / num_threads) : 0, (unsigned long long) ee.roubos,
+        (unsigned long long) travessias);
+
+    escalonador_destruir(e);
+    for(i = 0; i < num_cruzamentos; i++){
+        motor_destruir(g.motores[i]);
+        demanda_destruir(g.demandas[i]);
+    }
+    free(g.motores);
+    free(g.demandas);
+    free(filas);
+    return 0;
+}
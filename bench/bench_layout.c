@@ -0,0 +1,290 @@
+/**
+ *
+ * Layout de Cruzamento (cruzamento_simulador.h) contra o layout anterior à separação em regiões, e disputa de linhas de cache entre as
+ * threads de um corredor de cruzamentos.
+ *
+ *      As duas structs saem da mesma lista de campos, CAMPOS_CRUZAMENTO: CruzamentoAntigo declara os campos na ordem da lista, sem
+ * alinhamento, como eram antes da separação; o atual é a própria Cruzamento do simulador. Para cada layout o programa imprime, por região
+ * (o lock e o estado dos veículos, as filas por faixa, o estado da controladora e os campos fixos), a extensão que os campos ocupam e as
+ * linhas de cache que ela toca, e conta as linhas em que regiões diferentes se misturam.
+ *
+ *      Em seguida, em cada cruzamento de um vetor, threads "veiculo" adquirem 'lock', atualizam as filas e sinalizam 'pode_cruzar', como
+ * uma chegada, e threads "controladora" escrevem os prazos da sua região, como uma verificação do verde. Por padrão a controladora também
+ * adquire 'lock', e as duas disputam o lock; com -s ela escreve sem o lock, e a única disputa que resta entre elas é a das linhas de cache
+ * que as duas regiões dividem, o que isola o efeito da separação dentro de uma mesma struct. A mesma carga roda nos dois layouts, um após o
+ * outro, e cada um tem a sua linha RESUMO.
+ *
+ * Uso: bench/bench_layout [-c CRUZAMENTOS] [-v THREADS] [-k THREADS] [-s] [-t SEGUNDOS]
+ *
+ *   -c CRUZAMENTOS cruzamentos vizinhos no vetor (padrão 2)
+ *   -v THREADS     threads "veiculo" por cruzamento (padrão 2)
+ *   -k THREADS     threads "controladora" por cruzamento (padrão 1; no máximo 1 com -s)
+ *   -s             controladora escreve a sua região sem adquirir 'lock'
+ *   -t SEGUNDOS    duração da medição de cada layout (padrão 1)
+ *
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cruzamento.h"
+#include "cruzamento_simulador.h"
+
+#define USO "Uso: %s [-c CRUZAMENTOS] [-v THREADS] [-k THREADS] [-s] [-t SEGUNDOS]\n"
+#define MAX_CRUZAMENTOS_BENCH 64
+#define MAX_THREADS_BENCH 1024
+#define MAX_LINHAS_BENCH 64                 // Linhas de cache de um cruzamento que o mapa de regiões comporta
+
+/**
+ * @brief Os campos de Cruzamento na ordem de CAMPOS_CRUZAMENTO, sem alinhamento: o layout anterior à separação em regiões
+ *
+ */
+typedef struct{
+    CAMPOS_CRUZAMENTO(DECLARAR_CAMPO, DECLARAR_CAMPO, DECLARAR_CAMPO, DECLARAR_CAMPO)
+} CruzamentoAntigo;
+
+_Static_assert(sizeof(CruzamentoAntigo) / TAMANHO_LINHA_CACHE < MAX_LINHAS_BENCH, "CruzamentoAntigo maior que o mapa de linhas");
+_Static_assert(sizeof(Cruzamento) / TAMANHO_LINHA_CACHE < MAX_LINHAS_BENCH, "Cruzamento maior que o mapa de linhas");
+
+typedef enum{
+    REGIAO_VEICULOS,
+    REGIAO_FAIXAS,
+    REGIAO_CONTROLADORA,
+    REGIAO_FIXOS,
+    NUM_REGIOES
+} Regiao;
+
+const char *const nome_regiao[NUM_REGIOES] = {"veiculos", "faixas", "controladora", "fixos"};
+
+/**
+ * @brief Layout medido: a extensão de cada região (do primeiro byte do seu primeiro campo ao último byte do seu último campo), os bytes
+ * dos seus campos e as regiões que tocam cada linha de cache de um cruzamento (um bit por região)
+ *
+ */
+typedef struct{
+    const char *nome;
+    size_t tamanho;
+    size_t inicio[NUM_REGIOES], fim[NUM_REGIOES], bytes[NUM_REGIOES];
+    unsigned regioes_linha[MAX_LINHAS_BENCH];
+} Layout;
+
+/**
+ * @brief Acrescenta ao layout um campo da região 'r', com o deslocamento e o tamanho dados
+ *
+ */
+void marcar_campo(Layout *l, Regiao r, size_t deslocamento, size_t tamanho){
+    size_t linha;
+
+    if(l->bytes[r] == 0 || deslocamento < l->inicio[r]) l->inicio[r] = deslocamento;
+    if(deslocamento + tamanho > l->fim[r]) l->fim[r] = deslocamento + tamanho;
+    l->bytes[r] += tamanho;
+    for(linha = deslocamento / TAMANHO_LINHA_CACHE; linha <= (deslocamento + tamanho - 1) / TAMANHO_LINHA_CACHE; linha++){
+        l->regioes_linha[linha] |= 1u << r;
+    }
+}
+
+// Marcação de cada campo da lista na sua região, na struct STRUCT_MEDIDA (definida antes de expandir CAMPOS_CRUZAMENTO)
+#define MARCAR(r, nome) marcar_campo(l, r, offsetof(STRUCT_MEDIDA, nome), sizeof(((STRUCT_MEDIDA *) 0)->nome));
+#define MARCAR_VEICULOS(tipo, nome, dimensao) MARCAR(REGIAO_VEICULOS, nome)
+#define MARCAR_FAIXAS(tipo, nome, dimensao) MARCAR(REGIAO_FAIXAS, nome)
+#define MARCAR_CONTROLADORA(tipo, nome, dimensao) MARCAR(REGIAO_CONTROLADORA, nome)
+#define MARCAR_FIXO(tipo, nome, dimensao) MARCAR(REGIAO_FIXOS, nome)
+
+void medir_antigo(Layout *l){
+    memset(l, 0, sizeof(*l));
+    l->nome = "antigo";
+    l->tamanho = sizeof(CruzamentoAntigo);
+#define STRUCT_MEDIDA CruzamentoAntigo
+    CAMPOS_CRUZAMENTO(MARCAR_VEICULOS, MARCAR_FAIXAS, MARCAR_CONTROLADORA, MARCAR_FIXO)
+#undef STRUCT_MEDIDA
+}
+
+void medir_atual(Layout *l){
+    memset(l, 0, sizeof(*l));
+    l->nome = "atual";
+    l->tamanho = sizeof(Cruzamento);
+#define STRUCT_MEDIDA Cruzamento
+    CAMPOS_CRUZAMENTO(MARCAR_VEICULOS, MARCAR_FAIXAS, MARCAR_CONTROLADORA, MARCAR_FIXO)
+#undef STRUCT_MEDIDA
+}
+
+/**
+ * @brief Linhas de um cruzamento em que campos de mais de uma região se misturam
+ *
+ */
+int linhas_mistas(const Layout *l){
+    size_t linha;
+    int mistas = 0;
+
+    for(linha = 0; linha < (l->tamanho + TAMANHO_LINHA_CACHE - 1) / TAMANHO_LINHA_CACHE; linha++){
+        if(l->regioes_linha[linha] & (l->regioes_linha[linha] - 1)) mistas++;
+    }
+    return mistas;
+}
+
+void imprimir_layout(const Layout *l){
+    int r;
+
+    printf("layout %s: %zu bytes\n", l->nome, l->tamanho);
+    printf("  %-14s %8s %8s %8s %7s\n", "regiao", "inicio", "fim", "bytes", "linhas");
+    for(r = 0; r < NUM_REGIOES; r++){
+        printf("  %-14s %8zu %8zu %8zu %7zu\n", nome_regiao[r], l->inicio[r], l->fim[r], l->bytes[r],
+            (l->fim[r] - 1) / TAMANHO_LINHA_CACHE - l->inicio[r] / TAMANHO_LINHA_CACHE + 1);
+    }
+}
+
+CruzamentoAntigo antigos[MAX_CRUZAMENTOS_BENCH];
+Cruzamento atuais[MAX_CRUZAMENTOS_BENCH];
+atomic_bool parar = false;
+bool controladora_sem_lock = false;
+
+/**
+ * @brief Papel, cruzamento e layout de uma thread, e as operações que ela completou (em uma linha própria, para não medir a disputa entre
+ * os contadores das threads)
+ *
+ */
+typedef struct{
+    _Alignas(TAMANHO_LINHA_CACHE) int cruzamento, direcao;
+    bool atual;
+    uint64_t operacoes;
+} ArgsBench;
+
+// Laços das threads, iguais para os dois layouts a menos do vetor de cruzamentos. Sem o lock, a barreira de compilador garante que cada
+// volta escreve os prazos na memória, como as voltas com o lock
+#define LACO_VEICULO(c, a) \
+    while(!atomic_load_explicit(&parar, memory_order_relaxed)){ \
+        pthread_mutex_lock(&(c)->lock); \
+        (c)->carros_esperando[(a)->direcao]++; \
+        (c)->fila_faixa[FAIXA((a)->direcao, 0)]++; \
+        (c)->carros_no_cruzamento = (c)->carros_esperando[(a)->direcao] & 1; \
+        pthread_cond_signal(&(c)->pode_cruzar); \
+        pthread_mutex_unlock(&(c)->lock); \
+        (a)->operacoes++; \
+    }
+#define LACO_CONTROLADORA(c, a) \
+    while(!atomic_load_explicit(&parar, memory_order_relaxed)){ \
+        if(!controladora_sem_lock) pthread_mutex_lock(&(c)->lock); \
+        (c)->instante_controle = (c)->prazo_controlador; \
+        (c)->prazo_controlador += 1; \
+        (c)->prazo_admissao = (c)->prazo_controlador; \
+        if(!controladora_sem_lock) pthread_mutex_unlock(&(c)->lock); \
+        else atomic_signal_fence(memory_order_seq_cst); \
+        (a)->operacoes++; \
+    }
+
+void *veiculo(void *arg){
+    ArgsBench *a = arg;
+
+    if(a->atual){ LACO_VEICULO(&atuais[a->cruzamento], a) }
+    else{ LACO_VEICULO(&antigos[a->cruzamento], a) }
+    return NULL;
+}
+
+void *controladora(void *arg){
+    ArgsBench *a = arg;
+
+    if(a->atual){ LACO_CONTROLADORA(&atuais[a->cruzamento], a) }
+    else{ LACO_CONTROLADORA(&antigos[a->cruzamento], a) }
+    return NULL;
+}
+
+/**
+ * @brief Roda a carga em um layout por 'segundos' e imprime a sua linha RESUMO
+ *
+ * @return int 0 em caso de sucesso, -1 se uma thread não pôde ser criada
+ */
+int medir_carga(const Layout *l, bool atual, int num_cruzamentos, int por_veiculo, int por_controladora, double segundos){
+    static pthread_t threads[MAX_THREADS_BENCH];
+    static ArgsBench args[MAX_THREADS_BENCH];
+    uint64_t operacoes_veiculo = 0, operacoes_controladora = 0;
+    int k, i, n = 0, resultado = 0;
+    struct timespec espera;
+
+    for(k = 0; k < num_cruzamentos; k++){
+        pthread_mutex_init(atual ? &atuais[k].lock : &antigos[k].lock, NULL);
+        pthread_cond_init(atual ? &atuais[k].pode_cruzar : &antigos[k].pode_cruzar, NULL);
+    }
+    atomic_store(&parar, false);
+    for(k = 0; k < num_cruzamentos && resultado == 0; k++){
+        for(i = 0; i < por_veiculo + por_controladora; i++, n++){
+            args[n].cruzamento = k;
+            args[n].direcao = i % NUM_DIRECOES;
+            args[n].atual = atual;
+            args[n].operacoes = 0;
+            if(pthread_create(&threads[n], NULL, i < por_veiculo ? veiculo : controladora, &args[n]) != 0){
+                fprintf(stderr, "pthread_create falhou na thread %d\n", n);
+                resultado = -1;
+                break;
+            }
+        }
+    }
+    if(resultado == 0){
+        espera.tv_sec = (time_t) segundos;
+        espera.tv_nsec = (long) ((segundos - (time_t) segundos) * 1e9);
+        nanosleep(&espera, NULL);
+    }
+    atomic_store(&parar, true);
+    for(i = 0; i < n; i++){
+        pthread_join(threads[i], NULL);
+        if(i % (por_veiculo + por_controladora) < por_veiculo) operacoes_veiculo += args[i].operacoes;
+        else operacoes_controladora += args[i].operacoes;
+    }
+    if(resultado < 0) return -1;
+
+    printf("RESUMO layout=%s tamanho=%zu linhas=%zu linhas_mistas=%d vizinhos_dividem_linha=%s controladora_com_lock=%s cruzamentos=%d "
+        "threads=%d veiculo_por_s=%.0f controladora_por_s=%.0f por_thread_por_s=%.0f\n", l->nome, l->tamanho,
+        (l->tamanho + TAMANHO_LINHA_CACHE - 1) / TAMANHO_LINHA_CACHE, linhas_mistas(l), l->tamanho % TAMANHO_LINHA_CACHE ? "sim" : "nao",
+        controladora_sem_lock ? "nao" : "sim", num_cruzamentos, n, operacoes_veiculo / segundos, operacoes_controladora / segundos,
+        n > 0 ? (operacoes_veiculo + operacoes_controladora) / segundos / n : 0);
+    return 0;
+}
+
+int main(int argc, char *argv[]){
+    int num_cruzamentos = 2, por_veiculo = 2, por_controladora = 1, opcao, k;
+    double segundos = 1;
+    Layout antigo, atual;
+
+    while((opcao = getopt(argc, argv, "c:v:k:st:")) != -1){
+        switch(opcao){
+        case 'c': num_cruzamentos = atoi(optarg); break;
+        case 'v': por_veiculo = atoi(optarg); break;
+        case 'k': por_controladora = atoi(optarg); break;
+        case 's': controladora_sem_lock = true; break;
+        case 't': segundos = atof(optarg); break;
+        default:
+            fprintf(stderr, USO, argv[0]);
+            return 1;
+        }
+    }
+    if(num_cruzamentos < 1 || num_cruzamentos > MAX_CRUZAMENTOS_BENCH || por_veiculo < 0 || por_controladora < 0
+        || (controladora_sem_lock && por_controladora > 1) || num_cruzamentos * (por_veiculo + por_controladora) > MAX_THREADS_BENCH
+        || !(segundos > 0)){
+        fprintf(stderr, USO, argv[0]);
+        return 1;
+    }
+
+    medir_antigo(&antigo);
+    medir_atual(&atual);
+    imprimir_layout(&antigo);
+    imprimir_layout(&atual);
+
+    // O mapa de regiões supõe que cada cruzamento do vetor começa em uma linha própria, o que o layout atual garante
+    for(k = 0; k < num_cruzamentos; k++){
+        if((uintptr_t) &atuais[k] % TAMANHO_LINHA_CACHE != 0){
+            fprintf(stderr, "cruzamento %d do layout atual fora do inicio de uma linha de cache\n", k);
+            return 1;
+        }
+    }
+
+    if(medir_carga(&antigo, false, num_cruzamentos, por_veiculo, por_controladora, segundos) < 0) return 1;
+    if(medir_carga(&atual, true, num_cruzamentos, por_veiculo, por_controladora, segundos) < 0) return 1;
+    return 0;
+}
@@ -0,0 +1,79 @@
+#!/bin/sh
+# Compara configurações da controladora do cruzamento.
+#
+# Cada configuração (um conjunto de opções de linha de comando) é executada com as mesmas sementes, em paralelo e com o relógio
+# acelerado, e a linha RESUMO impressa ao fim de cada execução é agregada pela média entre as sementes.
+#
+# Uso: bench/comparar.sh [-n SEMENTES] [-d DURACAO] [-e ESCALA] [-b EXECUTAVEL] -- "OPCOES A" "OPCOES B" ...
+#
+#   -n SEMENTES   número de sementes por configuração (padrão 5)
+#   -d DURACAO    duração simulada de cada execução, em segundos (padrão 600)
+#   -e ESCALA     segundos simulados por segundo real (padrão 10)
+#   -b EXECUTAVEL simulador a executar (padrão ./cruzamento)
+#
+# Exemplo: bench/comparar.sh -- "--verde formula" "--verde vazao"
+
+sementes=5
+duracao=600
+escala=10
+executavel=./cruzamento
+
+while getopts n:d:e:b: opcao; do
+    case $opcao in
+        n) sementes=$OPTARG ;;
+        d) duracao=$OPTARG ;;
+        e) escala=$OPTARG ;;
+        b) executavel=$OPTARG ;;
+        *) sed -n '7,12p' "$0" | cut -c3-; exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+
+if [ $# -eq 0 ] || [ ! -x "$executavel" ]; then
+    sed -n '7,12p' "$0" | cut -c3-
+    exit 1
+fi
+
+saida=$(mktemp -d)
+trap 'rm -rf "$saida"' EXIT
+
+# Dispara todas as execuções de uma vez: cada uma ocupa poucos núcleos e passa a maior parte do tempo dormindo
+c=0
+for opcoes in "$@"; do
+    c=$((c + 1))
+    s=1
+    while [ $s -le "$sementes" ]; do
+        # shellcheck disable=SC2086
+        "$executavel" $opcoes --semente $s --duracao "$duracao" --escala "$escala" 2>&1 | grep '^RESUMO' > "$saida/$c.$s" &
+        s=$((s + 1))
+    done
+done
+wait
+
+# As colunas são as chaves numéricas da linha RESUMO, na ordem em que aparecem; chaves textuais (politica, verde, ...) identificam a
+# configuração e não entram na média
+c=0
+for opcoes in "$@"; do
+    c=$((c + 1))
+    cat "$saida/$c".* | awk -v nome="${opcoes:-(padrao)}" -v cabecalho=$((c == 1)) '
+        {
+            for(i = 2; i <= NF; i++){
+                split($i, par, "=")
+                if(par[2] !~ /^-?[0-9.]+$/) continue
+                if(!(par[1] in soma)) chaves[++num_chaves] = par[1]
+                soma[par[1]] += par[2]
+            }
+            n++
+        }
+        END {
+            if(cabecalho){
+                printf "%-32s", "configuracao"
+                for(k = 1; k <= num_chaves; k++) printf " %*s", length(chaves[k]) < 10 ? 10 : length(chaves[k]), chaves[k]
+                printf "\n"
+            }
+            if(n == 0){ printf "%-32s sem resultados\n", nome; exit }
+            printf "%-32s", nome
+            for(k = 1; k <= num_chaves; k++) printf " %*.3f", length(chaves[k]) < 10 ? 10 : length(chaves[k]), soma[chaves[k]] / n
+            printf "\n"
+        }'
+done
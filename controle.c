@@ -0,0 +1,155 @@
+/**
+ *
+ * Regras de decisão da controladora (ver cruzamento.h).
+ *
+ *      São as partes da controladora que não dependem de como o estado é guardado nem de como o tempo passa: quem pode entrar, em que
+ * faixa, qual eixo abrir, por quanto tempo e quando encerrar o verde. O simulador com threads (fluxo_trafego() em cruzamento.c) e o
+ * motor (controlar() em motor.c) leem o seu estado, chamam estas funções e aplicam o resultado cada um à sua maneira, de modo que uma
+ * mudança na regra vale para os dois. Nenhuma função guarda estado nem lê o relógio.
+ *
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include <stdbool.h>
+
+#include "cruzamento.h"
+
+const char *const nome_direcao[NUM_DIRECOES] = {"Norte", "Sul", "Leste", "Oeste"};
+const char *const nome_estado[4] = {"FLUXO_NS", "FLUXO_LO", "AMBULANCIA_NS", "AMBULANCIA_LO"};
+
+EstadoFluxo controle_eixo(Direcao dir){
+    return (dir == NORTE || dir == SUL) ? FLUXO_NS : FLUXO_LO;
+}
+
+bool controle_pode_passar(bool modo_emergencia, Direcao dir, EstadoFluxo estado, TipoVeiculo tipo){
+    // Se está liberado para ambulâncias, apenas ambulâncias podem sequer considerar passar
+    if((estado == AMBULANCIA_NS || estado == AMBULANCIA_LO) && tipo != TIPO_AMBULANCIA) return false;
+
+    // Se uma emergência geral foi declarada, barra os carros
+    if(modo_emergencia && tipo == TIPO_CARRO) return false;
+
+    // Verificação de fluxo e direção para quem sobrou
+    if((dir == NORTE || dir == SUL) && (estado == FLUXO_NS || estado == AMBULANCIA_NS)) return true;
+    if((dir == LESTE || dir == OESTE) && (estado == FLUXO_LO || estado == AMBULANCIA_LO)) return true;
+    return false;
+}
+
+int controle_escolher_faixa(const int *fila_faixa, const int *faixas, Direcao dir){
+    const int *fila = &fila_faixa[FAIXA(dir, 0)];
+    int f, escolhida = 0;
+
+    for(f = 1; f < faixas[dir]; f++){
+        if(fila[f] < fila[escolhida]) escolhida = f;
+    }
+    return escolhida;
+}
+
+int controle_demanda_faixas(const int *fila_faixa, const int *faixas, EstadoFluxo fluxo){
+    Direcao primeira = (fluxo == FLUXO_NS) ? NORTE : LESTE, segunda = (fluxo == FLUXO_NS) ? SUL : OESTE;
+    const int *fila;
+    int f, critica = 0;
+
+    // Percorre só o trecho contíguo de fila_faixa das duas direções do eixo
+    fila = &fila_faixa[FAIXA(primeira, 0)];
+    for(f = 0; f < faixas[primeira]; f++) if(fila[f] > critica) critica = fila[f];
+    fila = &fila_faixa[FAIXA(segunda, 0)];
+    for(f = 0; f < faixas[segunda]; f++) if(fila[f] > critica) critica = fila[f];
+    return critica * (faixas[primeira] + faixas[segunda]);
+}
+
+bool controle_espera_estourando(double espera_maxima, double espera){
+    return espera_maxima > 0 && espera >= espera_maxima - FOLGA_ESPERA - 0.5;
+}
+
+EstadoFluxo controle_escolher_eixo(double criterio_ns, double criterio_lo, double espera_ns, double espera_lo, double espera_maxima,
+    bool *intervencao){
+    EstadoFluxo escolha_politica, proximo_estado;
+
+    // Abre o eixo de maior critério; em caso de empate, o eixo cujo carro mais antigo espera há mais tempo (em vez de favorecer sempre o
+    // Norte-Sul). Um eixo prestes a estourar a espera máxima tem precedência sobre a política
+    if(criterio_ns != criterio_lo) escolha_politica = (criterio_ns > criterio_lo) ? FLUXO_NS : FLUXO_LO;
+    else escolha_politica = (espera_ns >= espera_lo) ? FLUXO_NS : FLUXO_LO;
+
+    if(controle_espera_estourando(espera_maxima, espera_ns) || controle_espera_estourando(espera_maxima, espera_lo)){
+        proximo_estado = (espera_ns >= espera_lo) ? FLUXO_NS : FLUXO_LO;
+    }
+    else proximo_estado = escolha_politica;
+    *intervencao = proximo_estado != escolha_politica;
+    return proximo_estado;
+}
+
+int controle_tempo_verde(ModeloVerde modelo, double vazao, int num_carros){
+    float tempo_calculado;
+    int tempo_final;
+
+    if(modelo == VERDE_VAZAO) tempo_calculado = num_carros / vazao;
+    else if(num_carros > 0) tempo_calculado = T_BASE + ((num_carros - 1) * FATOR_CARRO);
+    else tempo_calculado = T_BASE;
+
+    tempo_final = (int) tempo_calculado;
+    if(modelo == VERDE_VAZAO && tempo_final < tempo_calculado) tempo_final++;
+
+    // Aplica os limites de tempo mínimo e máximo para garantir fluidez e prevenir starvation
+    if(tempo_final > T_MAXIMO) tempo_final = T_MAXIMO;
+    else if (tempo_final < T_MINIMO) tempo_final = T_MINIMO;
+    return tempo_final;
+}
+
+bool controle_espera_estourou(double espera_maxima, double decorrido, bool fila_vazia, double espera_aberta, double espera_oposta){
+    // Com a vazão limitada pelo intervalo de saturação os dois eixos podem estourar ao mesmo tempo, e encerrar cada verde logo após
+    // abri-lo faria a controladora alternar sem escoar ninguém: por isso T_MINIMO e a comparação com o mais antigo do eixo aberto
+    return !fila_vazia && decorrido >= T_MINIMO && controle_espera_estourando(espera_maxima, espera_oposta) && espera_oposta > espera_aberta;
+}
+
+double controle_pressao(int montante, int jusante, double vazao){
+    return (montante - jusante) * vazao;
+}
+
+bool controle_pressao_superada(PoliticaControle politica, double decorrido, bool fila_vazia, bool espera_estourou, double pressao_aberta,
+    double pressao_oposta){
+    return politica == POLITICA_PRESSAO && !fila_vazia && !espera_estourou && decorrido >= T_MINIMO && pressao_oposta > pressao_aberta;
+}
+
+double controle_vazao(double vazao, int entradas, double util, int residual){
+    double amostra;
+
+    if(entradas == 0 || (residual == 0 && entradas < MIN_ENTRADAS_VAZAO)) return vazao;
+    amostra = entradas / (util > 1 ? util : 1);
+    return (1 - ALFA_VAZAO) * vazao + ALFA_VAZAO * amostra;
+}
+
+EstadoFluxo controle_eixo_ambulancias(const int *ambulancias_esperando){
+    int demanda_amb_ns = ambulancias_esperando[NORTE] + ambulancias_esperando[SUL];
+    int demanda_amb_lo = ambulancias_esperando[LESTE] + ambulancias_esperando[OESTE];
+
+    return (demanda_amb_ns >= demanda_amb_lo) ? AMBULANCIA_NS : AMBULANCIA_LO;
+}
+
+bool controle_alternar_ambulancias(EstadoFluxo estado, const int *ambulancias_esperando, int ambulancias_no_cruzamento){
+    int demanda_amb_ns = ambulancias_esperando[NORTE] + ambulancias_esperando[SUL];
+    int demanda_amb_lo = ambulancias_esperando[LESTE] + ambulancias_esperando[OESTE];
+
+    return ambulancias_no_cruzamento == 0 && ((estado == AMBULANCIA_NS && demanda_amb_ns == 0 && demanda_amb_lo > 0) ||
+                                              (estado == AMBULANCIA_LO && demanda_amb_lo == 0 && demanda_amb_ns > 0));
+}
+
+void controle_liberar_faixas(bool *faixa_liberada, const double *proxima_entrada, double instante, double fim_verde, double *prazo_admissao,
+    void (*admitir)(void *contexto, int faixa), void *contexto){
+    int f;
+
+    // Percorre o vetor inteiro de faixas, sem separar por direção: as posições sem faixa em uso ficam sempre liberadas. 'admitir' pode
+    // bloquear de novo a faixa e antecipar *prazo_admissao, então ambos são relidos a cada faixa
+    *prazo_admissao = fim_verde;
+    for(f = 0; f < NUM_DIRECOES * MAX_FAIXAS; f++){
+        if(faixa_liberada[f]) continue;
+        if(proxima_entrada[f] <= instante + 1e-6){
+            faixa_liberada[f] = true;
+            admitir(contexto, f);
+        }
+        else if(proxima_entrada[f] < *prazo_admissao) *prazo_admissao = proxima_entrada[f];
+    }
+}
@@ -1,515 +1,3011 @@
-/**
- * 
- * Descrição do problema resolvido pelo presente código:
- * 
- *      Em um determinado cruzamento de quatro vias, carros e ambulâncias chegam
- * de diferentes direções (Norte, Sul, Leste e Oeste) e precisam cruzar com segurança.
- * O objetivo é gerenciar o fluxo de tráfego para evitar colisões (condição de corrida)
- * e também evitar starvation (carros de uma via nunca conseguem passar). Para a
- * definição de passagem, apenas carros de direções compatíveis (como Norte e Sul em
- * linha reta) podem cruzar simultaneamente, e carros de direções conflitantes (como
- * Norte e Leste) não podem estar no cruzamento ao mesmo tempo. Além disso, as
- * ambulâncias possuem prioridade máxima, ou seja, quando uma ambulância chega,
- * o sistema precisa:
- *      (a) fechar todas as outras vias de forma segura;
- *      (b) garantir que o cruzamento esteja vazio;
- *      (c) permitir a passagem da(s) ambulância(s);
- *      (d) retornar ao funcionamento normal;
- * 
- * @version 0.1
- * @date 2025-10-17
- * 
- * @copyright Copyright (c) 2025
- * 
- */
-
-#include <pthread.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <unistd.h>
-#include <stdbool.h>
-#include <time.h>
-
-
-#define T_MINIMO 5                      // Tempo mínimo que um fluxo fica aberto
-#define T_MAXIMO 20                     // Tempo máximo que um fluxo fica aberto
-
-// Parâmetros para a fórmula do cálculo de tempo que cada fluxo fica aberto
-#define T_BASE 1.8
-#define FATOR_CARRO 2.2
-
-// Número de Carros em cada direção
-#define CARROS_NORTE 15
-#define CARROS_SUL 3
-#define CARROS_LESTE 8
-#define CARROS_OESTE 8
-#define TOTAL_CARROS (CARROS_NORTE + CARROS_SUL + CARROS_LESTE + CARROS_OESTE)
-
-// Número de Ambulâncias em cada direção
-#define AMBULANCIA_NORTE 2
-#define AMBULANCIA_SUL 1
-#define AMBULANCIA_LESTE 3
-#define AMBULANCIA_OESTE 1
-#define TOTAL_AMBULANCIAS (AMBULANCIA_NORTE + AMBULANCIA_SUL + AMBULANCIA_LESTE + AMBULANCIA_OESTE)
-
-#define TOTAL_VEICULOS (TOTAL_CARROS + TOTAL_AMBULANCIAS)
-
-/**
- * @brief Direções dos veículos
- * 
- */
-typedef enum Direcao { NORTE, SUL, LESTE, OESTE, NUM_DIRECOES } Direcao;
-
-const char* nome_direcao[] = {"Norte", "Sul", "Leste", "Oeste"};
-
-/**
- * @brief Struct para definir qual fluxo de carros/ambulâncias (Norte-Sul ou Leste-Oeste) está passando no cruzamento no momento
- * 
- */
-typedef enum{
-    FLUXO_NS,                           // Carros nas direções Norte e Sul
-    FLUXO_LO,                           // Carros nas direções Leste e Oeste
-    AMBULANCIA_NS,                      // Ambulancias nas direções Norte e Sul
-    AMBULANCIA_LO                       // Ambulancias nas direções Leste e Oeste 
-} EstadoFluxo;
-
-/**
- * @brief Tipos de Veículos presentes no cruzamento
- * 
- */
-typedef enum{
-    TIPO_CARRO,
-    TIPO_AMBULANCIA
-} TipoVeiculo;
-
-/**
- * @brief Direção de cada veículo
- * 
- */
-typedef struct {
-    Direcao direcao;
-} VeiculoArgs;
-
-/**
- * @brief Struct que define parâmetros importantes para o controle do fluxo de veículos no cruzamento
- * 
- */
-typedef struct{
-    int carros_esperando[NUM_DIRECOES], ambulancias_esperando[NUM_DIRECOES];            // Quantidade de carros e ambulâncias esperando em uma dada direção respectivamente
-    int carros_no_cruzamento, ambulancias_no_cruzamento;                                // Quantidade de carros e ambulâncias que estão no cruzamento respectivamente
-    bool modo_emergencia;                                                               // Flag para sinalizar que há ambulâncias querendo entrar no cruzamento (Modo Emergência)
-    EstadoFluxo estado_atual;                                                           // Estado atual do fluxo de veículos no cruzamento
-    pthread_mutex_t lock;                                                               // Mutex para garantir exclusão mútua entre threads em seções críticas do código
-    pthread_mutex_t lock_rand;                                                          // Mutex para proteger as chamadas da função rand()
-    pthread_cond_t pode_cruzar;                                                         // Variável condicional para permitir que as threads aguardem de forma eficiente até que uma condição específica seja atendida
-    int contadores_id_carros[NUM_DIRECOES], contadores_id_ambulancias[NUM_DIRECOES];    // Arrays para guardar o próximo id de cada direção de carros e ambulâncias respectivamente
-    pthread_mutex_t lock_contadores_id;                                                 // Mutex para proteger os arrays acima
-} Cruzamento;
-
-Cruzamento cruzamento;                                                                  // Variável global para gerir todo o fluxo do cruzamento
-
-
-int pode_passar(Direcao dir, EstadoFluxo estado, TipoVeiculo tipo){
-    // Se está liberado para ambulâncias
-    if(estado == AMBULANCIA_NS || estado == AMBULANCIA_LO){
-        // apenas ambulâncias podem sequer considerar passar.
-        if(tipo != TIPO_AMBULANCIA) return 0;
-    }
-
-    // Se uma emergência geral foi declarada, barra os carros.
-    if(cruzamento.modo_emergencia && tipo == TIPO_CARRO) return 0;
-
-    // Verificação de fluxo e direção para quem sobrou
-    if((dir == NORTE || dir == SUL) && (estado == FLUXO_NS || estado == AMBULANCIA_NS)) return 1;
-    if((dir == LESTE || dir == OESTE) && (estado == FLUXO_LO || estado == AMBULANCIA_LO)) return 1;
-    return 0;
-}
-
-/**
- * @brief Função da Thread de Carro. Opera em um loop infinito, simulando o comportamento contínuo de um veículo no sistema:
- * se aproximar do cruzamento, esperar pela sua vez, atravessar, e então reiniciar o ciclo. A função gerencia toda a sincronização 
- * necessária para interagir de forma segura com o estado compartilhado do cruzamento.
- *
- * @param arg Um ponteiro genérico (void*) para uma estrutura VeiculoArgs alocada dinamicamente. A estrutura deve conter a direção 
- * de origem do carro.
- *
- * @return void* Sempre retorna NULL
- */
-void * carros(void *arg){
-    int id;                                 // Declaração da variável de id local para a thread
-    int tempo;                              // Variável para calcular o tempo que será usado no sleep com rand
-    VeiculoArgs *args = (VeiculoArgs*) arg; // Converter o argumento genérico para o tipo esperado (VeiculoArgs)
-    Direcao direcao_carro = args->direcao;  // Extrair a direção, definida pela thread main
-    free(arg);                              // Liberar a memória alocada na main para os argumentos, uma vez que os dados já foram copiados
-
-    // Adquire o lock específico dos contadores para garantir que a leitura e o incremento
-    // do id sejam uma operação que evite com que dois carros da mesma direção peguem o mesmo id
-    pthread_mutex_lock(&cruzamento.lock_contadores_id);
-    // Pega o próximo id disponível para esta direção
-    id = cruzamento.contadores_id_carros[direcao_carro];
-    // Incrementa o contador para a próxima thread da mesma direção
-    cruzamento.contadores_id_carros[direcao_carro]++;
-    pthread_mutex_unlock(&cruzamento.lock_contadores_id);
-
-	while(1){
-        // Simula o tempo que o carro leva para percorrer o trajeto até chegar ao cruzamento
-        printf("Carro %d da direcao %s esta se aproximando do cruzamento.\n", id, nome_direcao[direcao_carro]);
-        fflush(stdout); // Força a escrita imediata no terminal para depuração concorrente.
-
-        pthread_mutex_lock(&cruzamento.lock_rand);
-        tempo = 2 + (rand() % 8);
-        pthread_mutex_unlock(&cruzamento.lock_rand);
-        sleep(tempo);
-
-        // Adquire o lock principal para interagir com o estado do cruzamento
-		pthread_mutex_lock(&cruzamento.lock);
-        // Incrementa o contador da fila de espera para sua direção.
-		cruzamento.carros_esperando[direcao_carro]++;
-
-        // Loop de espera condicional em que a thread só prossegue se 'pode_passar' retornar true. Essencial para se proteger contra despertares inadequados
-		while(!pode_passar(direcao_carro, cruzamento.estado_atual, TIPO_CARRO)){
-            printf("Carro %d da direcao %s esta esperando para passar.\n", id, nome_direcao[direcao_carro]);
-            fflush(stdout);
-            // libera o 'lock' e põe a thread para dormir. Ao acordar, ela readquire o 'lock' antes de reavaliar a condição
-            pthread_cond_wait(&cruzamento.pode_cruzar, &cruzamento.lock);
-        }
-
-        // Se saiu do loop, a passagem foi liberada. Atualiza o estado:
-        cruzamento.carros_esperando[direcao_carro]--;   // Deixa de estar "esperando"
-        cruzamento.carros_no_cruzamento++;              // Agora está "no cruzamento"
-        printf("Carro %d da direcao %s entrou no cruzamento.\n", id, nome_direcao[direcao_carro]);
-        fflush(stdout);
-
-        // Libera o lock antes de simular o tempo de travessia. Isso é feito para permitir que outros carros do mesmo fluxo entrem no cruzamento concorrentemente
-	    pthread_mutex_unlock(&cruzamento.lock);
-
-        // Simula o tempo que o carro leva para atravessar fisicamente o cruzamento
-        sleep(3);
-
-        // Readquire o lock para atualizar o estado de saída de forma segura
-        pthread_mutex_lock(&cruzamento.lock);
-        cruzamento.carros_no_cruzamento--;
-        printf("Carro %d da direcao %s saiu do cruzamento.\n", id, nome_direcao[direcao_carro]);
-        fflush(stdout);
-
-        // Notifica todas as outras threads (especialmente a controladora) que o estado mudou.Essencial para que athread 'fluxo_trafego' possa verificar se o cruzamento esvaziou
-        pthread_cond_broadcast(&cruzamento.pode_cruzar);
-        pthread_mutex_unlock(&cruzamento.lock);
-    }
-    return NULL;
-}
-
-/**
- * @brief Função da Thread de Ambulância. Implementa um comportamento de alta prioridade que interrompe o fluxo normal de tráfego.
- * Seu funcionamento se dá da seguinte forma:
- *  1. Anunciar a emergência ao sistema, forçando a thread controladora a reagir;
- *  2. Aguardar o controlador limpar o cruzamento e abrir a passagem para apenas as ambulâncias;
- *  3. Atravessar o cruzamento rapidamente;
- *  4. Sinalizar o fim da emergência, permitindo que o sistema retorne à operação normal;
- *
- * @param arg Um ponteiro genérico (void*) para uma estrutura VeiculoArgs alocada dinamicamente, contendo a direção de origem da ambulância.
- * @return void* Sempre retorna NULL.
- */
-void * ambulancia(void* arg){
-    int id;                                     // Declaração da variável de id local para a thread
-    int tempo;                                  // Variável para calcular o tempo que será usado no sleep com rand
-    VeiculoArgs *args = (VeiculoArgs*) arg;     // Converte e extrai os argumentos passados pela thread main
-    Direcao direcao_ambulancia = args->direcao; // Libera a memória dos argumentos, uma vez que os dados já foram copiados localmente
-    free(arg);
-
-    // Adquire o lock específico dos contadores para garantir que a leitura e o incremento
-    // do id sejam uma operação que evite com que dois carros da mesma direção peguem o mesmo id
-    pthread_mutex_lock(&cruzamento.lock_contadores_id);
-    // Pega o próximo id disponível para esta direção
-    id = cruzamento.contadores_id_ambulancias[direcao_ambulancia];
-    // Incrementa o contador para a próxima thread da mesma direção
-    cruzamento.contadores_id_ambulancias[direcao_ambulancia]++;
-    pthread_mutex_unlock(&cruzamento.lock_contadores_id);
-
-    while(1){
-        // Notifica o sistema sobre a aproximação de um veículo de alta prioridade.
-        printf("AMBULANCIA DA DIRECAO %s SE APROXIMANDO EM EMERGENCIA!\n", nome_direcao[direcao_ambulancia]);
-        fflush(stdout);
-
-        // Adquire o lock principal para alterar o estado global
-        pthread_mutex_lock(&cruzamento.lock);
-        cruzamento.modo_emergencia = true;  // Ativa a flag de emergência
-        // Acorda todas as threads em espera, especialmente a thread 'fluxo_trafego', para que possa detectar a flag modo_emergencia e iniciar o protocolo
-        pthread_cond_broadcast(&cruzamento.pode_cruzar);
-        // Libera o lock imediatamente para evitar deadlock com a thread controladora
-        pthread_mutex_unlock(&cruzamento.lock);
-        
-        // Pequena pausa para a thread controladora possa ter tempo de reagir e começar a limpar o cruzamento
-        sleep(1);
-
-        // Adquire o lock principal para se entrar na fila de espera
-        pthread_mutex_lock(&cruzamento.lock);
-        cruzamento.ambulancias_esperando[direcao_ambulancia]++;
-
-        // Loop de espera condicional queaguarda até que o controlador mude o estado para um fluxo de ambulância compatível com sua direção
-        while(!pode_passar(direcao_ambulancia, cruzamento.estado_atual, TIPO_AMBULANCIA)){
-            printf("AMBULANCIA %d (%s) ESPERANDO PARA PASSAR.\n", id, nome_direcao[direcao_ambulancia]);
-            fflush(stdout);
-            pthread_cond_wait(&cruzamento.pode_cruzar, &cruzamento.lock);
-        }
-
-        // Se saiu do loop, a passagem foi liberada
-        cruzamento.ambulancias_esperando[direcao_ambulancia]--;
-        cruzamento.ambulancias_no_cruzamento++;
-        printf("AMBULANCIA %d (%s) ENTROU NO CRUZAMENTO.\n", id, nome_direcao[direcao_ambulancia]);
-        fflush(stdout);
-        
-        // Libera o lock antes de simular a travessia, permitindo que outras ambulâncias do mesmo fluxo entrem concorrentemente
-        pthread_mutex_unlock(&cruzamento.lock);
-
-        // Simula a travessia rápida do cruzamento
-        sleep(2);
-
-        // Readquire o lock para finalizar a emergência de forma segura
-        pthread_mutex_lock(&cruzamento.lock);
-        cruzamento.ambulancias_no_cruzamento--;
-        cruzamento.modo_emergencia = false;     // Desativa a flag de emergência.
-        printf("AMBULANCIA %d (%s) SAIU DO CRUZAMENTO.\n", id, nome_direcao[direcao_ambulancia]);
-        fflush(stdout);
-        
-        // Notifica todas as threads que a emergência acabou. Isso é feito para "liberar" a thread 'fluxo_trafego', que estava aguardando esta condição
-        pthread_cond_broadcast(&cruzamento.pode_cruzar);
-        pthread_mutex_unlock(&cruzamento.lock);
-
-        // Simula um tempo de percurso longo e aleatório antes de iniciar uma nova emergência, tornando estes eventos mais esporádicos e realistas na simulação.
-        pthread_mutex_lock(&cruzamento.lock_rand);
-        tempo = 30 + (rand() % 30);
-        pthread_mutex_unlock(&cruzamento.lock_rand);
-        sleep(tempo);
-    }
-    return NULL;
-}
-
-/**
- * @brief Função da Thread controladora do cruzamento.Opera em um loop infinito, implementando uma máquina de estados que gerencia o fluxo de
- * tráfego. A cada ciclo, ela avalia o estado do cruzamento e decide qual ação tomar, alternando entre dois modos principais:
- *      1. Modo de Emergência: Ativado quando uma ambulância chega. Este modo tem prioridade máxima, interrompe o fluxo normal, esvazia o 
- * cruzamento e libera a passagem para a ambulância.
- *      2.  Modo Normal: Operação padrão que calcula a demanda de carros em cada fluxo, abre o sinal para a via mais congestionada por um 
- * tempo dinâmico e previne starvation.
- *
- * @param arg Não utilizado nesta implementação (NULL é passado na criação da thread).
- * @return void* Sempre retorna NULL, pois a thread nunca termina.
- */
-void * fluxo_trafego(void* arg){
-    int i;      // Variável do laço for
-
-    // Declaração de variáveis locais para o ciclo de decisão
-    EstadoFluxo proximo_estado;
-    float tempo_calculado;
-    int demanda_ns, demanda_lo, num_carros, tempo_final, demanda_amb_ns, demanda_amb_lo, num_ambulancias;
-    bool fila_ativa_esvaziou = false;
-
-    while(1){
-        // Pausa inicial em cada ciclo para permitir que as filas de veículos se formem antes de tomar uma decisão, evitando alternâncias de fluxo 
-        // muito rápidas com o cruzamento vazio
-        sleep(2);
-
-        // Adquire o lock principal para garantir acesso exclusivo a todas as variáveis compartilhadas na struct cruzamento
-        pthread_mutex_lock(&cruzamento.lock);
-
-        // Verifica a flag de emergência para decidir qual protocolo seguir
-        if(cruzamento.modo_emergencia){
-
-            // Garante que o cruzamento esteja livre de carros normais antes de liberar a passagem para a ambulância
-            while(cruzamento.carros_no_cruzamento > 0){
-                printf("---------------- ESPERANDO %d CARRO(S) SAIREM PARA TOMAR A PROXIMA DECISAO ----------------\n", cruzamento.carros_no_cruzamento);
-                pthread_cond_wait(&cruzamento.pode_cruzar, &cruzamento.lock);
-            }
-            
-            // Calcula a demanda de ambulâncias para priorizar o fluxo correto
-            demanda_amb_ns = cruzamento.ambulancias_esperando[NORTE] + cruzamento.ambulancias_esperando[SUL];
-            demanda_amb_lo = cruzamento.ambulancias_esperando[LESTE] + cruzamento.ambulancias_esperando[OESTE];
-
-            if(demanda_amb_ns >= demanda_amb_lo) proximo_estado = AMBULANCIA_NS;
-            else proximo_estado = AMBULANCIA_LO;
-
-            cruzamento.estado_atual = proximo_estado;
-
-            printf("---------------- !!! EMERGENCIA !!! ----------------\n");
-            printf("---------------- !!! ABERTO PARA: AMBULANCIA(S) %s !!! ----------------\n", (proximo_estado == AMBULANCIA_NS) ? "NORTE-SUL" : "LESTE-OESTE");
-
-            // Notifica as ambulâncias e aguarda o fim da emergência
-            pthread_cond_broadcast(&cruzamento.pode_cruzar);
-
-            // O controlador entra em um estado de espera passiva. Prosseguirá quando a última ambulância a sair definir modo_emergencia para false e der broadcast
-            while(cruzamento.modo_emergencia){
-                pthread_cond_wait(&cruzamento.pode_cruzar, &cruzamento.lock);
-            }
-            printf("---------------- !!! EMERGENCIA FINALIZADA !!! ----------------\n");
-            printf("---------------- VOLTANDO AO MODO NORMAL ----------------\n");
-
-            // Libera o lock no final do ciclo de emergência
-            pthread_mutex_unlock(&cruzamento.lock);
-        }
-        else{
-            // Garante que o cruzamento esteja livre antes de abrir para um novo fluxo
-            while(cruzamento.carros_no_cruzamento > 0){
-                printf("---------------- ESPERANDO %d CARRO(S) SAIREM PARA MUDAR O FLUXO ----------------\n", cruzamento.carros_no_cruzamento);
-                pthread_cond_wait(&cruzamento.pode_cruzar, &cruzamento.lock);
-            }
-
-            // Calcula a demanda de carros para decidir o próximo fluxo
-            demanda_ns = cruzamento.carros_esperando[NORTE] + cruzamento.carros_esperando[SUL];
-            demanda_lo = cruzamento.carros_esperando[LESTE] + cruzamento.carros_esperando[OESTE];
-
-            // Lógica de decisão para o próximo estado
-            if(demanda_ns >= demanda_lo){
-                proximo_estado = FLUXO_NS;
-                num_carros = demanda_ns;
-            } 
-            else{
-                proximo_estado = FLUXO_LO;
-                num_carros = demanda_lo;
-            }
-            cruzamento.estado_atual = proximo_estado;
-            
-            // Cálculo de Tempo Dinâmico: Define a duração da passagem que cada fluco possui
-            if(num_carros > 0) tempo_calculado = T_BASE + ((num_carros - 1) * FATOR_CARRO);
-            else tempo_calculado = T_BASE;
-
-            tempo_final = (int) tempo_calculado;
-
-            // Aplica os limites de tempo mínimo e máximo para garantir fluidez e prevenir starvation
-            if(tempo_final > T_MAXIMO) tempo_final = T_MAXIMO;
-            else if (tempo_final < T_MINIMO) tempo_final = T_MINIMO;
-            
-            printf("---------------- FLUXO %s ABERTO POR ATE %d SEGUNDOS PARA %d CARROS ----------------\n", 
-                cruzamento.estado_atual == FLUXO_NS ? "NORTE-SUL" : "LESTE-OESTE", tempo_final, num_carros);
-
-            // Notifica os carros e libera o lock antes da espera
-            pthread_cond_broadcast(&cruzamento.pode_cruzar);
-            pthread_mutex_unlock(&cruzamento.lock);
-            
-            // A thread dorme em incrementos de 1 segundo, verificando se a fila esvaziou
-            for(i = 0; i < tempo_final; i++){
-                sleep(1);
-                
-                // Readquire o lock brevemente apenas para a verificação
-                pthread_mutex_lock(&cruzamento.lock);
-
-                fila_ativa_esvaziou = false;
-                
-                if(proximo_estado == FLUXO_NS){
-                    if(cruzamento.carros_esperando[NORTE] == 0 && cruzamento.carros_esperando[SUL] == 0) fila_ativa_esvaziou = true;
-                } 
-                else{
-                    if(cruzamento.carros_esperando[LESTE] == 0 && cruzamento.carros_esperando[OESTE] == 0) fila_ativa_esvaziou = true;
-                }
-                
-                pthread_mutex_unlock(&cruzamento.lock);
-                
-                // Se a fila esvaziou, interrompe a espera para otimizar o fluxo
-                if(fila_ativa_esvaziou){
-                    printf("---------------- FILA ATUAL DE CARROS (%s) ESVAZIOU, ENCERRANDO PASSAGEM ----------------\n", 
-                        proximo_estado == FLUXO_NS ? "NORTE-SUL" : "LESTE-OESTE");
-                    break;  // Sai do laço for e inicia um novo ciclo de decisão.
-                }
-            }
-        }
-    }
-    return NULL;
-}
-
-/**
- * @brief Thread principal main responsáve pela inicialização de variáveis e criação das threads que serão utilizadas ao longo do código.
- * 
- * @param argc inteiro que indica o número de argumentos de linha de comando fornecidos quando o programa é executado, incluindo o próprio nome do programa
- * @param argv parâmetro passado para a função principal, permitindo que o programa receba argumentos de linha de comando
- * @return int declaração usada para indicar a execução bem-sucedida do programa para o sistema operacional
- */
-int main(int argc, char * argv[]){
-    int i;                                       // Variável do laço for
-    int thread_idx = 0;                          // Contador para gerar os ids únicos de cada thread de veículos                       
-    pthread_t veiculos_t[TOTAL_VEICULOS], fluxo; // Threads dos veículos envolvidos no cruzamento e de controle do cruzamento respectivamente
-
-    // Inicialização dos elementos de threads (locks, condicionais), contadores e identificadores utilizados no código
-    pthread_mutex_init(&cruzamento.lock, NULL);
-    pthread_mutex_init(&cruzamento.lock_rand, NULL);
-    pthread_mutex_init(&cruzamento.lock_contadores_id, NULL);
-    pthread_cond_init(&cruzamento.pode_cruzar, NULL);
-    cruzamento.estado_atual = FLUXO_NS;
-    cruzamento.carros_no_cruzamento = 0;
-    cruzamento.ambulancias_no_cruzamento = 0;
-    cruzamento.modo_emergencia = false;
-    for(i = 0; i < NUM_DIRECOES; i++){
-        cruzamento.carros_esperando[i] = 0;
-        cruzamento.contadores_id_carros[i] = 1;
-        cruzamento.contadores_id_ambulancias[i] = 1;
-        cruzamento.ambulancias_esperando[i] = 0;
-    }
-    
-    // Criação da thread controladora (fluxo_trafego)
-    pthread_create(&fluxo, NULL, fluxo_trafego, NULL);
-
-    // Criação das threads dos carros em todas as direções
-    for(i = 0; i < CARROS_NORTE; i++){
-        VeiculoArgs *args = malloc(sizeof(VeiculoArgs));
-        args->direcao = NORTE;
-        pthread_create(&veiculos_t[thread_idx], NULL, carros, args);
-        thread_idx++;
-    }
-
-    for(i = 0; i < CARROS_SUL; i++){
-        VeiculoArgs *args = malloc(sizeof(VeiculoArgs));
-        args->direcao = SUL;
-        pthread_create(&veiculos_t[thread_idx], NULL, carros, args);
-        thread_idx++;
-    }
-
-    for(i = 0; i < CARROS_LESTE; i++){
-        VeiculoArgs *args = malloc(sizeof(VeiculoArgs));
-        args->direcao = LESTE;
-        pthread_create(&veiculos_t[thread_idx], NULL, carros, args);
-        thread_idx++;
-    }
-
-    for(i = 0; i < CARROS_OESTE; i++){
-        VeiculoArgs *args = malloc(sizeof(VeiculoArgs));
-        args->direcao = OESTE;
-        pthread_create(&veiculos_t[thread_idx], NULL, carros, args);
-        thread_idx++;
-    }
-
-
-
-    // Criação das threads das ambulâncias em todas as direções
-    for(i = 0; i < AMBULANCIA_NORTE; i++){
-        VeiculoArgs *args = malloc(sizeof(VeiculoArgs));
-        args->direcao = NORTE;
-        pthread_create(&veiculos_t[thread_idx], NULL, ambulancia, args);
-        thread_idx++;
-    }
-
-    for(i = 0; i < AMBULANCIA_SUL; i++){
-        VeiculoArgs *args = malloc(sizeof(VeiculoArgs));
-        args->direcao = SUL;
-        pthread_create(&veiculos_t[thread_idx], NULL, ambulancia, args);
-        thread_idx++;
-    }
-
-    for(i = 0; i < AMBULANCIA_LESTE; i++){
-        VeiculoArgs *args = malloc(sizeof(VeiculoArgs));
-        args->direcao = LESTE;
-        pthread_create(&veiculos_t[thread_idx], NULL, ambulancia, args);
-        thread_idx++;
-    }
-
-    for(i = 0; i < AMBULANCIA_OESTE; i++){
-        VeiculoArgs *args = malloc(sizeof(VeiculoArgs));
-        args->direcao = OESTE;
-        pthread_create(&veiculos_t[thread_idx], NULL, ambulancia, args);
-        thread_idx++;
-    }
-
-    // Juntar as threads
-    for(i = 0; i < TOTAL_VEICULOS; i++) pthread_join(veiculos_t[i], NULL);
-
-
-    return 0;
+/**
+ * 
+ * Descrição do problema resolvido pelo presente código:
+ * 
+ *      Em um determinado cruzamento de quatro vias, carros e ambulâncias chegam
+ * de diferentes direções (Norte, Sul, Leste e Oeste) e precisam cruzar com segurança.
+ * O objetivo é gerenciar o fluxo de tráfego para evitar colisões (condição de corrida)
+ * e também evitar starvation (carros de uma via nunca conseguem passar). Para a
+ * definição de passagem, apenas carros de direções compatíveis (como Norte e Sul em
+ * linha reta) podem cruzar simultaneamente, e carros de direções conflitantes (como
+ * Norte e Leste) não podem estar no cruzamento ao mesmo tempo. Além disso, as
+ * ambulâncias possuem prioridade máxima, ou seja, quando uma ambulância chega,
+ * o sistema precisa:
+ *      (a) fechar todas as outras vias de forma segura;
+ *      (b) garantir que o cruzamento esteja vazio;
+ *      (c) permitir a passagem da(s) ambulância(s);
+ *      (d) retornar ao funcionamento normal;
+ * 
+ * @version 0.1
+ * @date 2025-10-17
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+#define _GNU_SOURCE                     // cpu_set_t e pthread_attr_setaffinity_np() (--afinidade)
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <time.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "cruzamento.h"
+#include "cruzamento_simulador.h"
+
+// Número de Carros em cada direção (podem ser redefinidos na compilação, como em make CFLAGS="-O2 -DCARROS_NORTE=1000")
+#ifndef CARROS_NORTE
+#define CARROS_NORTE 15
+#endif
+#ifndef CARROS_SUL
+#define CARROS_SUL 3
+#endif
+#ifndef CARROS_LESTE
+#define CARROS_LESTE 8
+#endif
+#ifndef CARROS_OESTE
+#define CARROS_OESTE 8
+#endif
+#define TOTAL_CARROS (CARROS_NORTE + CARROS_SUL + CARROS_LESTE + CARROS_OESTE)
+
+// Número de Ambulâncias em cada direção
+#ifndef AMBULANCIA_NORTE
+#define AMBULANCIA_NORTE 2
+#endif
+#ifndef AMBULANCIA_SUL
+#define AMBULANCIA_SUL 1
+#endif
+#ifndef AMBULANCIA_LESTE
+#define AMBULANCIA_LESTE 3
+#endif
+#ifndef AMBULANCIA_OESTE
+#define AMBULANCIA_OESTE 1
+#endif
+#define TOTAL_AMBULANCIAS (AMBULANCIA_NORTE + AMBULANCIA_SUL + AMBULANCIA_LESTE + AMBULANCIA_OESTE)
+
+#define TOTAL_VEICULOS (TOTAL_CARROS + TOTAL_AMBULANCIAS)
+
+// Corredor de cruzamentos ao longo de uma via arterial Leste-Oeste
+#define MAX_CRUZAMENTOS 8               // Número máximo de cruzamentos no corredor
+#define TEMPO_TRECHO 10                 // Tempo (em segundos) de percurso entre dois cruzamentos vizinhos
+#define CICLO_CORREDOR 0                // Ciclo comum dos controladores coordenados; 0 = 2 * (TEMPO_TRAVESSIA + trecho), onda nos dois sentidos
+#define FRACAO_ARTERIAL 0.5             // Fração do ciclo coordenado dedicada ao eixo arterial (Leste-Oeste)
+
+// Capacidade de veiculos[]: carros Leste-Oeste percorrem o corredor; carros Norte-Sul e ambulâncias pertencem a um cruzamento
+#define MAX_VEICULOS (CARROS_LESTE + CARROS_OESTE + MAX_CRUZAMENTOS * (TOTAL_VEICULOS - CARROS_LESTE - CARROS_OESTE))
+
+// Nome do segmento de memória compartilhada POSIX onde as métricas ao vivo são publicadas
+#define NOME_SHM_METRICAS "/cruzamento_metricas"
+#define VERSAO_SHM_METRICAS 1
+
+// Exportador de métricas no formato texto do Prometheus
+#define INTERVALO_PROMETHEUS 5          // Intervalo (em segundos) entre as escritas do arquivo de métricas
+#define NUM_FAIXAS_ESPERA 9             // Número de faixas do histograma de tempo de espera (a última é +Inf)
+
+// Gravação e reprodução do entrelaçamento das threads
+#define ASSINATURA_GRAVACAO "CRZG"      // Assinatura do arquivo de gravação
+#define VERSAO_GRAVACAO 2
+#define INDICE_CONTROLADOR 0            // Índice da controladora do primeiro cruzamento (veículos usam 1..total_veiculos, as demais controladoras os seguintes)
+
+// Checkpoint do estado completo da simulação
+#define ASSINATURA_CHECKPOINT "CRZC"    // Assinatura do arquivo de checkpoint
+#define VERSAO_CHECKPOINT 7
+
+// Níveis de log: cada mensagem tem um nível, e só as de nível até o de compilação (NIVEL_LOG_COMPILADO) e até o de execução (--log) são
+// impressas. As chamadas acima de NIVEL_LOG_COMPILADO viram um if de condição constante e falsa, que o compilador elimina com os
+// argumentos: a versão de benchmark (make cruzamento_bench) não chama printf nem fflush nas transições de estado
+#define NIVEL_LOG_NENHUM 0
+#define NIVEL_LOG_AVISOS 1              // Checkpoint, gravação, reprodução e partida das threads
+#define NIVEL_LOG_CONTROLE 2            // Decisões das controladoras
+#define NIVEL_LOG_VEICULOS 3            // Cada transição de cada veículo
+#ifndef NIVEL_LOG_COMPILADO
+#define NIVEL_LOG_COMPILADO NIVEL_LOG_VEICULOS
+#endif
+
+#define REGISTRAR_LOG(nivel, descarregar, ...) do{ \
+        if((nivel) <= NIVEL_LOG_COMPILADO && (nivel) <= nivel_log){ \
+            printf(__VA_ARGS__); \
+            if(descarregar) fflush(stdout); \
+        } \
+    } while(0)
+#define LOG_AVISO(...) REGISTRAR_LOG(NIVEL_LOG_AVISOS, true, __VA_ARGS__)
+#define LOG_CONTROLE(...) REGISTRAR_LOG(NIVEL_LOG_CONTROLE, false, __VA_ARGS__)
+#define LOG_VEICULO(...) REGISTRAR_LOG(NIVEL_LOG_VEICULOS, true, __VA_ARGS__)     // Descarrega na hora, para acompanhar a ordem entre as threads
+
+// Registros colunares das travessias e das fases (--registros)
+#define BLOCO_REGISTROS 4096            // Linhas acumuladas em memória antes de cada escrita das colunas
+#define MAX_COLUNAS_REGISTRO 8
+
+// Pilha das threads da simulação (--pilha): os veículos e as controladoras só guardam na pilha algumas variáveis locais e as chamadas
+// de printf, então uma fração da reserva padrão (8 MB) basta, e milhares de threads partem sem reservar gigabytes de endereços
+#define PILHA_THREADS 64                // Em KB; 0 = tamanho padrão do sistema
+
+// Afinidade (--afinidade)
+#define MAX_NOS_NUMA 64                 // Nós NUMA considerados ao distribuir os cruzamentos
+#define DIRETORIO_NOS "/sys/devices/system/node"
+
+// Verificador de invariantes de segurança
+#define VIOLACOES_POR_THREAD 16         // Violações registradas em detalhe por thread (as demais são apenas contadas)
+
+const char* nome_tipo[] = {"carro", "ambulancia"};
+
+// Quantidade de veículos de cada tipo por direção, na ordem em que as threads são criadas na main
+const int quantidade_veiculos[NUM_TIPOS][NUM_DIRECOES] = {
+    {CARROS_NORTE, CARROS_SUL, CARROS_LESTE, CARROS_OESTE},
+    {AMBULANCIA_NORTE, AMBULANCIA_SUL, AMBULANCIA_LESTE, AMBULANCIA_OESTE}
+};
+
+/**
+ * @brief Direção de cada veículo
+ * 
+ */
+typedef struct {
+    Direcao direcao;
+    int indice;                         // Índice estável da thread (ordem de criação na main), usado na gravação do entrelaçamento
+} VeiculoArgs;
+
+/**
+ * @brief Etapa do ciclo de vida em que um veículo se encontra
+ *
+ */
+typedef enum{
+    VEICULO_APROXIMANDO,                // Percorrendo o trajeto até o cruzamento (até 'prazo')
+    VEICULO_ANUNCIADO,                  // Ambulância que já declarou emergência e aguarda o controlador reagir (até 'prazo')
+    VEICULO_ESPERANDO,                  // Na fila de espera da sua direção
+    VEICULO_ATRAVESSANDO                // Dentro do cruzamento (até 'prazo')
+} EstadoVeiculo;
+
+/**
+ * @brief Estado persistente de cada veículo. Só é alterado com o lock do cruzamento em que o veículo está adquirido, de modo que um
+ * checkpoint feito com todos os locks enxerga os veículos e os contadores dos cruzamentos em um mesmo instante consistente. Os prazos
+ * são instantes absolutos do relógio da simulação (ver tempo_simulacao()). 'cruzamento' é atômico porque as controladoras dos outros
+ * cruzamentos o leem ao filtrar seus veículos; o carro que segue para o próximo cruzamento grava o novo estado antes de trocá-lo.
+ *
+ */
+typedef struct{
+    int id;                             // Número exibido do veículo (0 enquanto ainda não foi atribuído)
+    Direcao direcao;
+    TipoVeiculo tipo;
+    EstadoVeiculo estado;
+    double prazo;                       // Fim da etapa atual, quando ela tem duração
+    double chegada;                     // Instante em que o veículo entrou na fila de espera
+    double entrada;                     // Instante em que o veículo entrou no cruzamento pela última vez
+    int fase;                           // Fase do cruzamento em que o veículo entrou (-1 se anterior a esta execução; ver --registros)
+    uint64_t semente;                   // Estado do gerador pseudoaleatório próprio do veículo
+    _Atomic int cruzamento;             // Cruzamento em que o veículo está ou para o qual se dirige
+    double inicio_percurso;             // Chegada ao primeiro cruzamento do corredor (carros Leste-Oeste)
+    int paradas_percurso;               // Paradas no percurso atual do corredor
+    int faixa;                          // Faixa da direção em que o carro espera (escolhida na chegada ao cruzamento)
+    int seguinte;                       // Próximo carro na fila da faixa, como índice em veiculos[] (-1 se é o último)
+    pthread_cond_t vez;                 // Sinalizada quando o carro, à frente da fila da sua faixa, pode tentar entrar
+} Veiculo;
+
+const char* nome_modelo_verde[] = {"formula", "vazao"};
+
+const char* nome_politica[] = {"demanda", "pressao"};
+
+/**
+ * @brief Contadores cumulativos de desempenho. Todos são atômicos e atualizados com ordem relaxada nos mesmos pontos em que o estado
+ * do cruzamento muda, de modo que os exportadores podem amostrá-los a qualquer momento sem adquirir nenhum lock da simulação.
+ *
+ */
+typedef struct{
+    _Atomic uint64_t chegadas[NUM_TIPOS][NUM_DIRECOES];                                 // Veículos que entraram na fila de espera
+    _Atomic uint64_t entradas[NUM_TIPOS][NUM_DIRECOES];                                 // Veículos que entraram no cruzamento
+    _Atomic uint64_t travessias[NUM_TIPOS][NUM_DIRECOES];                               // Veículos que concluíram a travessia
+    _Atomic uint64_t trocas_fase[4];                                                    // Aberturas de cada EstadoFluxo
+    _Atomic uint64_t emergencias;                                                       // Ativações do modo emergência
+    _Atomic uint64_t espera_faixas[NUM_TIPOS][NUM_FAIXAS_ESPERA];                       // Histograma (não cumulativo) do tempo de espera
+    _Atomic uint64_t espera_soma_us[NUM_TIPOS];                                         // Soma dos tempos de espera, em microssegundos
+    _Atomic uint64_t violacoes;                                                         // Violações de invariantes detectadas pelo verificador
+    _Atomic uint64_t espera_maxima_us[NUM_TIPOS][NUM_DIRECOES];                         // Maior espera já observada, em microssegundos
+    _Atomic uint64_t intervencoes_espera;                                               // Decisões da controladora forçadas pela espera máxima
+    _Atomic uint64_t verdes;                                                            // Fluxos de carros abertos e já encerrados
+    _Atomic uint64_t verde_us, verde_ocioso_us;                                         // Tempo total de verde e tempo de verde após a última entrada
+    _Atomic uint64_t fila_residual;                                                     // Carros que ficaram na fila do eixo aberto ao fim de cada verde
+    _Atomic uint64_t vazao_mcps[2];                                                     // Cópia da vazão do primeiro cruzamento em milésimos de carro por segundo
+    _Atomic uint64_t paradas[NUM_TIPOS][NUM_DIRECOES];                                  // Veículos que chegaram à fila e não puderam entrar de imediato
+    _Atomic uint64_t percursos, percurso_us, percurso_paradas;                          // Percursos completos do corredor, sua duração e suas paradas
+} Metricas;
+
+// Limites superiores (em segundos) das faixas do histograma de espera; a última faixa é +Inf
+const double limites_espera[NUM_FAIXAS_ESPERA - 1] = {1, 2, 5, 10, 20, 30, 60, 120};
+
+/**
+ * @brief Página de métricas publicada em memória compartilhada. Protegida por um seqlock: o escritor (sempre com o lock do primeiro cruzamento
+ * adquirido) torna 'sequencia' ímpar antes de escrever e par ao terminar; o leitor copia os campos e só aceita a cópia se a sequência
+ * era par e não mudou durante a leitura. Assim os monitores externos nunca tocam nos locks da simulação.
+ *
+ */
+typedef struct{
+    _Atomic uint32_t sequencia;                                                         // Contador do seqlock (ímpar = escrita em andamento)
+    uint32_t versao;                                                                    // Versão do layout, para o leitor validar a página
+    int32_t carros_esperando[NUM_DIRECOES], ambulancias_esperando[NUM_DIRECOES];
+    int32_t carros_no_cruzamento, ambulancias_no_cruzamento;
+    int32_t estado_atual, modo_emergencia;
+    int64_t inicio_fase_ns;                                                             // Início da fase atual em nanossegundos desde a época Unix
+    uint64_t travessias_carros[NUM_DIRECOES], travessias_ambulancias[NUM_DIRECOES];
+} MetricasCompartilhadas;
+
+Cruzamento cruzamentos[MAX_CRUZAMENTOS];                                                // Cruzamentos do corredor (apenas o primeiro fora do modo corredor)
+int num_cruzamentos = 1;                                                                // Cruzamentos em uso (--corredor)
+bool corredor_coordenado = false;                                                       // Controladores seguindo as defasagens da onda verde (--coordenar)
+double tempo_trecho = TEMPO_TRECHO;                                                     // Tempo de percurso entre cruzamentos vizinhos (--trecho)
+double ciclo_corredor = CICLO_CORREDOR;                                                 // Ciclo comum dos controladores coordenados (--ciclo; 0 = automático)
+Veiculo veiculos[MAX_VEICULOS];                                                         // Estado de cada veículo, indexado pelo índice da thread - 1
+int total_veiculos = 0;                                                                 // Veículos em uso em veiculos[]
+struct timespec origem_relogio;                                                         // Instante CLOCK_MONOTONIC que corresponde ao tempo 0 da simulação
+_Thread_local int indice_thread = -1;                                                   // Índice da thread corrente (0 = controladora, veículos a partir de 1)
+_Thread_local double instante_evento = -1;                                              // Instante da última aquisição gravada ou reproduzida pela thread (-1 = relógio)
+bool reproduzindo = false;                                                              // Relógio guiado pela gravação (--reproduzir): dormir_ate() não espera
+MetricasCompartilhadas *metricas_shm = NULL;                                            // Página mapeada do segmento de métricas (NULL se a publicação está desligada)
+Metricas metricas;                                                                      // Contadores atômicos lidos pelos exportadores
+double espera_maxima = ESPERA_MAXIMA;                                                   // Alvo de espera máxima em vigor (--espera-maxima)
+ModeloVerde modelo_verde = VERDE_VAZAO;                                                 // Modelo de tempo de verde em vigor (--verde)
+PoliticaControle politica = POLITICA_DEMANDA;                                           // Política de escolha do eixo em vigor (--politica)
+double escala_tempo = 1;                                                                // Segundos de simulação por segundo real (--escala)
+double intervalo_saturacao = INTERVALO_SATURACAO;                                       // Intervalo entre entradas da mesma faixa (--saturacao; 0 = sem limite)
+int num_faixas[NUM_DIRECOES] = {FAIXAS_NS, FAIXAS_NS, FAIXAS_LO, FAIXAS_LO};            // Faixas em uso em cada direção (--faixas)
+VeiculoArgs args_veiculos[MAX_VEICULOS];                                                // Argumentos de cada thread de veículo, preenchidos pela main antes de criá-las
+size_t pilha_threads = PILHA_THREADS * 1024;                                            // Pilha das threads da simulação em bytes (--pilha; 0 = padrão)
+struct timespec inicio_partida;                                                         // Instante (CLOCK_MONOTONIC) em que a main começou a criar as threads
+double partida_ms = 0;                                                                  // Tempo gasto pela main criando as threads da simulação
+_Atomic int veiculos_iniciados = 0;                                                     // Threads de veículos que já começaram a executar
+_Atomic uint64_t prontos_us = 0;                                                        // Do início da criação até a última thread de veículo começar
+int nivel_log = NIVEL_LOG_COMPILADO;                                                    // Nível de log em vigor (--log), limitado a NIVEL_LOG_COMPILADO
+const char* nome_nivel_log[] = {"nenhum", "avisos", "controle", "veiculos"};
+bool afinidade = false;                                                                 // Fixar as threads de cada cruzamento em um nó NUMA (--afinidade)
+cpu_set_t processadores_no[MAX_NOS_NUMA];                                               // Processadores permitidos de cada nó com algum processador
+int num_nos = 0;                                                                        // Nós em processadores_no
+
+/**
+ * @brief Cria (ou reaproveita) o segmento de memória compartilhada das métricas e o mapeia em 'metricas_shm'.
+ *
+ * @return int 0 em caso de sucesso, -1 em caso de erro (a simulação segue sem publicar)
+ */
+int iniciar_metricas_shm(void){
+    int fd;
+    void *pagina;
+
+    fd = shm_open(NOME_SHM_METRICAS, O_CREAT | O_RDWR, 0644);
+    if(fd < 0){
+        perror("shm_open");
+        return -1;
+    }
+    if(ftruncate(fd, sizeof(MetricasCompartilhadas)) < 0){
+        perror("ftruncate");
+        close(fd);
+        return -1;
+    }
+    pagina = mmap(NULL, sizeof(MetricasCompartilhadas), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(pagina == MAP_FAILED){
+        perror("mmap");
+        return -1;
+    }
+
+    metricas_shm = pagina;
+    memset(metricas_shm, 0, sizeof(MetricasCompartilhadas));
+    metricas_shm->versao = VERSAO_SHM_METRICAS;
+    return 0;
+}
+
+/**
+ * @brief Copia os contadores do cruzamento para a página compartilhada usando o protocolo de escrita do seqlock. Deve ser chamada com
+ * c->lock adquirido, o que garante um único escritor. O custo é de algumas dezenas de stores, sem chamadas de sistema. No modo corredor
+ * a página mostra o primeiro cruzamento (as travessias continuam somadas sobre o corredor).
+ *
+ */
+void publicar_metricas(Cruzamento *c){
+    int i;
+    uint32_t seq;
+
+    if(metricas_shm == NULL || c->indice != 0) return;
+
+    seq = atomic_load_explicit(&metricas_shm->sequencia, memory_order_relaxed);
+    atomic_store_explicit(&metricas_shm->sequencia, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);     // A sequência ímpar fica visível antes de qualquer campo novo
+
+    for(i = 0; i < NUM_DIRECOES; i++){
+        metricas_shm->carros_esperando[i] = c->carros_esperando[i];
+        metricas_shm->ambulancias_esperando[i] = c->ambulancias_esperando[i];
+        metricas_shm->travessias_carros[i] = atomic_load_explicit(&metricas.travessias[TIPO_CARRO][i], memory_order_relaxed);
+        metricas_shm->travessias_ambulancias[i] = atomic_load_explicit(&metricas.travessias[TIPO_AMBULANCIA][i], memory_order_relaxed);
+    }
+    metricas_shm->carros_no_cruzamento = c->carros_no_cruzamento;
+    metricas_shm->ambulancias_no_cruzamento = c->ambulancias_no_cruzamento;
+    metricas_shm->estado_atual = c->estado_atual;
+    metricas_shm->modo_emergencia = c->modo_emergencia;
+    metricas_shm->inicio_fase_ns = (int64_t) c->inicio_fase.tv_sec * 1000000000 + c->inicio_fase.tv_nsec;
+
+    atomic_store_explicit(&metricas_shm->sequencia, seq + 2, memory_order_release);
+}
+
+/**
+ * @brief Relógio de parede da simulação: segundos decorridos desde 'origem_relogio', multiplicados por 'escala_tempo'. Ao restaurar um
+ * checkpoint a origem é recuada para que o relógio continue do instante salvo, e todos os prazos absolutos guardados nos veículos e na
+ * controladora continuam válidos.
+ *
+ */
+double tempo_relogio(void){
+    struct timespec agora;
+
+    clock_gettime(CLOCK_MONOTONIC, &agora);
+    return ((agora.tv_sec - origem_relogio.tv_sec) + (agora.tv_nsec - origem_relogio.tv_nsec) / 1e9) * escala_tempo;
+}
+
+/**
+ * @brief Relógio da simulação. Com a gravação ou a reprodução ligada, uma thread vê o instante da sua última aquisição de lock gravada
+ * (ver gravar_evento() e consumir_vez()) em vez do relógio de parede: toda decisão tomada sob o lock usa o instante que está no arquivo,
+ * e a reprodução toma as mesmas decisões que a execução gravada.
+ *
+ */
+double tempo_simulacao(void){
+    return instante_evento >= 0 ? instante_evento : tempo_relogio();
+}
+
+/**
+ * @brief Dorme até o instante 'prazo' do relógio da simulação (retorna imediatamente se ele já passou). Na reprodução não dorme: a
+ * ordem e o instante de cada aquisição vêm da gravação.
+ *
+ */
+void dormir_ate(double prazo){
+    struct timespec alvo;
+    double segundos = prazo > 0 ? prazo / escala_tempo : 0;
+
+    if(reproduzindo) return;
+    alvo.tv_sec = origem_relogio.tv_sec + (time_t) segundos;
+    alvo.tv_nsec = origem_relogio.tv_nsec + (long) ((segundos - (time_t) segundos) * 1e9);
+    if(alvo.tv_nsec >= 1000000000L){
+        alvo.tv_sec++;
+        alvo.tv_nsec -= 1000000000L;
+    }
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &alvo, NULL) != 0);
+}
+
+/**
+ * @brief Gerador pseudoaleatório xorshift64* com estado por veículo. Substitui rand() (que exigia um mutex global) e faz parte do
+ * checkpoint, de modo que uma simulação restaurada sorteia os mesmos tempos que a original sorteria.
+ *
+ * @return int valor uniforme em [minimo, minimo + faixa)
+ */
+int sortear(uint64_t *semente, int minimo, int faixa){
+    *semente ^= *semente >> 12;
+    *semente ^= *semente << 25;
+    *semente ^= *semente >> 27;
+    return minimo + (int) (((*semente * 0x2545F4914F6CDD1DULL) >> 33) % (uint64_t) faixa);
+}
+
+/**
+ * @brief Deriva a semente de um veículo a partir da semente global da execução (splitmix64), garantindo estados distintos e não nulos.
+ *
+ */
+uint64_t semente_veiculo(uint64_t semente_global, int indice){
+    uint64_t z = semente_global + (uint64_t) (indice + 1) * 0x9E3779B97F4A7C15ULL;
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return z != 0 ? z : 1;
+}
+
+/**
+ * @brief Numera os veículos ainda sem id (todos, menos os restaurados de um checkpoint), na ordem de veiculos[], pelos contadores de cada
+ * tipo e direção do primeiro cruzamento, que numeram o corredor inteiro. Chamada pela main antes de criar as threads, substitui o lock
+ * que cada veículo adquiria ao partir só para ler e incrementar o seu contador: com milhares de veículos partindo ao mesmo tempo, esse
+ * lock serializava a partida.
+ *
+ */
+void atribuir_ids(void){
+    Veiculo *v;
+    int i;
+
+    for(i = 0; i < total_veiculos; i++){
+        v = &veiculos[i];
+        if(v->id != 0) continue;
+        v->id = (v->tipo == TIPO_CARRO) ? cruzamentos[0].contadores_id_carros[v->direcao]++ : cruzamentos[0].contadores_id_ambulancias[v->direcao]++;
+    }
+}
+
+/**
+ * @brief Conta a partida da thread de veículo corrente. A última a partir registra o tempo desde o início da criação das threads
+ * (prontos_ms no RESUMO).
+ *
+ */
+void registrar_partida(void){
+    struct timespec agora;
+
+    if(atomic_fetch_add_explicit(&veiculos_iniciados, 1, memory_order_relaxed) + 1 != total_veiculos) return;
+    clock_gettime(CLOCK_MONOTONIC, &agora);
+    atomic_store_explicit(&prontos_us, (uint64_t) ((agora.tv_sec - inicio_partida.tv_sec) * 1000000
+        + (agora.tv_nsec - inicio_partida.tv_nsec) / 1000), memory_order_relaxed);
+}
+
+/**
+ * @brief Contabiliza, de forma atômica, um veículo que acabou de sair da fila de espera e entrar no cruzamento.
+ *
+ * @param tipo tipo do veículo
+ * @param dir direção de origem
+ * @param chegada instante (relógio da simulação) em que o veículo entrou na fila
+ */
+void registrar_entrada(TipoVeiculo tipo, Direcao dir, double chegada){
+    int faixa;
+    double espera;
+    uint64_t espera_us, maior;
+
+    espera = tempo_simulacao() - chegada;
+    espera_us = (uint64_t) (espera * 1e6);
+    for(faixa = 0; faixa < NUM_FAIXAS_ESPERA - 1 && espera > limites_espera[faixa]; faixa++);
+
+    atomic_fetch_add_explicit(&metricas.entradas[tipo][dir], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&metricas.espera_faixas[tipo][faixa], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&metricas.espera_soma_us[tipo], espera_us, memory_order_relaxed);
+
+    // Máximo atômico: só tenta escrever enquanto a nova espera superar a maior registrada
+    maior = atomic_load_explicit(&metricas.espera_maxima_us[tipo][dir], memory_order_relaxed);
+    while(espera_us > maior && !atomic_compare_exchange_weak_explicit(&metricas.espera_maxima_us[tipo][dir], &maior, espera_us,
+        memory_order_relaxed, memory_order_relaxed));
+}
+
+/**
+ * @brief Cruzamento em que começa o percurso de um carro. Os carros Leste-Oeste percorrem o corredor inteiro: quem vem do Oeste começa no
+ * cruzamento 0 e quem vem do Leste no último. Os carros Norte-Sul só atravessam o cruzamento 'indice', onde estão.
+ *
+ */
+int primeiro_cruzamento(int indice, Direcao dir){
+    if(controle_eixo(dir) == FLUXO_NS) return indice;
+    return (dir == OESTE) ? 0 : num_cruzamentos - 1;
+}
+
+/**
+ * @brief Cruzamento seguinte no percurso de um carro que acabou de atravessar o cruzamento 'indice', ou -1 se o percurso terminou
+ *
+ */
+int proximo_cruzamento(int indice, Direcao dir){
+    if(controle_eixo(dir) == FLUXO_NS) return -1;
+    indice += (dir == OESTE) ? 1 : -1;
+    return (indice >= 0 && indice < num_cruzamentos) ? indice : -1;
+}
+
+/**
+ * @brief Põe o carro 'v' no fim da fila da faixa 'faixa' (índice FAIXA(direcao, faixa)). A fila é uma lista encadeada pelos próprios
+ * veículos (Veiculo.seguinte), sem memória adicional. Deve ser chamada com c->lock adquirido.
+ *
+ */
+void entrar_fila(Cruzamento *c, int faixa, Veiculo *v){
+    int indice = (int) (v - veiculos);
+
+    v->seguinte = -1;
+    if(c->cauda_faixa[faixa] < 0) c->cabeca_faixa[faixa] = indice;
+    else veiculos[c->cauda_faixa[faixa]].seguinte = indice;
+    c->cauda_faixa[faixa] = indice;
+    c->fila_faixa[faixa]++;
+}
+
+/**
+ * @brief Retira o primeiro carro da fila da faixa 'faixa'. Deve ser chamada com c->lock adquirido.
+ *
+ */
+void sair_fila(Cruzamento *c, int faixa){
+    c->cabeca_faixa[faixa] = veiculos[c->cabeca_faixa[faixa]].seguinte;
+    if(c->cabeca_faixa[faixa] < 0) c->cauda_faixa[faixa] = -1;
+    c->fila_faixa[faixa]--;
+}
+
+/**
+ * @brief Acorda apenas o primeiro carro da fila da faixa 'faixa', o único que pode entrar por ela. Deve ser chamada com c->lock
+ * adquirido.
+ *
+ */
+void acordar_faixa(Cruzamento *c, int faixa){
+    if(c->cabeca_faixa[faixa] >= 0) pthread_cond_signal(&veiculos[c->cabeca_faixa[faixa]].vez);
+}
+
+/**
+ * @brief Detector de starvation: idade do carro que espera há mais tempo em um dos eixos (Norte-Sul ou Leste-Oeste) do cruzamento 'c'.
+ * As filas das faixas estão em ordem de chegada, então basta olhar o primeiro carro de cada faixa, sem percorrer veiculos[]. Deve ser
+ * chamada com c->lock.
+ *
+ * @param fluxo FLUXO_NS ou FLUXO_LO
+ * @param agora instante atual do relógio da simulação
+ * @return double idade, em segundos, do carro mais antigo na fila do eixo (0 se não há carros esperando)
+ */
+double espera_mais_antiga(Cruzamento *c, EstadoFluxo fluxo, double agora){
+    Direcao dir;
+    int f, cabeca;
+    double maior = 0;
+
+    for(dir = NORTE; dir < NUM_DIRECOES; dir++){
+        if(controle_eixo(dir) != fluxo) continue;
+        for(f = 0; f < num_faixas[dir]; f++){
+            cabeca = c->cabeca_faixa[FAIXA(dir, f)];
+            if(cabeca >= 0 && agora - veiculos[cabeca].chegada > maior) maior = agora - veiculos[cabeca].chegada;
+        }
+    }
+    return maior;
+}
+
+/**
+ * @brief Imprime, ao encerrar, uma linha de resumo no formato chave=valor com os indicadores usados para comparar configurações da
+ * controladora (ver bench/comparar.sh): travessias de carros, espera média e pior espera dos carros, fração de verde ociosa, carros
+ * deixados na fila por verde encerrado e, para os carros Leste-Oeste, percursos completos do corredor, paradas por percurso e duração
+ * média do percurso, além das faixas de cada eixo.
+ *
+ */
+void relatorio_resumo(void){
+    int d;
+    uint64_t travessias = 0, entradas = 0, pior = 0, espera_us, verdes, verde_us, percursos;
+
+    for(d = 0; d < NUM_DIRECOES; d++){
+        travessias += atomic_load_explicit(&metricas.travessias[TIPO_CARRO][d], memory_order_relaxed);
+        entradas += atomic_load_explicit(&metricas.entradas[TIPO_CARRO][d], memory_order_relaxed);
+        espera_us = atomic_load_explicit(&metricas.espera_maxima_us[TIPO_CARRO][d], memory_order_relaxed);
+        if(espera_us > pior) pior = espera_us;
+    }
+    verdes = atomic_load_explicit(&metricas.verdes, memory_order_relaxed);
+    verde_us = atomic_load_explicit(&metricas.verde_us, memory_order_relaxed);
+    percursos = atomic_load_explicit(&metricas.percursos, memory_order_relaxed);
+
+    printf("RESUMO politica=%s verde=%s travessias=%llu espera_media=%.3f espera_pior=%.3f verde_ocioso=%.3f fila_residual=%.3f "
+        "corredor=%d coordenado=%s percursos=%llu paradas_por_percurso=%.3f percurso_medio=%.3f faixas=%d,%d partida_ms=%.3f prontos_ms=%.3f\n",
+        nome_politica[politica], nome_modelo_verde[modelo_verde], (unsigned long long) travessias,
+        entradas > 0 ? atomic_load_explicit(&metricas.espera_soma_us[TIPO_CARRO], memory_order_relaxed) / 1e6 / entradas : 0, pior / 1e6,
+        verde_us > 0 ? (double) atomic_load_explicit(&metricas.verde_ocioso_us, memory_order_relaxed) / verde_us : 0,
+        verdes > 0 ? (double) atomic_load_explicit(&metricas.fila_residual, memory_order_relaxed) / verdes : 0,
+        num_cruzamentos, corredor_coordenado ? "sim" : "nao", (unsigned long long) percursos,
+        percursos > 0 ? (double) atomic_load_explicit(&metricas.percurso_paradas, memory_order_relaxed) / percursos : 0,
+        percursos > 0 ? atomic_load_explicit(&metricas.percurso_us, memory_order_relaxed) / 1e6 / percursos : 0,
+        num_faixas[NORTE], num_faixas[LESTE], partida_ms, atomic_load_explicit(&prontos_us, memory_order_relaxed) / 1e3);
+    fflush(stdout);
+}
+
+/**
+ * @brief Imprime a maior espera observada em cada direção e quantas decisões foram forçadas pelo alvo de espera máxima, que a pior espera
+ * pode ultrapassar (ver cruzamento.h). Chamada pela main ao encerrar.
+ *
+ */
+void relatorio_espera(void){
+    int d;
+
+    if(espera_maxima > 0) printf("---------------- ESPERA MAXIMA ALVO: %.0fs (%llu INTERVENCAO(OES)) ----------------\n", espera_maxima,
+        (unsigned long long) atomic_load_explicit(&metricas.intervencoes_espera, memory_order_relaxed));
+    else printf("---------------- ESPERA MAXIMA ALVO: DESLIGADO ----------------\n");
+    for(d = 0; d < NUM_DIRECOES; d++){
+        printf("  %-6s pior espera: carros %6.1fs, ambulancias %6.1fs\n", nome_direcao[d],
+            atomic_load_explicit(&metricas.espera_maxima_us[TIPO_CARRO][d], memory_order_relaxed) / 1e6,
+            atomic_load_explicit(&metricas.espera_maxima_us[TIPO_AMBULANCIA][d], memory_order_relaxed) / 1e6);
+    }
+    fflush(stdout);
+}
+
+/**
+ * @brief Escreve todas as métricas no formato texto de exposição do Prometheus (versão 0.0.4). As leituras são atômicas e relaxadas:
+ * cada valor é individualmente consistente, o que é o esperado para amostragem periódica.
+ *
+ * @param saida arquivo (ou stream de memória) de destino
+ */
+void escrever_prometheus(FILE *saida){
+    int t, d, f;
+    uint64_t chegadas, entradas, travessias, acumulado, fluxo_ns, fluxo_lo;
+
+    fprintf(saida, "# HELP cruzamento_fila_veiculos Veiculos esperando para entrar no cruzamento.\n");
+    fprintf(saida, "# TYPE cruzamento_fila_veiculos gauge\n");
+    for(t = 0; t < NUM_TIPOS; t++){
+        for(d = 0; d < NUM_DIRECOES; d++){
+            chegadas = atomic_load_explicit(&metricas.chegadas[t][d], memory_order_relaxed);
+            entradas = atomic_load_explicit(&metricas.entradas[t][d], memory_order_relaxed);
+            fprintf(saida, "cruzamento_fila_veiculos{direcao=\"%s\",tipo=\"%s\"} %llu\n", nome_direcao[d], nome_tipo[t],
+                (unsigned long long) (chegadas > entradas ? chegadas - entradas : 0));
+        }
+    }
+
+    fprintf(saida, "# HELP cruzamento_ocupacao_veiculos Veiculos dentro do cruzamento.\n");
+    fprintf(saida, "# TYPE cruzamento_ocupacao_veiculos gauge\n");
+    for(t = 0; t < NUM_TIPOS; t++){
+        entradas = travessias = 0;
+        for(d = 0; d < NUM_DIRECOES; d++){
+            entradas += atomic_load_explicit(&metricas.entradas[t][d], memory_order_relaxed);
+            travessias += atomic_load_explicit(&metricas.travessias[t][d], memory_order_relaxed);
+        }
+        fprintf(saida, "cruzamento_ocupacao_veiculos{tipo=\"%s\"} %llu\n", nome_tipo[t],
+            (unsigned long long) (entradas > travessias ? entradas - travessias : 0));
+    }
+
+    fprintf(saida, "# HELP cruzamento_travessias_total Travessias concluidas por direcao de origem.\n");
+    fprintf(saida, "# TYPE cruzamento_travessias_total counter\n");
+    for(t = 0; t < NUM_TIPOS; t++){
+        for(d = 0; d < NUM_DIRECOES; d++){
+            fprintf(saida, "cruzamento_travessias_total{direcao=\"%s\",tipo=\"%s\"} %llu\n", nome_direcao[d], nome_tipo[t],
+                (unsigned long long) atomic_load_explicit(&metricas.travessias[t][d], memory_order_relaxed));
+        }
+    }
+
+    fprintf(saida, "# HELP cruzamento_travessias_fluxo_total Travessias concluidas por fluxo (NS ou LO).\n");
+    fprintf(saida, "# TYPE cruzamento_travessias_fluxo_total counter\n");
+    for(t = 0; t < NUM_TIPOS; t++){
+        fluxo_ns = atomic_load_explicit(&metricas.travessias[t][NORTE], memory_order_relaxed)
+                 + atomic_load_explicit(&metricas.travessias[t][SUL], memory_order_relaxed);
+        fluxo_lo = atomic_load_explicit(&metricas.travessias[t][LESTE], memory_order_relaxed)
+                 + atomic_load_explicit(&metricas.travessias[t][OESTE], memory_order_relaxed);
+        fprintf(saida, "cruzamento_travessias_fluxo_total{fluxo=\"NS\",tipo=\"%s\"} %llu\n", nome_tipo[t], (unsigned long long) fluxo_ns);
+        fprintf(saida, "cruzamento_travessias_fluxo_total{fluxo=\"LO\",tipo=\"%s\"} %llu\n", nome_tipo[t], (unsigned long long) fluxo_lo);
+    }
+
+    fprintf(saida, "# HELP cruzamento_trocas_fase_total Numero de vezes que cada estado do cruzamento foi aberto.\n");
+    fprintf(saida, "# TYPE cruzamento_trocas_fase_total counter\n");
+    for(f = 0; f < 4; f++){
+        fprintf(saida, "cruzamento_trocas_fase_total{estado=\"%s\"} %llu\n", nome_estado[f],
+            (unsigned long long) atomic_load_explicit(&metricas.trocas_fase[f], memory_order_relaxed));
+    }
+
+    fprintf(saida, "# HELP cruzamento_emergencias_total Ativacoes do modo emergencia.\n");
+    fprintf(saida, "# TYPE cruzamento_emergencias_total counter\n");
+    fprintf(saida, "cruzamento_emergencias_total %llu\n", (unsigned long long) atomic_load_explicit(&metricas.emergencias, memory_order_relaxed));
+
+    fprintf(saida, "# HELP cruzamento_violacoes_total Violacoes de invariantes de seguranca detectadas (apenas com --verificar).\n");
+    fprintf(saida, "# TYPE cruzamento_violacoes_total counter\n");
+    fprintf(saida, "cruzamento_violacoes_total %llu\n", (unsigned long long) atomic_load_explicit(&metricas.violacoes, memory_order_relaxed));
+
+    fprintf(saida, "# HELP cruzamento_intervencoes_espera_total Decisoes da controladora forcadas pelo alvo de espera maxima.\n");
+    fprintf(saida, "# TYPE cruzamento_intervencoes_espera_total counter\n");
+    fprintf(saida, "cruzamento_intervencoes_espera_total %llu\n",
+        (unsigned long long) atomic_load_explicit(&metricas.intervencoes_espera, memory_order_relaxed));
+
+    fprintf(saida, "# HELP cruzamento_verdes_total Fluxos de carros abertos e encerrados.\n");
+    fprintf(saida, "# TYPE cruzamento_verdes_total counter\n");
+    fprintf(saida, "cruzamento_verdes_total %llu\n", (unsigned long long) atomic_load_explicit(&metricas.verdes, memory_order_relaxed));
+
+    fprintf(saida, "# HELP cruzamento_verde_segundos_total Tempo total de verde para carros.\n");
+    fprintf(saida, "# TYPE cruzamento_verde_segundos_total counter\n");
+    fprintf(saida, "cruzamento_verde_segundos_total %.6f\n", atomic_load_explicit(&metricas.verde_us, memory_order_relaxed) / 1e6);
+
+    fprintf(saida, "# HELP cruzamento_verde_ocioso_segundos_total Tempo de verde apos a ultima entrada de carro.\n");
+    fprintf(saida, "# TYPE cruzamento_verde_ocioso_segundos_total counter\n");
+    fprintf(saida, "cruzamento_verde_ocioso_segundos_total %.6f\n", atomic_load_explicit(&metricas.verde_ocioso_us, memory_order_relaxed) / 1e6);
+
+    fprintf(saida, "# HELP cruzamento_fila_residual_total Carros deixados na fila do eixo aberto ao fim de cada verde.\n");
+    fprintf(saida, "# TYPE cruzamento_fila_residual_total counter\n");
+    fprintf(saida, "cruzamento_fila_residual_total %llu\n", (unsigned long long) atomic_load_explicit(&metricas.fila_residual, memory_order_relaxed));
+
+    fprintf(saida, "# HELP cruzamento_vazao_carros_por_segundo Vazao medida de cada eixo usada pelo modelo de verde.\n");
+    fprintf(saida, "# TYPE cruzamento_vazao_carros_por_segundo gauge\n");
+    fprintf(saida, "cruzamento_vazao_carros_por_segundo{fluxo=\"NS\"} %.3f\n", atomic_load_explicit(&metricas.vazao_mcps[FLUXO_NS], memory_order_relaxed) / 1e3);
+    fprintf(saida, "cruzamento_vazao_carros_por_segundo{fluxo=\"LO\"} %.3f\n", atomic_load_explicit(&metricas.vazao_mcps[FLUXO_LO], memory_order_relaxed) / 1e3);
+
+    fprintf(saida, "# HELP cruzamento_paradas_total Chegadas a fila que nao encontraram a passagem aberta.\n");
+    fprintf(saida, "# TYPE cruzamento_paradas_total counter\n");
+    for(t = 0; t < NUM_TIPOS; t++){
+        for(d = 0; d < NUM_DIRECOES; d++){
+            fprintf(saida, "cruzamento_paradas_total{direcao=\"%s\",tipo=\"%s\"} %llu\n", nome_direcao[d], nome_tipo[t],
+                (unsigned long long) atomic_load_explicit(&metricas.paradas[t][d], memory_order_relaxed));
+        }
+    }
+
+    fprintf(saida, "# HELP cruzamento_percursos_total Percursos completos do corredor pelos carros Leste-Oeste.\n");
+    fprintf(saida, "# TYPE cruzamento_percursos_total counter\n");
+    fprintf(saida, "cruzamento_percursos_total %llu\n", (unsigned long long) atomic_load_explicit(&metricas.percursos, memory_order_relaxed));
+
+    fprintf(saida, "# HELP cruzamento_percurso_segundos_total Duracao somada dos percursos completos do corredor.\n");
+    fprintf(saida, "# TYPE cruzamento_percurso_segundos_total counter\n");
+    fprintf(saida, "cruzamento_percurso_segundos_total %.6f\n", atomic_load_explicit(&metricas.percurso_us, memory_order_relaxed) / 1e6);
+
+    fprintf(saida, "# HELP cruzamento_percurso_paradas_total Paradas somadas dos percursos completos do corredor.\n");
+    fprintf(saida, "# TYPE cruzamento_percurso_paradas_total counter\n");
+    fprintf(saida, "cruzamento_percurso_paradas_total %llu\n",
+        (unsigned long long) atomic_load_explicit(&metricas.percurso_paradas, memory_order_relaxed));
+
+    fprintf(saida, "# HELP cruzamento_espera_maxima_segundos Maior espera ja observada por direcao de origem.\n");
+    fprintf(saida, "# TYPE cruzamento_espera_maxima_segundos gauge\n");
+    for(t = 0; t < NUM_TIPOS; t++){
+        for(d = 0; d < NUM_DIRECOES; d++){
+            fprintf(saida, "cruzamento_espera_maxima_segundos{direcao=\"%s\",tipo=\"%s\"} %.6f\n", nome_direcao[d], nome_tipo[t],
+                atomic_load_explicit(&metricas.espera_maxima_us[t][d], memory_order_relaxed) / 1e6);
+        }
+    }
+
+    fprintf(saida, "# HELP cruzamento_espera_segundos Tempo entre entrar na fila e entrar no cruzamento.\n");
+    fprintf(saida, "# TYPE cruzamento_espera_segundos histogram\n");
+    for(t = 0; t < NUM_TIPOS; t++){
+        acumulado = 0;
+        for(f = 0; f < NUM_FAIXAS_ESPERA; f++){
+            acumulado += atomic_load_explicit(&metricas.espera_faixas[t][f], memory_order_relaxed);
+            if(f < NUM_FAIXAS_ESPERA - 1)
+                fprintf(saida, "cruzamento_espera_segundos_bucket{tipo=\"%s\",le=\"%g\"} %llu\n", nome_tipo[t], limites_espera[f], (unsigned long long) acumulado);
+            else
+                fprintf(saida, "cruzamento_espera_segundos_bucket{tipo=\"%s\",le=\"+Inf\"} %llu\n", nome_tipo[t], (unsigned long long) acumulado);
+        }
+        fprintf(saida, "cruzamento_espera_segundos_sum{tipo=\"%s\"} %.6f\n", nome_tipo[t],
+            atomic_load_explicit(&metricas.espera_soma_us[t], memory_order_relaxed) / 1e6);
+        fprintf(saida, "cruzamento_espera_segundos_count{tipo=\"%s\"} %llu\n", nome_tipo[t], (unsigned long long) acumulado);
+    }
+}
+
+/**
+ * @brief Envia 'tamanho' bytes pelo socket, repetindo send() até enviar tudo (envios parciais) ou falhar. Usa MSG_NOSIGNAL: um coletor
+ * que fecha a conexão no meio da resposta faz send() falhar com EPIPE, em vez de o SIGPIPE encerrar o simulador inteiro.
+ *
+ * @return int 0 em caso de sucesso, -1 em caso de erro (errno de send())
+ */
+int enviar_tudo(int socket, const char *dados, size_t tamanho){
+    ssize_t enviados;
+
+    while(tamanho > 0){
+        enviados = send(socket, dados, tamanho, MSG_NOSIGNAL);
+        if(enviados < 0){
+            if(errno == EINTR) continue;
+            return -1;
+        }
+        dados += enviados;
+        tamanho -= (size_t) enviados;
+    }
+    return 0;
+}
+
+/**
+ * @brief Função da Thread exportadora de métricas Prometheus. O destino pode ser:
+ *      - um caminho de arquivo: reescrito a cada INTERVALO_PROMETHEUS segundos (via arquivo temporário + rename, para que o leitor,
+ * por exemplo o textfile collector do node_exporter, nunca veja um arquivo pela metade);
+ *      - ":PORTA": um socket TCP em 127.0.0.1 que responde a cada conexão (uma requisição HTTP de coleta) com as métricas atuais.
+ *
+ * @param arg string (const char*) com o destino
+ * @return void* Sempre retorna NULL
+ */
+void * exportador_prometheus(void *arg){
+    const char *destino = (const char*) arg;
+    char caminho_tmp[512], requisicao[1024], cabecalho[128];
+    char *corpo;
+    size_t tamanho;
+    FILE *arquivo;
+    int servidor, cliente, opcao = 1, tamanho_cabecalho;
+    struct sockaddr_in endereco;
+    struct pollfd espera;
+
+    if(destino[0] == ':'){
+        servidor = socket(AF_INET, SOCK_STREAM, 0);
+        if(servidor < 0){
+            perror("exportador prometheus");
+            return NULL;
+        }
+        memset(&endereco, 0, sizeof(endereco));
+        endereco.sin_family = AF_INET;
+        endereco.sin_port = htons((uint16_t) atoi(destino + 1));
+        endereco.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if(setsockopt(servidor, SOL_SOCKET, SO_REUSEADDR, &opcao, sizeof(opcao)) < 0) perror("exportador prometheus: SO_REUSEADDR");
+        if(bind(servidor, (struct sockaddr*) &endereco, sizeof(endereco)) < 0 || listen(servidor, 8) < 0){
+            perror("exportador prometheus");
+            close(servidor);
+            return NULL;
+        }
+
+        while(1){
+            cliente = accept(servidor, NULL, NULL);
+            if(cliente < 0) continue;
+
+            // Consome a requisição (o conteúdo é irrelevante: qualquer caminho devolve as métricas)
+            espera.fd = cliente;
+            espera.events = POLLIN;
+            if(poll(&espera, 1, 1000) > 0 && read(cliente, requisicao, sizeof(requisicao)) < 0){
+                close(cliente);
+                continue;
+            }
+
+            arquivo = open_memstream(&corpo, &tamanho);
+            if(arquivo == NULL){
+                perror("exportador prometheus");
+                close(cliente);
+                continue;
+            }
+            escrever_prometheus(arquivo);
+            fclose(arquivo);
+            // Um coletor que desiste no meio da resposta só encerra a sua conexão
+            tamanho_cabecalho = snprintf(cabecalho, sizeof(cabecalho),
+                "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %zu\r\n\r\n", tamanho);
+            if(enviar_tudo(cliente, cabecalho, (size_t) tamanho_cabecalho) < 0 || enviar_tudo(cliente, corpo, tamanho) < 0){
+                perror("exportador prometheus");
+            }
+            free(corpo);
+            close(cliente);
+        }
+    }
+
+    snprintf(caminho_tmp, sizeof(caminho_tmp), "%s.tmp", destino);
+    while(1){
+        arquivo = fopen(caminho_tmp, "w");
+        if(arquivo != NULL){
+            escrever_prometheus(arquivo);
+            fclose(arquivo);
+            if(rename(caminho_tmp, destino) < 0) perror("exportador prometheus");
+        }
+        else perror("exportador prometheus");
+        sleep(INTERVALO_PROMETHEUS);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Modo monitor: processo externo que lê a página de métricas publicada por uma simulação em execução e imprime um resumo
+ * periódico. Usa apenas o protocolo de leitura do seqlock, sem nenhuma sincronização com o simulador.
+ *
+ * @param intervalo_ms intervalo entre leituras, em milissegundos
+ * @return int 0 em caso de sucesso, 1 se o segmento não existir
+ */
+int monitorar_metricas(int intervalo_ms){
+    int fd, i;
+    uint32_t seq_inicio, seq_fim;
+    const MetricasCompartilhadas *pagina;
+    MetricasCompartilhadas copia;
+    struct timespec agora, pausa = {intervalo_ms / 1000, (intervalo_ms % 1000) * 1000000L};
+    double idade_fase;
+
+    fd = shm_open(NOME_SHM_METRICAS, O_RDONLY, 0);
+    if(fd < 0){
+        perror("shm_open (o simulador foi iniciado com --shm?)");
+        return 1;
+    }
+    pagina = mmap(NULL, sizeof(MetricasCompartilhadas), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(pagina == MAP_FAILED){
+        perror("mmap");
+        return 1;
+    }
+
+    while(1){
+        // Protocolo de leitura do seqlock: repete enquanto houver escrita em andamento ou a sequência mudar durante a cópia
+        do{
+            seq_inicio = atomic_load_explicit(&pagina->sequencia, memory_order_acquire);
+            memcpy(&copia, (const void*) pagina, sizeof(copia));
+            atomic_thread_fence(memory_order_acquire);
+            seq_fim = atomic_load_explicit(&pagina->sequencia, memory_order_relaxed);
+        } while((seq_inicio & 1) || seq_inicio != seq_fim);
+
+        if(copia.versao != VERSAO_SHM_METRICAS){
+            fprintf(stderr, "Versao de metricas incompativel (%u)\n", copia.versao);
+            return 1;
+        }
+
+        clock_gettime(CLOCK_REALTIME, &agora);
+        idade_fase = (agora.tv_sec + agora.tv_nsec / 1e9) - copia.inicio_fase_ns / 1e9;
+
+        printf("[%s ha %.1fs%s] no cruzamento: %d carro(s), %d ambulancia(s) |", nome_estado[copia.estado_atual], idade_fase,
+            copia.modo_emergencia ? ", EMERGENCIA" : "", copia.carros_no_cruzamento, copia.ambulancias_no_cruzamento);
+        for(i = 0; i < NUM_DIRECOES; i++){
+            printf(" %s: fila %d/%d, passaram %llu/%llu |", nome_direcao[i], copia.carros_esperando[i], copia.ambulancias_esperando[i],
+                (unsigned long long) copia.travessias_carros[i], (unsigned long long) copia.travessias_ambulancias[i]);
+        }
+        printf("\n");
+        fflush(stdout);
+        nanosleep(&pausa, NULL);
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Indica se o carro 'v', na faixa 'faixa', pode entrar no cruzamento: o verde da sua direção está aberto e não foi encerrado, a
+ * faixa foi liberada pela controladora e ele é o primeiro da fila da faixa, o que faz a entrada seguir a ordem de chegada. Deve ser
+ * chamada com c->lock adquirido.
+ *
+ */
+bool carro_admitido(Cruzamento *c, Veiculo *v, int faixa){
+    return !c->fluxo_encerrado && controle_pode_passar(c->modo_emergencia, v->direcao, c->estado_atual, TIPO_CARRO) && c->faixa_liberada[faixa]
+        && c->cabeca_faixa[faixa] == (int) (v - veiculos);
+}
+
+/**
+ * @brief Adquire diretamente (sem passar pela gravação do entrelaçamento) o lock de todos os cruzamentos do corredor, sempre na ordem
+ * dos índices, congelando a simulação inteira. As threads da simulação nunca seguram dois desses locks ao mesmo tempo, então a ordem
+ * fixa basta para evitar deadlock entre chamadores de travar_cruzamentos().
+ *
+ */
+void travar_cruzamentos(void){
+    int k;
+
+    for(k = 0; k < num_cruzamentos; k++) pthread_mutex_lock(&cruzamentos[k].lock);
+}
+
+void liberar_cruzamentos(void){
+    int k;
+
+    for(k = num_cruzamentos - 1; k >= 0; k--) pthread_mutex_unlock(&cruzamentos[k].lock);
+}
+
+/**
+ * @brief Tipos de violação detectados pelo verificador de invariantes de segurança
+ *
+ */
+typedef enum{
+    VIOLACAO_CARRO_EM_EMERGENCIA,       // Carro dentro do cruzamento enquanto o estado é AMBULANCIA_*
+    VIOLACAO_OCUPANTE_INCOMPATIVEL,     // Veículo dentro do cruzamento vindo de um eixo diferente do aberto por estado_atual
+    VIOLACAO_CONTADOR_NEGATIVO,         // Algum contador de fila (de direção ou de faixa) ou de ocupação ficou negativo
+    NUM_VIOLACOES
+} TipoViolacao;
+
+const char* nome_violacao[] = {"carro no cruzamento durante emergencia", "ocupante incompativel com o estado atual", "contador negativo"};
+
+/**
+ * @brief Registro de uma violação, com o retrato mínimo do cruzamento no momento em que ela foi detectada
+ *
+ */
+typedef struct{
+    TipoViolacao tipo;
+    double instante;
+    EstadoFluxo estado;
+    TipoVeiculo tipo_veiculo;           // Veículo que disparou a verificação
+    Direcao direcao;
+    bool entrada;                       // true se a verificação foi na entrada, false se na saída
+    int cruzamento;                     // Cruzamento do corredor em que a violação ocorreu
+    int carros_no_cruzamento, ambulancias_no_cruzamento;
+} Violacao;
+
+/**
+ * @brief Buffer de verificação de uma thread. Cada thread só escreve no próprio buffer (indexado por indice_thread) e apenas anota
+ * as violações em memória, sem I/O e sem sincronização extra, já que as verificações ocorrem com o lock do cruzamento adquirido. O
+ * alinhamento em linha de cache evita que buffers de threads vizinhas disputem a mesma linha. O relatório é impresso ao fim da execução.
+ *
+ */
+typedef struct{
+    _Alignas(64) uint64_t verificacoes; // Verificações feitas por esta thread
+    uint64_t violacoes;                 // Violações detectadas (pode exceder o que cabe em 'registros')
+    Violacao registros[VIOLACOES_POR_THREAD];
+} BufferVerificacao;
+
+bool verificacao_ativa = false;                                     // Verificador ligado (--verificar)
+BufferVerificacao buffers_verificacao[MAX_VEICULOS + MAX_CRUZAMENTOS]; // Um buffer por thread da simulação
+int ocupantes[MAX_CRUZAMENTOS][NUM_TIPOS][NUM_DIRECOES];           // Ocupação de cada cruzamento por tipo e direção, mantida pelo verificador
+
+/**
+ * @brief Anota uma violação no buffer da thread corrente.
+ *
+ */
+void anotar_violacao(Cruzamento *c, BufferVerificacao *buffer, TipoViolacao tipo, TipoVeiculo tipo_veiculo, Direcao dir, bool entrada){
+    Violacao *v;
+
+    if(buffer->violacoes < VIOLACOES_POR_THREAD){
+        v = &buffer->registros[buffer->violacoes];
+        v->tipo = tipo;
+        v->instante = tempo_simulacao();
+        v->estado = c->estado_atual;
+        v->tipo_veiculo = tipo_veiculo;
+        v->direcao = dir;
+        v->entrada = entrada;
+        v->cruzamento = c->indice;
+        v->carros_no_cruzamento = c->carros_no_cruzamento;
+        v->ambulancias_no_cruzamento = c->ambulancias_no_cruzamento;
+    }
+    buffer->violacoes++;
+    atomic_fetch_add_explicit(&metricas.violacoes, 1, memory_order_relaxed);
+}
+
+/**
+ * @brief Verifica os invariantes de segurança do cruzamento logo após a entrada ou a saída de um veículo. Deve ser chamada com
+ * o lock do cruzamento adquirido e depois de os contadores terem sido atualizados. Invariantes verificados:
+ *      (a) nenhum carro dentro do cruzamento enquanto o estado é AMBULANCIA_*;
+ *      (b) todos os ocupantes vindos do eixo aberto por estado_atual (ambulâncias podem cruzar junto com os carros do seu eixo);
+ *      (c) nenhum contador de fila ou ocupação negativo.
+ *
+ * @param tipo_veiculo tipo do veículo que entrou ou saiu
+ * @param dir direção de origem do veículo
+ * @param entrada true na entrada no cruzamento, false na saída
+ */
+void verificar_invariantes(Cruzamento *c, TipoVeiculo tipo_veiculo, Direcao dir, bool entrada){
+    BufferVerificacao *buffer;
+    EstadoFluxo estado = c->estado_atual;
+    bool emergencia = (estado == AMBULANCIA_NS || estado == AMBULANCIA_LO);
+    bool eixo_ns = (estado == FLUXO_NS || estado == AMBULANCIA_NS);
+    int t, d, f;
+
+    if(!verificacao_ativa) return;
+
+    buffer = &buffers_verificacao[indice_thread];
+    buffer->verificacoes++;
+    ocupantes[c->indice][tipo_veiculo][dir] += entrada ? 1 : -1;
+
+    if(emergencia && c->carros_no_cruzamento > 0) anotar_violacao(c, buffer, VIOLACAO_CARRO_EM_EMERGENCIA, tipo_veiculo, dir, entrada);
+
+    for(t = 0; t < NUM_TIPOS; t++){
+        for(d = 0; d < NUM_DIRECOES; d++){
+            if(ocupantes[c->indice][t][d] < 0 || c->carros_esperando[d] < 0 || c->ambulancias_esperando[d] < 0){
+                anotar_violacao(c, buffer, VIOLACAO_CONTADOR_NEGATIVO, tipo_veiculo, dir, entrada);
+            }
+            else if(ocupantes[c->indice][t][d] > 0 && (d == NORTE || d == SUL) != eixo_ns){
+                anotar_violacao(c, buffer, VIOLACAO_OCUPANTE_INCOMPATIVEL, (TipoVeiculo) t, (Direcao) d, entrada);
+            }
+        }
+    }
+    if(c->carros_no_cruzamento < 0 || c->ambulancias_no_cruzamento < 0){
+        anotar_violacao(c, buffer, VIOLACAO_CONTADOR_NEGATIVO, tipo_veiculo, dir, entrada);
+    }
+    for(f = 0; f < NUM_DIRECOES * MAX_FAIXAS; f++){
+        if(c->fila_faixa[f] < 0) anotar_violacao(c, buffer, VIOLACAO_CONTADOR_NEGATIVO, tipo_veiculo, dir, entrada);
+    }
+}
+
+/**
+ * @brief Recalcula a ocupação usada pelo verificador a partir do estado dos veículos (na partida ou após restaurar um checkpoint).
+ *
+ */
+void iniciar_verificacao(void){
+    int i;
+
+    memset(ocupantes, 0, sizeof(ocupantes));
+    for(i = 0; i < total_veiculos; i++){
+        if(veiculos[i].estado == VEICULO_ATRAVESSANDO) ocupantes[veiculos[i].cruzamento][veiculos[i].tipo][veiculos[i].direcao]++;
+    }
+    verificacao_ativa = true;
+}
+
+/**
+ * @brief Consolida os buffers de todas as threads e imprime o relatório do verificador. Chamada pela main ao encerrar.
+ *
+ */
+void relatorio_verificacao(void){
+    int i;
+    uint64_t j, verificacoes = 0, violacoes = 0;
+    const Violacao *v;
+
+    if(!verificacao_ativa) return;
+
+    travar_cruzamentos();
+    for(i = 0; i < total_veiculos + num_cruzamentos; i++){
+        verificacoes += buffers_verificacao[i].verificacoes;
+        violacoes += buffers_verificacao[i].violacoes;
+    }
+    printf("---------------- VERIFICADOR: %llu VERIFICACOES, %llu VIOLACOES ----------------\n",
+        (unsigned long long) verificacoes, (unsigned long long) violacoes);
+    for(i = 0; i < total_veiculos + num_cruzamentos; i++){
+        for(j = 0; j < buffers_verificacao[i].violacoes && j < VIOLACOES_POR_THREAD; j++){
+            v = &buffers_verificacao[i].registros[j];
+            printf("  t=%.3fs thread %d: %s (%s %s na %s do cruzamento %d, estado %s, %d carro(s) e %d ambulancia(s) no cruzamento)\n",
+                v->instante, i, nome_violacao[v->tipo], nome_tipo[v->tipo_veiculo], nome_direcao[v->direcao], v->entrada ? "entrada" : "saida",
+                v->cruzamento, nome_estado[v->estado], v->carros_no_cruzamento, v->ambulancias_no_cruzamento);
+        }
+        if(buffers_verificacao[i].violacoes > VIOLACOES_POR_THREAD){
+            printf("  thread %d: mais %llu violacao(oes) nao registradas\n", i,
+                (unsigned long long) (buffers_verificacao[i].violacoes - VIOLACOES_POR_THREAD));
+        }
+    }
+    fflush(stdout);
+    liberar_cruzamentos();
+}
+
+/**
+ * @brief Modos de gravação do entrelaçamento das threads
+ *
+ */
+typedef enum{
+    GRAVACAO_DESLIGADA,
+    GRAVACAO_GRAVAR,                    // Registra a ordem e o instante em que as threads adquirem os locks dos cruzamentos
+    GRAVACAO_REPRODUZIR                 // Força as threads a adquirirem os locks dos cruzamentos na ordem e nos instantes registrados
+} ModoGravacao;
+
+/**
+ * @brief Estado da gravação/reprodução. Cada aquisição do lock de um cruzamento (inclusive a readquirição ao acordar de pode_cruzar) é um
+ * evento identificado pelo índice da thread e pelo instante da simulação em que ocorreu. Todo o estado compartilhado só muda com esse lock
+ * adquirido e, com a gravação ligada, as decisões tomadas sob ele leem o instante do evento (ver tempo_simulacao()); a reprodução força a
+ * mesma ordem de aquisições e devolve a cada thread o mesmo instante, então refaz as mesmas decisões. Os locks dos registros e das
+ * métricas não são gravados: eles não influem nas decisões.
+ *
+ * O arquivo guarda, por evento, um varint LEB128 com o avanço do relógio em microssegundos de simulação (deslocado de um bit) e um bit que
+ * indica que a thread é a mesma do evento anterior; só quando ela muda segue um segundo varint com o índice. O caso comum (a mesma thread
+ * readquirindo o lock logo em seguida) custa um byte. Ao fechar a gravação, o índice 'threads' (inválido) marca o fim dos eventos e é
+ * seguido do total de travessias, que a reprodução confere ao terminar.
+ *
+ */
+typedef struct{
+    ModoGravacao modo;
+    FILE *arquivo;                      // Arquivo da gravação (modo GRAVACAO_GRAVAR)
+    int indice_anterior;                // Thread do evento anterior (-1 se nenhum)
+    uint64_t instante_us;               // Instante do evento anterior, em microssegundos de simulação
+    uint64_t eventos;                   // Total de eventos gravados ou reproduzidos
+    uint16_t *sequencia;                // Índices dos eventos (modo GRAVACAO_REPRODUZIR)
+    uint64_t *instantes;                // Instantes dos eventos, em microssegundos de simulação
+    size_t total, posicao;              // Número de eventos e próximo evento a reproduzir
+    bool conferir;                      // A gravação foi fechada e traz o total de travessias
+    uint64_t travessias;                // Travessias ao fim da gravação
+    pthread_mutex_t lock;               // Protege o arquivo e 'posicao'
+    pthread_cond_t vez;                 // Sinalizada a cada avanço de 'posicao'
+} Gravacao;
+
+Gravacao gravacao = {.modo = GRAVACAO_DESLIGADA, .indice_anterior = -1};
+
+void escrever_varint(FILE *arquivo, uint64_t valor){
+    while(valor >= 0x80){
+        fputc((int) (valor & 0x7f) | 0x80, arquivo);
+        valor >>= 7;
+    }
+    fputc((int) valor, arquivo);
+}
+
+int ler_varint(FILE *arquivo, uint64_t *valor){
+    int byte, deslocamento = 0;
+
+    *valor = 0;
+    do{
+        byte = fgetc(arquivo);
+        if(byte == EOF || deslocamento > 63) return -1;
+        *valor |= (uint64_t) (byte & 0x7f) << deslocamento;
+        deslocamento += 7;
+    } while(byte & 0x80);
+    return 0;
+}
+
+/**
+ * @brief Travessias de carros e ambulâncias concluídas até agora, o total que a reprodução confere com o da gravação
+ *
+ */
+uint64_t total_travessias(void){
+    uint64_t total = 0;
+    int t, d;
+
+    for(t = 0; t < NUM_TIPOS; t++){
+        for(d = 0; d < NUM_DIRECOES; d++) total += atomic_load_explicit(&metricas.travessias[t][d], memory_order_relaxed);
+    }
+    return total;
+}
+
+/**
+ * @brief Abre o arquivo de gravação e escreve o cabeçalho (assinatura, versão e número de threads participantes).
+ *
+ * @return int 0 em caso de sucesso, -1 em caso de erro
+ */
+int iniciar_gravacao(const char *caminho){
+    gravacao.arquivo = fopen(caminho, "wb");
+    if(gravacao.arquivo == NULL){
+        perror(caminho);
+        return -1;
+    }
+    setvbuf(gravacao.arquivo, NULL, _IOFBF, 1 << 16);
+    fwrite(ASSINATURA_GRAVACAO, 1, 4, gravacao.arquivo);
+    fputc(VERSAO_GRAVACAO, gravacao.arquivo);
+    escrever_varint(gravacao.arquivo, (uint64_t) (total_veiculos + num_cruzamentos));
+    pthread_mutex_init(&gravacao.lock, NULL);
+    gravacao.modo = GRAVACAO_GRAVAR;
+    return 0;
+}
+
+/**
+ * @brief Carrega uma gravação e expande os eventos (índice da thread e instante) em memória para a reprodução.
+ *
+ * @return int 0 em caso de sucesso, -1 se o arquivo for inválido, gravado com outra configuração de veículos ou não couber na memória
+ */
+int iniciar_reproducao(const char *caminho){
+    FILE *arquivo;
+    char assinatura[4];
+    uint64_t threads, codigo, indice, instante_us = 0;
+    uint16_t *sequencia;
+    uint64_t *instantes;
+    size_t capacidade = 1024;
+
+    arquivo = fopen(caminho, "rb");
+    if(arquivo == NULL){
+        perror(caminho);
+        return -1;
+    }
+    if(fread(assinatura, 1, 4, arquivo) != 4 || memcmp(assinatura, ASSINATURA_GRAVACAO, 4) != 0 || fgetc(arquivo) != VERSAO_GRAVACAO
+        || ler_varint(arquivo, &threads) < 0 || threads != (uint64_t) (total_veiculos + num_cruzamentos)){
+        fprintf(stderr, "%s: gravacao invalida ou de outra configuracao de veiculos\n", caminho);
+        fclose(arquivo);
+        return -1;
+    }
+
+    gravacao.sequencia = malloc(capacidade * sizeof(uint16_t));
+    gravacao.instantes = malloc(capacidade * sizeof(uint64_t));
+    if(gravacao.sequencia == NULL || gravacao.instantes == NULL){
+        perror("malloc");
+        free(gravacao.sequencia);
+        free(gravacao.instantes);
+        fclose(arquivo);
+        return -1;
+    }
+    gravacao.total = 0;
+    indice = threads + 1;
+    while(ler_varint(arquivo, &codigo) == 0){
+        // Bit 0 ligado: mesma thread do evento anterior; senão o índice vem a seguir
+        if(!(codigo & 1) && ler_varint(arquivo, &indice) < 0) break;
+        if(indice == threads){
+            gravacao.conferir = ler_varint(arquivo, &gravacao.travessias) == 0;
+            break;
+        }
+        if(indice > threads) break;
+        if(gravacao.total == capacidade){
+            capacidade *= 2;
+            sequencia = realloc(gravacao.sequencia, capacidade * sizeof(uint16_t));
+            if(sequencia != NULL) gravacao.sequencia = sequencia;
+            instantes = realloc(gravacao.instantes, capacidade * sizeof(uint64_t));
+            if(instantes != NULL) gravacao.instantes = instantes;
+            if(sequencia == NULL || instantes == NULL){
+                perror("realloc");
+                free(gravacao.sequencia);
+                free(gravacao.instantes);
+                fclose(arquivo);
+                return -1;
+            }
+        }
+        instante_us += codigo >> 1;
+        gravacao.sequencia[gravacao.total] = (uint16_t) indice;
+        gravacao.instantes[gravacao.total++] = instante_us;
+    }
+    fclose(arquivo);
+    if(!gravacao.conferir) fprintf(stderr, "%s: gravacao sem o total de travessias (interrompida?), a reproducao nao sera conferida\n", caminho);
+
+    pthread_mutex_init(&gravacao.lock, NULL);
+    pthread_cond_init(&gravacao.vez, NULL);
+    gravacao.posicao = 0;
+    gravacao.modo = GRAVACAO_REPRODUZIR;
+    reproduzindo = true;
+    LOG_AVISO("---------------- REPRODUZINDO %zu EVENTOS DE %s ----------------\n", gravacao.total, caminho);
+    return 0;
+}
+
+/**
+ * @brief Registra que a thread corrente acabou de adquirir o lock de um cruzamento, no instante lido agora do relógio, e fixa esse
+ * instante como o tempo da thread até a próxima aquisição. No corredor cada cruzamento tem seu lock, então o estado da gravação tem o
+ * próprio mutex; a ordem em que as threads passam por ele é uma ordem total compatível com a de cada cruzamento, e os instantes lidos sob
+ * ele nunca recuam.
+ *
+ */
+void gravar_evento(void){
+    double relogio;
+    uint64_t agora_us;
+    bool mesma_thread;
+
+    pthread_mutex_lock(&gravacao.lock);
+    relogio = tempo_relogio();
+    agora_us = relogio > 0 ? (uint64_t) (relogio * 1e6) : 0;
+    if(agora_us < gravacao.instante_us) agora_us = gravacao.instante_us;
+    mesma_thread = gravacao.indice_anterior == indice_thread;
+    escrever_varint(gravacao.arquivo, (agora_us - gravacao.instante_us) << 1 | (mesma_thread ? 1 : 0));
+    if(!mesma_thread) escrever_varint(gravacao.arquivo, (uint64_t) indice_thread);
+    gravacao.indice_anterior = indice_thread;
+    gravacao.instante_us = agora_us;
+    gravacao.eventos++;
+    pthread_mutex_unlock(&gravacao.lock);
+    instante_evento = agora_us / 1e6;
+}
+
+/**
+ * @brief Na reprodução, bloqueia a thread corrente até que o próximo evento da sequência seja dela. Depois do último evento nenhuma
+ * thread volta a ter a vez: a reprodução termina onde a gravação terminou, e a main encerra a simulação (ver consumir_vez()).
+ *
+ */
+void aguardar_vez(void){
+    pthread_mutex_lock(&gravacao.lock);
+    while(gravacao.posicao >= gravacao.total || gravacao.sequencia[gravacao.posicao] != indice_thread){
+        pthread_cond_wait(&gravacao.vez, &gravacao.lock);
+    }
+    pthread_mutex_unlock(&gravacao.lock);
+}
+
+/**
+ * @brief Consome o evento atual da reprodução, fixa o instante gravado como o tempo da thread e acorda as threads que aguardam a vez. O
+ * último evento pede à main, com SIGTERM, que encerre a simulação e confira o resultado (ver finalizar_gravacao()).
+ *
+ */
+void consumir_vez(void){
+    pthread_mutex_lock(&gravacao.lock);
+    instante_evento = gravacao.instantes[gravacao.posicao] / 1e6;
+    gravacao.posicao++;
+    gravacao.eventos++;
+    if(gravacao.posicao == gravacao.total){
+        LOG_AVISO("---------------- REPRODUCAO CONCLUIDA ----------------\n");
+        kill(getpid(), SIGTERM);
+    }
+    pthread_cond_broadcast(&gravacao.vez);
+    pthread_mutex_unlock(&gravacao.lock);
+}
+
+/**
+ * @brief Adquire c->lock. Todas as threads da simulação devem usar esta função no lugar de pthread_mutex_lock para que as
+ * aquisições sejam gravadas ou reproduzidas.
+ *
+ */
+void adquirir_cruzamento(Cruzamento *c){
+    if(gravacao.modo == GRAVACAO_REPRODUZIR){
+        aguardar_vez();
+        pthread_mutex_lock(&c->lock);
+        consumir_vez();
+        return;
+    }
+    pthread_mutex_lock(&c->lock);
+    if(gravacao.modo == GRAVACAO_GRAVAR) gravar_evento();
+}
+
+/**
+ * @brief Aguarda em 'sinal' com c->lock, como pthread_cond_wait. Na reprodução o despertar não depende do escalonador: a thread libera o
+ * lock e só o readquire quando a sequência gravada indicar, o que reproduz exatamente em que ponto ela acordou na execução original.
+ *
+ */
+void esperar_sinal(Cruzamento *c, pthread_cond_t *sinal){
+    if(gravacao.modo == GRAVACAO_REPRODUZIR){
+        pthread_mutex_unlock(&c->lock);
+        adquirir_cruzamento(c);
+        return;
+    }
+    pthread_cond_wait(sinal, &c->lock);
+    if(gravacao.modo == GRAVACAO_GRAVAR) gravar_evento();
+}
+
+/**
+ * @brief Aguarda em pode_cruzar, onde a controladora e as ambulâncias esperam mudanças de estado do cruzamento (ver esperar_sinal()).
+ *
+ */
+void esperar_cruzamento(Cruzamento *c){
+    esperar_sinal(c, &c->pode_cruzar);
+}
+
+/**
+ * @brief Encerra a gravação ou confere a reprodução. Chamada pela main ao encerrar a simulação, com o lock de todos os cruzamentos
+ * adquirido, de modo que nenhum evento está em andamento. A gravação escreve o marcador de fim e o total de travessias e fecha o
+ * arquivo; a reprodução compara as suas travessias com esse total e passa o relógio da main ao instante do último evento reproduzido.
+ *
+ * @return int 0 em caso de sucesso, -1 se a gravação não pôde ser fechada ou a reprodução divergiu
+ */
+int finalizar_gravacao(void){
+    uint64_t travessias;
+    int resultado = 0;
+
+    if(gravacao.modo == GRAVACAO_DESLIGADA) return 0;
+
+    travar_cruzamentos();
+    travessias = total_travessias();
+    pthread_mutex_lock(&gravacao.lock);
+    if(gravacao.modo == GRAVACAO_GRAVAR){
+        escrever_varint(gravacao.arquivo, 0);
+        escrever_varint(gravacao.arquivo, (uint64_t) (total_veiculos + num_cruzamentos));
+        escrever_varint(gravacao.arquivo, travessias);
+        if(fclose(gravacao.arquivo) != 0){
+            perror("gravacao");
+            resultado = -1;
+        }
+        LOG_AVISO("---------------- GRAVACAO ENCERRADA COM %llu EVENTOS E %llu TRAVESSIAS ----------------\n",
+            (unsigned long long) gravacao.eventos, (unsigned long long) travessias);
+    }
+    else{
+        if(gravacao.posicao > 0) instante_evento = gravacao.instantes[gravacao.posicao - 1] / 1e6;
+        if(gravacao.posicao < gravacao.total){
+            fprintf(stderr, "reproducao interrompida no evento %zu de %zu, travessias nao conferidas\n", gravacao.posicao, gravacao.total);
+        }
+        else if(gravacao.conferir && travessias != gravacao.travessias){
+            fprintf(stderr, "reproducao divergiu da gravacao: %llu travessias, a gravacao teve %llu\n", (unsigned long long) travessias,
+                (unsigned long long) gravacao.travessias);
+            resultado = -1;
+        }
+        else if(gravacao.conferir){
+            LOG_AVISO("---------------- REPRODUCAO CONFERIDA: %llu EVENTOS E %llu TRAVESSIAS, COMO NA GRAVACAO ----------------\n",
+                (unsigned long long) gravacao.eventos, (unsigned long long) travessias);
+        }
+    }
+    gravacao.modo = GRAVACAO_DESLIGADA;
+    pthread_mutex_unlock(&gravacao.lock);
+    liberar_cruzamentos();
+    return resultado;
+}
+
+/**
+ * @brief Coluna de uma tabela de registros: um arquivo binário com os valores em sequência, na ordem de bytes da máquina, e o bloco de
+ * valores ainda não escritos
+ *
+ */
+typedef struct{
+    const char *nome;
+    const char *tipo;                   // Tipo do valor com o nome usado pelo numpy (int32, uint8, float64)
+    size_t tamanho;                     // Bytes de cada valor
+    FILE *arquivo;
+    unsigned char *bloco;               // BLOCO_REGISTROS valores
+    uint64_t escritos;                  // Valores que chegaram ao arquivo (os de esquema.csv)
+    bool falhou;                        // Uma escrita falhou: a coluna para de crescer e o arquivo tem só os 'escritos' primeiros
+} ColunaRegistro;
+
+/**
+ * @brief Tabela de registros gravada por colunas. As linhas são montadas direto nos blocos das colunas e, a cada BLOCO_REGISTROS
+ * linhas, cada bloco vai para o seu arquivo com um único fwrite: a análise carrega uma coluna inteira com uma leitura, sem interpretar
+ * texto, e a simulação não paga uma chamada de E/S por registro. 'lock' protege o bloco; os registradores já seguram o lock de um
+ * cruzamento, que sempre é adquirido antes dele.
+ *
+ */
+typedef struct{
+    const char *nome;
+    int num_colunas;
+    ColunaRegistro colunas[MAX_COLUNAS_REGISTRO];
+    int linhas;                         // Linhas no bloco, ainda não escritas
+    uint64_t total;                     // Linhas registradas
+    pthread_mutex_t lock;
+} TabelaRegistros;
+
+// Colunas da tabela de travessias, uma linha por veículo que sai do cruzamento
+typedef enum{
+    TRAVESSIA_ID, TRAVESSIA_CRUZAMENTO, TRAVESSIA_DIRECAO, TRAVESSIA_TIPO, TRAVESSIA_FASE, TRAVESSIA_CHEGADA, TRAVESSIA_ENTRADA,
+    TRAVESSIA_SAIDA, NUM_COLUNAS_TRAVESSIA
+} ColunaTravessia;
+
+// Colunas da tabela de fases, uma linha por fase encerrada (e pelas abertas no fim da simulação)
+typedef enum{
+    FASE_CRUZAMENTO, FASE_NUMERO, FASE_FLUXO, FASE_INICIO, FASE_FIM, FASE_CARROS, FASE_AMBULANCIAS, NUM_COLUNAS_FASE
+} ColunaFase;
+
+TabelaRegistros tabela_travessias = {"travessias", NUM_COLUNAS_TRAVESSIA, {
+    [TRAVESSIA_ID] = {"id", "int32", sizeof(int32_t)},
+    [TRAVESSIA_CRUZAMENTO] = {"cruzamento", "int32", sizeof(int32_t)},
+    [TRAVESSIA_DIRECAO] = {"direcao", "uint8", sizeof(uint8_t)},
+    [TRAVESSIA_TIPO] = {"tipo", "uint8", sizeof(uint8_t)},
+    [TRAVESSIA_FASE] = {"fase", "int32", sizeof(int32_t)},
+    [TRAVESSIA_CHEGADA] = {"chegada", "float64", sizeof(double)},
+    [TRAVESSIA_ENTRADA] = {"entrada", "float64", sizeof(double)},
+    [TRAVESSIA_SAIDA] = {"saida", "float64", sizeof(double)}
+}, .lock = PTHREAD_MUTEX_INITIALIZER};
+TabelaRegistros tabela_fases = {"fases", NUM_COLUNAS_FASE, {
+    [FASE_CRUZAMENTO] = {"cruzamento", "int32", sizeof(int32_t)},
+    [FASE_NUMERO] = {"fase", "int32", sizeof(int32_t)},
+    [FASE_FLUXO] = {"fluxo", "uint8", sizeof(uint8_t)},
+    [FASE_INICIO] = {"inicio", "float64", sizeof(double)},
+    [FASE_FIM] = {"fim", "float64", sizeof(double)},
+    [FASE_CARROS] = {"carros", "int32", sizeof(int32_t)},
+    [FASE_AMBULANCIAS] = {"ambulancias", "int32", sizeof(int32_t)}
+}, .lock = PTHREAD_MUTEX_INITIALIZER};
+const char *diretorio_registros = NULL;                                                 // Diretório dos registros (--registros; NULL = desligados)
+bool registros_ativos = false;                                                          // Só muda com todos os locks dos cruzamentos adquiridos
+
+/**
+ * @brief Abre os arquivos das colunas de uma tabela em 'diretorio', com os nomes TABELA.COLUNA.TIPO
+ *
+ * @return int 0 em caso de sucesso, -1 em caso de erro
+ */
+int abrir_tabela(TabelaRegistros *t, const char *diretorio){
+    char caminho[PATH_MAX];
+    ColunaRegistro *coluna;
+    int k;
+
+    for(k = 0; k < t->num_colunas; k++){
+        coluna = &t->colunas[k];
+        snprintf(caminho, sizeof(caminho), "%s/%s.%s.%s", diretorio, t->nome, coluna->nome, coluna->tipo);
+        coluna->arquivo = fopen(caminho, "wb");
+        if(coluna->arquivo == NULL){
+            perror(caminho);
+            return -1;
+        }
+        coluna->bloco = malloc(BLOCO_REGISTROS * coluna->tamanho);
+        if(coluna->bloco == NULL){
+            perror("malloc");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Cria o diretório dos registros (se ainda não existe) e abre as colunas das duas tabelas. Chamada pela main antes de criar as
+ * threads, depois de uma eventual restauração: o estado em que cada cruzamento parte é a fase 0, aberta neste instante.
+ *
+ * @return int 0 em caso de sucesso, -1 em caso de erro
+ */
+int iniciar_registros(const char *diretorio){
+    int k;
+
+    for(k = 0; k < num_cruzamentos; k++) cruzamentos[k].abertura_fase = tempo_simulacao();
+    if(mkdir(diretorio, 0755) < 0 && errno != EEXIST){
+        perror(diretorio);
+        return -1;
+    }
+    if(abrir_tabela(&tabela_travessias, diretorio) < 0 || abrir_tabela(&tabela_fases, diretorio) < 0) return -1;
+    diretorio_registros = diretorio;
+    registros_ativos = true;
+    return 0;
+}
+
+/**
+ * @brief Copia 'valor' para a coluna 'coluna' da linha em montagem. Deve ser chamada com t->lock adquirido.
+ *
+ */
+void anotar_registro(TabelaRegistros *t, int coluna, const void *valor){
+    ColunaRegistro *c = &t->colunas[coluna];
+
+    memcpy(c->bloco + (size_t) t->linhas * c->tamanho, valor, c->tamanho);
+}
+
+/**
+ * @brief Escreve as linhas acumuladas de cada coluna no seu arquivo. Deve ser chamada com t->lock adquirido.
+ *
+ * O bloco só conta em 'escritos' depois do fflush: um fwrite completo pode ter deixado parte dele no buffer do FILE. Na primeira escrita
+ * curta ou erro a coluna é marcada como falha e avisada uma vez; as demais colunas seguem, cada uma com a sua contagem.
+ */
+void descarregar_tabela(TabelaRegistros *t){
+    ColunaRegistro *coluna;
+    size_t escritos;
+    int k;
+
+    for(k = 0; k < t->num_colunas; k++){
+        coluna = &t->colunas[k];
+        if(coluna->falhou || t->linhas == 0) continue;
+        escritos = fwrite(coluna->bloco, coluna->tamanho, (size_t) t->linhas, coluna->arquivo);
+        if(escritos < (size_t) t->linhas || fflush(coluna->arquivo) != 0 || ferror(coluna->arquivo)){
+            fprintf(stderr, "registros %s/%s.%s.%s: %s\n", diretorio_registros, t->nome, coluna->nome, coluna->tipo, strerror(errno));
+            coluna->falhou = true;
+            continue;
+        }
+        coluna->escritos += escritos;
+    }
+    t->linhas = 0;
+}
+
+/**
+ * @brief Conclui a linha em montagem, descarregando o bloco quando ele se completa. Deve ser chamada com t->lock adquirido.
+ *
+ */
+void fechar_linha(TabelaRegistros *t){
+    t->total++;
+    if(++t->linhas == BLOCO_REGISTROS) descarregar_tabela(t);
+}
+
+/**
+ * @brief Registra a travessia que o veículo 'v' acabou de concluir em 'c'. Deve ser chamada com c->lock adquirido, antes de o veículo
+ * seguir para o próximo cruzamento.
+ *
+ */
+void registrar_travessia(Cruzamento *c, Veiculo *v){
+    int32_t id = v->id, cruzamento = c->indice, fase = v->fase;
+    uint8_t direcao = (uint8_t) v->direcao, tipo = (uint8_t) v->tipo;
+    double saida = tempo_simulacao();
+
+    if(!registros_ativos) return;
+    pthread_mutex_lock(&tabela_travessias.lock);
+    anotar_registro(&tabela_travessias, TRAVESSIA_ID, &id);
+    anotar_registro(&tabela_travessias, TRAVESSIA_CRUZAMENTO, &cruzamento);
+    anotar_registro(&tabela_travessias, TRAVESSIA_DIRECAO, &direcao);
+    anotar_registro(&tabela_travessias, TRAVESSIA_TIPO, &tipo);
+    anotar_registro(&tabela_travessias, TRAVESSIA_FASE, &fase);
+    anotar_registro(&tabela_travessias, TRAVESSIA_CHEGADA, &v->chegada);
+    anotar_registro(&tabela_travessias, TRAVESSIA_ENTRADA, &v->entrada);
+    anotar_registro(&tabela_travessias, TRAVESSIA_SAIDA, &saida);
+    fechar_linha(&tabela_travessias);
+    pthread_mutex_unlock(&tabela_travessias.lock);
+}
+
+/**
+ * @brief Registra a fase atual de 'c', encerrada no instante 'fim'. Deve ser chamada com c->lock adquirido.
+ *
+ */
+void registrar_fase(Cruzamento *c, double fim){
+    int32_t cruzamento = c->indice, fase = c->fase, carros = c->atendidos_fase[TIPO_CARRO], ambulancias = c->atendidos_fase[TIPO_AMBULANCIA];
+    uint8_t fluxo = (uint8_t) c->estado_atual;
+
+    if(!registros_ativos) return;
+    pthread_mutex_lock(&tabela_fases.lock);
+    anotar_registro(&tabela_fases, FASE_CRUZAMENTO, &cruzamento);
+    anotar_registro(&tabela_fases, FASE_NUMERO, &fase);
+    anotar_registro(&tabela_fases, FASE_FLUXO, &fluxo);
+    anotar_registro(&tabela_fases, FASE_INICIO, &c->abertura_fase);
+    anotar_registro(&tabela_fases, FASE_FIM, &fim);
+    anotar_registro(&tabela_fases, FASE_CARROS, &carros);
+    anotar_registro(&tabela_fases, FASE_AMBULANCIAS, &ambulancias);
+    fechar_linha(&tabela_fases);
+    pthread_mutex_unlock(&tabela_fases.lock);
+}
+
+/**
+ * @brief Descarrega e fecha uma tabela e acrescenta as suas colunas ao esquema, cada uma com as linhas que de fato chegaram ao arquivo
+ *
+ * @return int 0 em caso de sucesso, -1 se alguma coluna ficou incompleta
+ */
+int fechar_tabela(TabelaRegistros *t, FILE *esquema){
+    ColunaRegistro *coluna;
+    int k, resultado = 0;
+
+    descarregar_tabela(t);
+    for(k = 0; k < t->num_colunas; k++){
+        coluna = &t->colunas[k];
+        if(fclose(coluna->arquivo) != 0 && !coluna->falhou){
+            fprintf(stderr, "registros %s/%s.%s.%s: %s\n", diretorio_registros, t->nome, coluna->nome, coluna->tipo, strerror(errno));
+            coluna->falhou = true;
+        }
+        free(coluna->bloco);
+        if(coluna->falhou || coluna->escritos != t->total) resultado = -1;
+        if(esquema != NULL) fprintf(esquema, "%s,%s,%s,%llu\n", t->nome, coluna->nome, coluna->tipo, (unsigned long long) coluna->escritos);
+    }
+    return resultado;
+}
+
+/**
+ * @brief Registra as fases ainda abertas, fecha as colunas e escreve DIRETORIO/esquema.csv (tabela, coluna, tipo e linhas). Chamada pela
+ * main ao encerrar a simulação; as travessias em andamento não são registradas.
+ *
+ */
+void finalizar_registros(void){
+    char caminho[PATH_MAX];
+    FILE *esquema;
+    double agora;
+    int k, resultado, erro_esquema;
+
+    if(!registros_ativos) return;
+
+    travar_cruzamentos();
+    agora = tempo_simulacao();
+    for(k = 0; k < num_cruzamentos; k++) registrar_fase(&cruzamentos[k], agora);
+    registros_ativos = false;
+    snprintf(caminho, sizeof(caminho), "%s/esquema.csv", diretorio_registros);
+    esquema = fopen(caminho, "w");
+    if(esquema == NULL) perror(caminho);
+    else fprintf(esquema, "tabela,coluna,tipo,linhas\n");
+    resultado = fechar_tabela(&tabela_travessias, esquema);
+    if(fechar_tabela(&tabela_fases, esquema) < 0) resultado = -1;
+    if(esquema != NULL){
+        erro_esquema = ferror(esquema);
+        if(fclose(esquema) != 0 || erro_esquema) perror(caminho);
+    }
+    if(resultado < 0) fprintf(stderr, "registros %s: colunas incompletas, ver as linhas de cada uma em esquema.csv\n", diretorio_registros);
+    LOG_AVISO("---------------- REGISTROS EM %s: %llu TRAVESSIAS E %llu FASES ----------------\n", diretorio_registros,
+        (unsigned long long) tabela_travessias.total, (unsigned long long) tabela_fases.total);
+    liberar_cruzamentos();
+}
+
+/**
+ * @brief Marca o início de uma nova fase (estado_atual acabou de mudar), registrando a anterior. Deve ser chamada com c->lock adquirido.
+ *
+ */
+void iniciar_fase(Cruzamento *c, EstadoFluxo estado){
+    double agora = tempo_simulacao();
+
+    registrar_fase(c, agora);
+    c->fase++;
+    c->abertura_fase = agora;
+    c->atendidos_fase[TIPO_CARRO] = c->atendidos_fase[TIPO_AMBULANCIA] = 0;
+    c->estado_atual = estado;
+    c->fluxo_encerrado = false;
+    clock_gettime(CLOCK_REALTIME, &c->inicio_fase);
+    atomic_fetch_add_explicit(&metricas.trocas_fase[estado], 1, memory_order_relaxed);
+    publicar_metricas(c);
+}
+
+void escrever_i32(FILE *arquivo, int32_t valor){ fwrite(&valor, sizeof(valor), 1, arquivo); }
+void escrever_u64(FILE *arquivo, uint64_t valor){ fwrite(&valor, sizeof(valor), 1, arquivo); }
+void escrever_f64(FILE *arquivo, double valor){ fwrite(&valor, sizeof(valor), 1, arquivo); }
+int32_t ler_i32(FILE *arquivo){ int32_t valor = -1; if(fread(&valor, sizeof(valor), 1, arquivo) != 1) valor = -1; return valor; }
+uint64_t ler_u64(FILE *arquivo){ uint64_t valor = 0; if(fread(&valor, sizeof(valor), 1, arquivo) != 1) valor = 0; return valor; }
+double ler_f64(FILE *arquivo){ double valor = 0; if(fread(&valor, sizeof(valor), 1, arquivo) != 1) valor = 0; return valor; }
+
+/**
+ * @brief Grava um checkpoint binário com o estado completo da simulação: contadores de cada cruzamento, contadores de id, etapa e prazos
+ * das controladoras, o estado e a semente de cada veículo e os contadores de métricas. Adquire o lock de todos os cruzamentos com
+ * travar_cruzamentos() (sem passar pela gravação do entrelaçamento), o que congela todas as transições enquanto o arquivo é escrito.
+ *
+ * @return int 0 em caso de sucesso, -1 em caso de erro
+ */
+int salvar_checkpoint(const char *caminho){
+    FILE *arquivo;
+    int i, t, d, k;
+    double agora;
+    Cruzamento *c;
+
+    arquivo = fopen(caminho, "wb");
+    if(arquivo == NULL){
+        perror(caminho);
+        return -1;
+    }
+
+    travar_cruzamentos();
+    agora = tempo_simulacao();
+
+    fwrite(ASSINATURA_CHECKPOINT, 1, 4, arquivo);
+    escrever_i32(arquivo, VERSAO_CHECKPOINT);
+    escrever_i32(arquivo, num_cruzamentos);
+    escrever_i32(arquivo, total_veiculos);
+    for(d = 0; d < NUM_DIRECOES; d++) escrever_i32(arquivo, num_faixas[d]);
+    escrever_f64(arquivo, agora);
+
+    for(k = 0; k < num_cruzamentos; k++){
+        c = &cruzamentos[k];
+        for(d = 0; d < NUM_DIRECOES; d++){
+            escrever_i32(arquivo, c->carros_esperando[d]);
+            escrever_i32(arquivo, c->ambulancias_esperando[d]);
+            escrever_i32(arquivo, c->contadores_id_carros[d]);
+            escrever_i32(arquivo, c->contadores_id_ambulancias[d]);
+        }
+        escrever_i32(arquivo, c->carros_no_cruzamento);
+        escrever_i32(arquivo, c->ambulancias_no_cruzamento);
+        escrever_i32(arquivo, c->modo_emergencia);
+        escrever_i32(arquivo, c->estado_atual);
+        escrever_i32(arquivo, c->fase_controlador);
+        escrever_f64(arquivo, c->prazo_controlador);
+        escrever_f64(arquivo, c->fim_verde);
+        escrever_i32(arquivo, c->carros_fase);
+        escrever_i32(arquivo, c->fluxo_encerrado);
+        escrever_f64(arquivo, c->inicio_verde);
+        escrever_f64(arquivo, c->ultima_entrada);
+        escrever_i32(arquivo, c->entradas_verde);
+        escrever_f64(arquivo, c->vazao[FLUXO_NS]);
+        escrever_f64(arquivo, c->vazao[FLUXO_LO]);
+        for(d = 0; d < NUM_DIRECOES * MAX_FAIXAS; d++){
+            escrever_i32(arquivo, c->fila_faixa[d]);
+            escrever_i32(arquivo, c->cabeca_faixa[d]);
+            escrever_i32(arquivo, c->cauda_faixa[d]);
+            escrever_f64(arquivo, c->proxima_entrada[d]);
+            escrever_i32(arquivo, c->faixa_liberada[d]);
+        }
+        escrever_f64(arquivo, c->prazo_admissao);
+        escrever_f64(arquivo, c->instante_controle);
+    }
+
+    for(i = 0; i < total_veiculos; i++){
+        escrever_i32(arquivo, veiculos[i].id);
+        escrever_i32(arquivo, veiculos[i].direcao);
+        escrever_i32(arquivo, veiculos[i].tipo);
+        escrever_i32(arquivo, veiculos[i].estado);
+        escrever_f64(arquivo, veiculos[i].prazo);
+        escrever_f64(arquivo, veiculos[i].chegada);
+        escrever_u64(arquivo, veiculos[i].semente);
+        escrever_i32(arquivo, veiculos[i].cruzamento);
+        escrever_f64(arquivo, veiculos[i].inicio_percurso);
+        escrever_i32(arquivo, veiculos[i].paradas_percurso);
+        escrever_i32(arquivo, veiculos[i].faixa);
+        escrever_i32(arquivo, veiculos[i].seguinte);
+    }
+
+    for(t = 0; t < NUM_TIPOS; t++){
+        for(d = 0; d < NUM_DIRECOES; d++){
+            escrever_u64(arquivo, metricas.chegadas[t][d]);
+            escrever_u64(arquivo, metricas.entradas[t][d]);
+            escrever_u64(arquivo, metricas.travessias[t][d]);
+            escrever_u64(arquivo, metricas.paradas[t][d]);
+        }
+        for(i = 0; i < NUM_FAIXAS_ESPERA; i++) escrever_u64(arquivo, metricas.espera_faixas[t][i]);
+        escrever_u64(arquivo, metricas.espera_soma_us[t]);
+        for(d = 0; d < NUM_DIRECOES; d++) escrever_u64(arquivo, metricas.espera_maxima_us[t][d]);
+    }
+    for(i = 0; i < 4; i++) escrever_u64(arquivo, metricas.trocas_fase[i]);
+    escrever_u64(arquivo, metricas.emergencias);
+    escrever_u64(arquivo, metricas.intervencoes_espera);
+    escrever_u64(arquivo, metricas.verdes);
+    escrever_u64(arquivo, metricas.verde_us);
+    escrever_u64(arquivo, metricas.verde_ocioso_us);
+    escrever_u64(arquivo, metricas.fila_residual);
+    escrever_u64(arquivo, metricas.percursos);
+    escrever_u64(arquivo, metricas.percurso_us);
+    escrever_u64(arquivo, metricas.percurso_paradas);
+    liberar_cruzamentos();
+
+    if(fclose(arquivo) != 0){
+        perror(caminho);
+        return -1;
+    }
+    LOG_AVISO("---------------- CHECKPOINT SALVO EM %s (t = %.1fs) ----------------\n", caminho, agora);
+    return 0;
+}
+
+/**
+ * @brief Carrega um checkpoint antes da criação das threads. O relógio da simulação é ajustado para continuar do instante salvo, e cada
+ * thread retoma o veículo (ou a controladora) exatamente na etapa em que estava.
+ *
+ * @return int 0 em caso de sucesso, -1 se o arquivo for inválido ou de outra configuração de veículos ou de corredor
+ */
+int restaurar_checkpoint(const char *caminho){
+    FILE *arquivo;
+    char assinatura[4];
+    int i, t, d, k, estado;
+    bool faixas_iguais = true;
+    Direcao direcao;
+    TipoVeiculo tipo;
+    double instante, real;
+    struct timespec agora;
+    Cruzamento *c;
+
+    arquivo = fopen(caminho, "rb");
+    if(arquivo == NULL){
+        perror(caminho);
+        return -1;
+    }
+    if(fread(assinatura, 1, 4, arquivo) != 4 || memcmp(assinatura, ASSINATURA_CHECKPOINT, 4) != 0
+        || ler_i32(arquivo) != VERSAO_CHECKPOINT || ler_i32(arquivo) != num_cruzamentos || ler_i32(arquivo) != total_veiculos){
+        fprintf(stderr, "%s: checkpoint invalido ou de outra configuracao de veiculos\n", caminho);
+        fclose(arquivo);
+        return -1;
+    }
+    for(d = 0; d < NUM_DIRECOES; d++){
+        if(ler_i32(arquivo) != num_faixas[d]) faixas_iguais = false;
+    }
+    if(!faixas_iguais){
+        fprintf(stderr, "%s: checkpoint de outra configuracao de faixas\n", caminho);
+        fclose(arquivo);
+        return -1;
+    }
+    instante = ler_f64(arquivo);
+
+    for(k = 0; k < num_cruzamentos; k++){
+        c = &cruzamentos[k];
+        for(d = 0; d < NUM_DIRECOES; d++){
+            c->carros_esperando[d] = ler_i32(arquivo);
+            c->ambulancias_esperando[d] = ler_i32(arquivo);
+            c->contadores_id_carros[d] = ler_i32(arquivo);
+            c->contadores_id_ambulancias[d] = ler_i32(arquivo);
+        }
+        c->carros_no_cruzamento = ler_i32(arquivo);
+        c->ambulancias_no_cruzamento = ler_i32(arquivo);
+        c->modo_emergencia = ler_i32(arquivo);
+        c->estado_atual = (EstadoFluxo) ler_i32(arquivo);
+        c->fase_controlador = (EstadoControlador) ler_i32(arquivo);
+        c->prazo_controlador = ler_f64(arquivo);
+        c->fim_verde = ler_f64(arquivo);
+        c->carros_fase = ler_i32(arquivo);
+        c->fluxo_encerrado = ler_i32(arquivo);
+        c->inicio_verde = ler_f64(arquivo);
+        c->ultima_entrada = ler_f64(arquivo);
+        c->entradas_verde = ler_i32(arquivo);
+        c->vazao[FLUXO_NS] = ler_f64(arquivo);
+        c->vazao[FLUXO_LO] = ler_f64(arquivo);
+        for(d = 0; d < NUM_DIRECOES * MAX_FAIXAS; d++){
+            c->fila_faixa[d] = ler_i32(arquivo);
+            c->cabeca_faixa[d] = ler_i32(arquivo);
+            c->cauda_faixa[d] = ler_i32(arquivo);
+            c->proxima_entrada[d] = ler_f64(arquivo);
+            c->faixa_liberada[d] = ler_i32(arquivo);
+        }
+        c->prazo_admissao = ler_f64(arquivo);
+        c->instante_controle = ler_f64(arquivo);
+        c->ambulancias_em_emergencia = 0;
+    }
+
+    for(i = 0; i < total_veiculos; i++){
+        veiculos[i].id = ler_i32(arquivo);
+        direcao = (Direcao) ler_i32(arquivo);
+        tipo = (TipoVeiculo) ler_i32(arquivo);
+        estado = ler_i32(arquivo);
+        // A main já criou veiculos[i] com a direção e o tipo da configuração atual, e a thread i será criada com eles: um checkpoint
+        // com a mesma quantidade total, mas outra distribuição por direção ou tipo, poria o veículo na fila errada
+        if(direcao != veiculos[i].direcao || tipo != veiculos[i].tipo || estado < VEICULO_APROXIMANDO || estado > VEICULO_ATRAVESSANDO){
+            fprintf(stderr, feof(arquivo) ? "%s: checkpoint truncado\n" : "%s: checkpoint invalido ou de outra configuracao de veiculos (veiculo %d)\n",
+                caminho, i + 1);
+            fclose(arquivo);
+            return -1;
+        }
+        veiculos[i].estado = (EstadoVeiculo) estado;
+        veiculos[i].prazo = ler_f64(arquivo);
+        veiculos[i].chegada = ler_f64(arquivo);
+        veiculos[i].semente = ler_u64(arquivo);
+        veiculos[i].cruzamento = ler_i32(arquivo);
+        veiculos[i].inicio_percurso = ler_f64(arquivo);
+        veiculos[i].paradas_percurso = ler_i32(arquivo);
+        veiculos[i].faixa = ler_i32(arquivo);
+        veiculos[i].seguinte = ler_i32(arquivo);
+        if(veiculos[i].cruzamento < 0 || veiculos[i].cruzamento >= num_cruzamentos) veiculos[i].cruzamento = 0;
+        // A entrada de quem está atravessando não é salva, mas decorre do prazo de saída; a fase fica -1 (ver --registros)
+        if(veiculos[i].estado == VEICULO_ATRAVESSANDO){
+            veiculos[i].entrada = veiculos[i].prazo - (veiculos[i].tipo == TIPO_CARRO ? TEMPO_TRAVESSIA : TEMPO_TRAVESSIA_AMBULANCIA);
+        }
+
+        // Ambulâncias anunciadas, na fila ou atravessando mantêm a emergência do seu cruzamento ativa
+        if(veiculos[i].tipo == TIPO_AMBULANCIA && veiculos[i].estado != VEICULO_APROXIMANDO) cruzamentos[veiculos[i].cruzamento].ambulancias_em_emergencia++;
+    }
+
+    for(t = 0; t < NUM_TIPOS; t++){
+        for(d = 0; d < NUM_DIRECOES; d++){
+            metricas.chegadas[t][d] = ler_u64(arquivo);
+            metricas.entradas[t][d] = ler_u64(arquivo);
+            metricas.travessias[t][d] = ler_u64(arquivo);
+            metricas.paradas[t][d] = ler_u64(arquivo);
+        }
+        for(i = 0; i < NUM_FAIXAS_ESPERA; i++) metricas.espera_faixas[t][i] = ler_u64(arquivo);
+        metricas.espera_soma_us[t] = ler_u64(arquivo);
+        for(d = 0; d < NUM_DIRECOES; d++) metricas.espera_maxima_us[t][d] = ler_u64(arquivo);
+    }
+    for(i = 0; i < 4; i++) metricas.trocas_fase[i] = ler_u64(arquivo);
+    metricas.emergencias = ler_u64(arquivo);
+    metricas.intervencoes_espera = ler_u64(arquivo);
+    metricas.verdes = ler_u64(arquivo);
+    metricas.verde_us = ler_u64(arquivo);
+    metricas.verde_ocioso_us = ler_u64(arquivo);
+    metricas.fila_residual = ler_u64(arquivo);
+    metricas.percursos = ler_u64(arquivo);
+    metricas.percurso_us = ler_u64(arquivo);
+    metricas.percurso_paradas = ler_u64(arquivo);
+    metricas.vazao_mcps[FLUXO_NS] = (uint64_t) (cruzamentos[0].vazao[FLUXO_NS] * 1000);
+    metricas.vazao_mcps[FLUXO_LO] = (uint64_t) (cruzamentos[0].vazao[FLUXO_LO] * 1000);
+
+    if(ferror(arquivo) || feof(arquivo)){
+        fprintf(stderr, "%s: checkpoint truncado\n", caminho);
+        fclose(arquivo);
+        return -1;
+    }
+    fclose(arquivo);
+
+    // Recuar a origem do relógio faz tempo_simulacao() retornar 'instante' agora
+    clock_gettime(CLOCK_MONOTONIC, &agora);
+    real = instante / escala_tempo;
+    origem_relogio.tv_sec = agora.tv_sec - (time_t) real;
+    origem_relogio.tv_nsec = agora.tv_nsec - (long) ((real - (time_t) real) * 1e9);
+    if(origem_relogio.tv_nsec < 0){
+        origem_relogio.tv_sec--;
+        origem_relogio.tv_nsec += 1000000000L;
+    }
+    LOG_AVISO("---------------- CHECKPOINT %s RESTAURADO (t = %.1fs) ----------------\n", caminho, instante);
+    return 0;
+}
+
+/**
+ * @brief Função da Thread de Carro. Opera em um loop infinito, simulando o comportamento contínuo de um veículo no sistema:
+ * se aproximar do cruzamento, esperar pela sua vez, atravessar, e então reiniciar o ciclo. A função gerencia toda a sincronização
+ * necessária para interagir de forma segura com o estado compartilhado do cruzamento.
+ *
+ * Cada etapa do ciclo é registrada em veiculos[] e o switch abaixo permite que a thread comece em qualquer uma delas, o que é usado
+ * ao restaurar um checkpoint. No funcionamento normal as etapas se sucedem pelos 'case' em sequência, como um laço comum.
+ *
+ * @param arg Um ponteiro genérico (void*) para a estrutura VeiculoArgs do carro em args_veiculos[]. A estrutura deve conter a direção
+ * de origem do carro.
+ *
+ * @return void* Sempre retorna NULL
+ */
+void * carros(void *arg){
+    VeiculoArgs *args = (VeiculoArgs*) arg; // Converter o argumento genérico para o tipo esperado (VeiculoArgs)
+    Direcao direcao_carro = args->direcao;  // Extrair a direção, definida pela thread main
+    Veiculo *v;                             // Estado persistente deste carro
+    Cruzamento *c;                          // Cruzamento em que o carro está ou para o qual se dirige
+    int proximo, faixa;
+    double entrada_planejada;               // Instante planejado da entrada, a partir do qual conta o intervalo de saturação
+    indice_thread = args->indice;           // Índice estável usado na gravação/reprodução do entrelaçamento
+    v = &veiculos[indice_thread - 1];
+    c = &cruzamentos[v->cruzamento];
+
+    registrar_partida();
+
+    // A etapa de espera começa com o lock adquirido
+    if(v->estado == VEICULO_ESPERANDO) adquirir_cruzamento(c);
+
+	while(1){
+        // Carros Leste-Oeste do corredor trocam de cruzamento ao fim de cada travessia
+        c = &cruzamentos[v->cruzamento];
+
+        switch(v->estado){
+        case VEICULO_APROXIMANDO:
+            // Simula o tempo que o carro leva para percorrer o trajeto até chegar ao cruzamento
+            LOG_VEICULO("Carro %d da direcao %s esta se aproximando do cruzamento.\n", v->id, nome_direcao[direcao_carro]);
+            dormir_ate(v->prazo);
+
+            // Adquire o lock principal para interagir com o estado do cruzamento
+            adquirir_cruzamento(c);
+            // Incrementa o contador da fila de espera para sua direção e entra na faixa de menor fila
+            v->faixa = controle_escolher_faixa(c->fila_faixa, num_faixas, direcao_carro);
+            faixa = FAIXA(direcao_carro, v->faixa);
+            c->carros_esperando[direcao_carro]++;
+            entrar_fila(c, faixa, v);
+            v->estado = VEICULO_ESPERANDO;
+            v->chegada = tempo_simulacao();
+            if(v->cruzamento == primeiro_cruzamento(c->indice, direcao_carro)){
+                v->inicio_percurso = v->chegada;
+                v->paradas_percurso = 0;
+            }
+            // Uma parada é uma chegada que não pode entrar de imediato: é o que a onda verde do corredor busca evitar
+            if(!carro_admitido(c, v, faixa)){
+                atomic_fetch_add_explicit(&metricas.paradas[TIPO_CARRO][direcao_carro], 1, memory_order_relaxed);
+                v->paradas_percurso++;
+            }
+            atomic_fetch_add_explicit(&metricas.chegadas[TIPO_CARRO][direcao_carro], 1, memory_order_relaxed);
+            publicar_metricas(c);
+            // fall through
+
+        case VEICULO_ESPERANDO:
+            faixa = FAIXA(direcao_carro, v->faixa);
+            // Loop de espera condicional em que a thread só prossegue quando carro_admitido(): verde da direção aberto, faixa liberada pela
+            // controladora e o carro à frente da fila da faixa. Cada carro espera na sua própria variável de condição e é acordado
+            // individualmente (acordar_faixa()) quando chega à frente da fila ou a faixa é liberada. Essencial para se proteger contra
+            // despertares inadequados
+            while(!carro_admitido(c, v, faixa)){
+                LOG_VEICULO("Carro %d da direcao %s esta esperando para passar.\n", v->id, nome_direcao[direcao_carro]);
+                // libera o 'lock' e põe a thread para dormir. Ao acordar, ela readquire o 'lock' antes de reavaliar a condição
+                esperar_sinal(c, &v->vez);
+            }
+
+            // Se saiu do loop, a passagem foi liberada. Atualiza o estado:
+            c->carros_esperando[direcao_carro]--;   // Deixa de estar "esperando"
+            sair_fila(c, faixa);
+            c->carros_no_cruzamento++;              // Agora está "no cruzamento"
+            v->estado = VEICULO_ATRAVESSANDO;
+            // O carro entra quando a controladora libera a faixa ou, se a encontrou livre, quando chega ('prazo' ainda é o da chegada)
+            entrada_planejada = (v->prazo > c->instante_controle) ? v->prazo : c->instante_controle;
+            v->entrada = tempo_simulacao();
+            v->prazo = v->entrada + TEMPO_TRAVESSIA; // Tempo que o carro leva para atravessar fisicamente o cruzamento
+            v->fase = c->fase;
+            c->atendidos_fase[TIPO_CARRO]++;
+            c->entradas_verde++;                    // Amostra da vazão do eixo aberto
+            c->ultima_entrada = tempo_simulacao();
+            if(intervalo_saturacao > 0){
+                c->proxima_entrada[faixa] = entrada_planejada + intervalo_saturacao;
+                c->faixa_liberada[faixa] = false;   // O próximo carro da faixa aguarda o intervalo de saturação
+            }
+            else acordar_faixa(c, faixa);           // Sem intervalo de saturação, o próximo da fila pode entrar em seguida
+            registrar_entrada(TIPO_CARRO, direcao_carro, v->chegada);
+            verificar_invariantes(c, TIPO_CARRO, direcao_carro, true);
+            publicar_metricas(c);
+            LOG_VEICULO("Carro %d da direcao %s entrou no cruzamento.\n", v->id, nome_direcao[direcao_carro]);
+
+            // Libera o lock antes de simular o tempo de travessia. Isso é feito para permitir que outros carros do mesmo fluxo entrem no cruzamento concorrentemente
+            pthread_mutex_unlock(&c->lock);
+            // fall through
+
+        case VEICULO_ATRAVESSANDO:
+            dormir_ate(v->prazo);
+
+            // Readquire o lock para atualizar o estado de saída de forma segura
+            adquirir_cruzamento(c);
+            c->carros_no_cruzamento--;
+            v->estado = VEICULO_APROXIMANDO;
+            atomic_fetch_add_explicit(&metricas.travessias[TIPO_CARRO][direcao_carro], 1, memory_order_relaxed);
+            registrar_travessia(c, v);
+            verificar_invariantes(c, TIPO_CARRO, direcao_carro, false);
+            publicar_metricas(c);
+            LOG_VEICULO("Carro %d da direcao %s saiu do cruzamento.\n", v->id, nome_direcao[direcao_carro]);
+
+            // No corredor, o carro Leste-Oeste segue pelo trecho até o próximo cruzamento; ao fim do corredor (ou fora dele) o percurso se
+            // encerra e o carro volta a se aproximar do primeiro cruzamento após um intervalo sorteado
+            proximo = proximo_cruzamento(c->indice, direcao_carro);
+            if(proximo >= 0){
+                v->prazo = tempo_simulacao() + tempo_trecho;
+                v->cruzamento = proximo;
+            }
+            else{
+                if(controle_eixo(direcao_carro) == FLUXO_LO){
+                    atomic_fetch_add_explicit(&metricas.percursos, 1, memory_order_relaxed);
+                    atomic_fetch_add_explicit(&metricas.percurso_us, (uint64_t) ((tempo_simulacao() - v->inicio_percurso) * 1e6), memory_order_relaxed);
+                    atomic_fetch_add_explicit(&metricas.percurso_paradas, (uint64_t) v->paradas_percurso, memory_order_relaxed);
+                }
+                v->prazo = tempo_simulacao() + sortear(&v->semente, 2, 8);
+                v->cruzamento = primeiro_cruzamento(c->indice, direcao_carro);
+            }
+
+            // Notifica todas as outras threads (especialmente a controladora) que o estado mudou.Essencial para que athread 'fluxo_trafego' possa verificar se o cruzamento esvaziou
+            pthread_cond_broadcast(&c->pode_cruzar);
+            pthread_mutex_unlock(&c->lock);
+            break;
+
+        default:
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Função da Thread de Ambulância. Implementa um comportamento de alta prioridade que interrompe o fluxo normal de tráfego.
+ * Seu funcionamento se dá da seguinte forma:
+ *  1. Anunciar a emergência ao sistema, forçando a thread controladora a reagir;
+ *  2. Aguardar o controlador limpar o cruzamento e abrir a passagem para apenas as ambulâncias;
+ *  3. Atravessar o cruzamento rapidamente;
+ *  4. Sinalizar o fim da emergência, permitindo que o sistema retorne à operação normal;
+ *
+ * Assim como em carros(), a etapa corrente fica registrada em veiculos[] para que a thread possa ser retomada de um checkpoint.
+ *
+ * @param arg Um ponteiro genérico (void*) para a estrutura VeiculoArgs da ambulância em args_veiculos[], contendo a direção de origem.
+ * @return void* Sempre retorna NULL.
+ */
+void * ambulancia(void* arg){
+    VeiculoArgs *args = (VeiculoArgs*) arg;     // Converte e extrai os argumentos passados pela thread main
+    Direcao direcao_ambulancia = args->direcao;
+    Veiculo *v;                                 // Estado persistente desta ambulância
+    Cruzamento *c;                              // Cruzamento atendido pela ambulância (elas não percorrem o corredor)
+    indice_thread = args->indice;
+    v = &veiculos[indice_thread - 1];
+    c = &cruzamentos[v->cruzamento];
+
+    registrar_partida();
+
+    if(v->estado == VEICULO_ESPERANDO) adquirir_cruzamento(c);
+
+    while(1){
+        switch(v->estado){
+        case VEICULO_APROXIMANDO:
+            // Simula um tempo de percurso longo e aleatório antes de iniciar uma nova emergência (sorteado na saída do cruzamento)
+            dormir_ate(v->prazo);
+
+            // Notifica o sistema sobre a aproximação de um veículo de alta prioridade.
+            LOG_VEICULO("AMBULANCIA DA DIRECAO %s SE APROXIMANDO EM EMERGENCIA!\n", nome_direcao[direcao_ambulancia]);
+
+            // Adquire o lock principal para alterar o estado global
+            adquirir_cruzamento(c);
+            if(!c->modo_emergencia) atomic_fetch_add_explicit(&metricas.emergencias, 1, memory_order_relaxed);
+            c->ambulancias_em_emergencia++;
+            c->modo_emergencia = true;  // Ativa a flag de emergência
+            // Pequena pausa para a thread controladora possa ter tempo de reagir e começar a limpar o cruzamento
+            v->estado = VEICULO_ANUNCIADO;
+            v->prazo = tempo_simulacao() + TEMPO_ANUNCIO;
+            publicar_metricas(c);
+            // Acorda todas as threads em espera, especialmente a thread 'fluxo_trafego', para que possa detectar a flag modo_emergencia e iniciar o protocolo
+            pthread_cond_broadcast(&c->pode_cruzar);
+            // Libera o lock imediatamente para evitar deadlock com a thread controladora
+            pthread_mutex_unlock(&c->lock);
+            // fall through
+
+        case VEICULO_ANUNCIADO:
+            dormir_ate(v->prazo);
+
+            // Adquire o lock principal para se entrar na fila de espera
+            adquirir_cruzamento(c);
+            c->ambulancias_esperando[direcao_ambulancia]++;
+            v->estado = VEICULO_ESPERANDO;
+            v->chegada = tempo_simulacao();
+            atomic_fetch_add_explicit(&metricas.chegadas[TIPO_AMBULANCIA][direcao_ambulancia], 1, memory_order_relaxed);
+            publicar_metricas(c);
+            // Avisa a controladora, que pode estar com o outro eixo aberto para ambulâncias e precisar alterná-lo
+            pthread_cond_broadcast(&c->pode_cruzar);
+            // fall through
+
+        case VEICULO_ESPERANDO:
+            // Loop de espera condicional queaguarda até que o controlador mude o estado para um fluxo de ambulância compatível com sua direção
+            while(!controle_pode_passar(c->modo_emergencia, direcao_ambulancia, c->estado_atual, TIPO_AMBULANCIA)){
+                LOG_VEICULO("AMBULANCIA %d (%s) ESPERANDO PARA PASSAR.\n", v->id, nome_direcao[direcao_ambulancia]);
+                esperar_cruzamento(c);
+            }
+
+            // Se saiu do loop, a passagem foi liberada
+            c->ambulancias_esperando[direcao_ambulancia]--;
+            c->ambulancias_no_cruzamento++;
+            v->estado = VEICULO_ATRAVESSANDO;
+            v->entrada = tempo_simulacao();
+            v->prazo = v->entrada + TEMPO_TRAVESSIA_AMBULANCIA; // Simula a travessia rápida do cruzamento
+            v->fase = c->fase;
+            c->atendidos_fase[TIPO_AMBULANCIA]++;
+            registrar_entrada(TIPO_AMBULANCIA, direcao_ambulancia, v->chegada);
+            verificar_invariantes(c, TIPO_AMBULANCIA, direcao_ambulancia, true);
+            publicar_metricas(c);
+            LOG_VEICULO("AMBULANCIA %d (%s) ENTROU NO CRUZAMENTO.\n", v->id, nome_direcao[direcao_ambulancia]);
+
+            // Libera o lock antes de simular a travessia, permitindo que outras ambulâncias do mesmo fluxo entrem concorrentemente
+            pthread_mutex_unlock(&c->lock);
+            // fall through
+
+        case VEICULO_ATRAVESSANDO:
+            dormir_ate(v->prazo);
+
+            // Readquire o lock para finalizar a emergência de forma segura
+            adquirir_cruzamento(c);
+            c->ambulancias_no_cruzamento--;
+            // Desativa a flag de emergência apenas quando não resta nenhuma ambulância anunciada, na fila ou dentro do cruzamento. Desativá-la
+            // na saída da primeira ambulância deixava a controladora abrir um fluxo de carros com outra ambulância ainda atravessando
+            c->ambulancias_em_emergencia--;
+            c->modo_emergencia = c->ambulancias_em_emergencia > 0;
+            // Sorteia um tempo de percurso longo antes da próxima emergência, tornando estes eventos mais esporádicos e realistas na simulação.
+            v->estado = VEICULO_APROXIMANDO;
+            v->prazo = tempo_simulacao() + sortear(&v->semente, 30, 30);
+            atomic_fetch_add_explicit(&metricas.travessias[TIPO_AMBULANCIA][direcao_ambulancia], 1, memory_order_relaxed);
+            registrar_travessia(c, v);
+            verificar_invariantes(c, TIPO_AMBULANCIA, direcao_ambulancia, false);
+            publicar_metricas(c);
+            LOG_VEICULO("AMBULANCIA %d (%s) SAIU DO CRUZAMENTO.\n", v->id, nome_direcao[direcao_ambulancia]);
+
+            // Notifica todas as threads que a emergência acabou. Isso é feito para "liberar" a thread 'fluxo_trafego', que estava aguardando esta condição
+            pthread_cond_broadcast(&c->pode_cruzar);
+            pthread_mutex_unlock(&c->lock);
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Carros na fila das duas direções de um eixo. Deve ser chamada com c->lock adquirido.
+ *
+ */
+int fila_do_eixo(Cruzamento *c, EstadoFluxo fluxo){
+    return (fluxo == FLUXO_NS) ? c->carros_esperando[NORTE] + c->carros_esperando[SUL]
+                               : c->carros_esperando[LESTE] + c->carros_esperando[OESTE];
+}
+
+/**
+ * @brief Filas de jusante do cruzamento 'c' para a política max-pressure: para cada direção, os carros que esperam na mesma direção no
+ * cruzamento seguinte do percurso (proximo_cruzamento()), ou 0 onde os carros deixam o sistema ao atravessar. Adquire o lock de um
+ * vizinho por vez e deve ser chamada SEM c->lock: a controladora do vizinho pode estar lendo as filas deste cruzamento, e segurar dois
+ * locks de cruzamento ao mesmo tempo permitiria um deadlock. As filas lidas são uma amostra e podem mudar antes da decisão.
+ *
+ */
+void ler_filas_jusante(Cruzamento *c, int *jusante){
+    Direcao dir;
+    Cruzamento *vizinho;
+    int proximo;
+
+    for(dir = NORTE; dir < NUM_DIRECOES; dir++){
+        jusante[dir] = 0;
+        proximo = proximo_cruzamento(c->indice, dir);
+        if(proximo < 0) continue;
+        vizinho = &cruzamentos[proximo];
+        adquirir_cruzamento(vizinho);
+        jusante[dir] = vizinho->carros_esperando[dir];
+        pthread_mutex_unlock(&vizinho->lock);
+    }
+}
+
+/**
+ * @brief Pressão de um eixo para a política max-pressure: em cada direção do eixo, a fila de montante (os carros esperando neste
+ * cruzamento) menos a de jusante (ver ler_filas_jusante()), ponderada pela vazão medida do eixo (controle_pressao()). Os carros
+ * Norte-Sul e os que terminam o corredor deixam o sistema ao atravessar, com jusante vazia. Deve ser chamada com c->lock adquirido.
+ *
+ */
+double pressao(Cruzamento *c, EstadoFluxo fluxo, const int *jusante){
+    Direcao primeira = (fluxo == FLUXO_NS) ? NORTE : LESTE, segunda = (fluxo == FLUXO_NS) ? SUL : OESTE;
+
+    return controle_pressao(c->carros_esperando[primeira], jusante[primeira], c->vazao[fluxo])
+         + controle_pressao(c->carros_esperando[segunda], jusante[segunda], c->vazao[fluxo]);
+}
+
+/**
+ * @brief Contabiliza o verde que acabou de ser encerrado e atualiza a vazão medida do eixo (controle_vazao()). O trecho útil do verde
+ * vai da abertura até a última entrada de carro; o restante é verde ocioso. Deve ser chamada com c->lock adquirido, ainda com
+ * estado_atual no fluxo encerrado. A vazão exportada é a do primeiro cruzamento.
+ *
+ */
+void encerrar_verde(Cruzamento *c){
+    double agora = tempo_simulacao(), util;
+    EstadoFluxo fluxo = c->estado_atual;
+    int residual;
+
+    residual = (fluxo == FLUXO_NS) ? c->carros_esperando[NORTE] + c->carros_esperando[SUL]
+                                   : c->carros_esperando[LESTE] + c->carros_esperando[OESTE];
+    util = (c->entradas_verde > 0) ? c->ultima_entrada - c->inicio_verde : 0;
+
+    atomic_fetch_add_explicit(&metricas.verdes, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&metricas.verde_us, (uint64_t) ((agora - c->inicio_verde) * 1e6), memory_order_relaxed);
+    atomic_fetch_add_explicit(&metricas.verde_ocioso_us, (uint64_t) ((agora - c->inicio_verde - util) * 1e6), memory_order_relaxed);
+    atomic_fetch_add_explicit(&metricas.fila_residual, (uint64_t) residual, memory_order_relaxed);
+
+    if(c->entradas_verde > 0){
+        c->vazao[fluxo] = controle_vazao(c->vazao[fluxo], c->entradas_verde, util, residual);
+        if(c->indice == 0) atomic_store_explicit(&metricas.vazao_mcps[fluxo], (uint64_t) (c->vazao[fluxo] * 1000), memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief admitir de controle_liberar_faixas(): acorda o primeiro carro da faixa liberada
+ *
+ */
+void acordar_liberada(void *contexto, int faixa){
+    acordar_faixa((Cruzamento*) contexto, faixa);
+}
+
+/**
+ * @brief Admissão pela vazão de saturação: cada faixa admite um carro por vez, e o carro que entra a bloqueia até proxima_entrada, o
+ * instante planejado da sua entrada mais intervalo_saturacao. Chamada pela controladora em cada instante planejado do verde
+ * (verificações e c->prazo_admissao), libera as faixas cujo intervalo já passou, acordando o primeiro carro de cada uma, e agenda o
+ * próximo instante de liberação.
+ *
+ * A decisão fica com a controladora, que já acorda pelo relógio, sem threads nem esperas com prazo adicionais, e usa apenas instantes
+ * planejados ('instante', nunca a leitura do relógio): a espera dos carros continua dependendo só do estado do cruzamento, e a gravação
+ * do entrelaçamento continua reproduzível. O instante planejado da entrada é o desta liberação ou, para um carro que chega com a faixa
+ * livre e entra na hora, o da sua chegada: uma fila parada escoa exatamente um carro por intervalo_saturacao em cada faixa, e nenhum
+ * carro encurta o intervalo do seguinte. Deve ser chamada com c->lock adquirido.
+ *
+ */
+void liberar_faixas(Cruzamento *c, double instante){
+    c->instante_controle = instante;
+    controle_liberar_faixas(c->faixa_liberada, c->proxima_entrada, instante, c->fim_verde, &c->prazo_admissao, acordar_liberada, c);
+}
+
+/**
+ * @brief Abre todas as faixas no início de um verde e acorda o primeiro carro de cada faixa do eixo aberto: o intervalo de saturação
+ * separa carros de uma fila em movimento, e o primeiro de cada faixa parte assim que o verde abre. Deve ser chamada com c->lock
+ * adquirido, depois de iniciar_fase() e de definidos c->inicio_verde e c->fim_verde.
+ *
+ */
+void abrir_faixas(Cruzamento *c){
+    int f;
+
+    for(f = 0; f < NUM_DIRECOES * MAX_FAIXAS; f++){
+        c->faixa_liberada[f] = true;
+        if(controle_eixo((Direcao) (f / MAX_FAIXAS)) == c->estado_atual) acordar_faixa(c, f);
+    }
+    c->instante_controle = c->inicio_verde;
+    c->prazo_admissao = c->fim_verde;
+}
+
+/**
+ * @brief Defasagens da onda verde: o verde arterial de cada cruzamento começa TEMPO_TRAVESSIA + tempo_trecho depois do verde do
+ * cruzamento a Oeste, o tempo que um carro que entra no início do verde leva para chegar ao cruzamento seguinte. A onda favorece os
+ * carros que vêm do Oeste; no sentido oposto ela só se forma quando o dobro da defasagem é múltiplo do ciclo, o que o ciclo padrão
+ * (2 * (TEMPO_TRAVESSIA + tempo_trecho)) garante: os cruzamentos alternam entre duas fases opostas.
+ *
+ */
+void calcular_defasagens(void){
+    int k;
+    double defasagem = 0;
+
+    for(k = 0; k < num_cruzamentos; k++){
+        cruzamentos[k].defasagem = defasagem;
+        defasagem += TEMPO_TRAVESSIA + tempo_trecho;
+        while(defasagem >= ciclo_corredor) defasagem -= ciclo_corredor;
+    }
+}
+
+/**
+ * @brief Janela do plano coordenado em que o instante 'agora' cai. O ciclo de 'c' começa em c->defasagem com o eixo Leste-Oeste por
+ * ciclo_corredor * FRACAO_ARTERIAL segundos, seguido do eixo Norte-Sul até o fim do ciclo; se o verde arterial deste ciclo já foi
+ * dado e encerrado cedo, o eixo Norte-Sul ocupa o resto da janela arterial. O verde de cada janela termina
+ * TEMPO_TRAVESSIA antes do fim dela: o último carro a entrar já saiu quando a janela seguinte começa, e o pelotão que chega do
+ * cruzamento anterior encontra o verde aberto no horário.
+ *
+ * @param eixo eixo da janela corrente
+ * @param fim instante em que o verde da janela corrente termina
+ * @param seguinte instante em que a próxima janela começa
+ * @return bool true se ainda resta ao menos um segundo de verde na janela corrente
+ */
+bool janela_coordenada(Cruzamento *c, double agora, EstadoFluxo *eixo, double *fim, double *seguinte){
+    // Somar um ciclo mantém o decorrido positivo (defasagem < ciclo), para que a divisão inteira arredonde para baixo
+    double decorrido = agora - c->defasagem + ciclo_corredor + 1e-6, posicao, inicio_ciclo, fim_arterial = ciclo_corredor * FRACAO_ARTERIAL;
+    long ciclos = (long) (decorrido / ciclo_corredor);
+
+    posicao = decorrido - ciclos * ciclo_corredor;
+    inicio_ciclo = agora - posicao;
+
+    // O verde arterial que se encerrou cedo (fila vazia) cede o resto da janela ao eixo Norte-Sul
+    if(posicao < fim_arterial && !(c->estado_atual == FLUXO_LO && c->inicio_verde >= inicio_ciclo - 1e-6)){
+        *eixo = FLUXO_LO;
+        *seguinte = inicio_ciclo + fim_arterial;
+    }
+    else{
+        *eixo = FLUXO_NS;
+        *seguinte = inicio_ciclo + ciclo_corredor;
+    }
+    *fim = *seguinte - TEMPO_TRAVESSIA;
+    return *fim - agora >= 1;
+}
+
+/**
+ * @brief Função da Thread controladora do cruzamento.Opera em um loop infinito, implementando uma máquina de estados que gerencia o fluxo de
+ * tráfego. A cada ciclo, ela avalia o estado do cruzamento e decide qual ação tomar, alternando entre dois modos principais:
+ *      1. Modo de Emergência: Ativado quando uma ambulância chega. Este modo tem prioridade máxima, interrompe o fluxo normal, esvazia o
+ * cruzamento e libera a passagem para a ambulância.
+ *      2.  Modo Normal: Operação padrão que calcula a demanda de carros em cada fluxo, abre o sinal para a via mais congestionada por um
+ * tempo dinâmico e previne starvation: o eixo cujo carro mais antigo se aproxima de 'espera_maxima' é aberto mesmo com menor demanda,
+ * encerrando antes o verde do outro eixo se preciso.
+ *
+ * Com --coordenar, o modo normal segue um plano de tempo fixo em vez da demanda: o ciclo comum 'ciclo_corredor' começa em
+ * c->defasagem com a janela do eixo Leste-Oeste (arterial), seguida da janela Norte-Sul, cada uma terminada por TEMPO_TRAVESSIA de
+ * esvaziamento (ver janela_coordenada()). As emergências continuam tendo prioridade; ao terminarem, a controladora espera a próxima janela do plano.
+ *
+ * A etapa da máquina de estados (c->fase_controlador) e seus prazos ficam no cruzamento para que o checkpoint os capture.
+ *
+ * @param arg Ponteiro para o Cruzamento controlado por esta thread.
+ * @return void* Sempre retorna NULL, pois a thread nunca termina.
+ */
+void * fluxo_trafego(void* arg){
+    Cruzamento *c = (Cruzamento*) arg;
+    // Declaração de variáveis locais para o ciclo de decisão
+    EstadoFluxo proximo_estado;
+    int demanda_ns, demanda_lo, num_carros, tempo_final, jusante[NUM_DIRECOES] = {0};
+    bool fila_ativa_esvaziou = false, espera_estourou = false, pressao_superada = false, emergencia_anunciada = false, so_admissao, intervencao;
+    double espera_ns, espera_lo, espera_oposta, criterio_ns, criterio_lo, janela_fim, janela_seguinte;
+    EstadoFluxo eixo_oposto;
+
+    indice_thread = (c->indice == 0) ? INDICE_CONTROLADOR : total_veiculos + c->indice;
+
+    // A espera pelo fim da emergência começa com o lock adquirido
+    if(c->fase_controlador == CONTROLE_EMERGENCIA) adquirir_cruzamento(c);
+
+    while(1){
+        switch(c->fase_controlador){
+        case CONTROLE_PAUSA:
+            // Pausa inicial em cada ciclo para permitir que as filas de veículos se formem antes de tomar uma decisão, evitando alternâncias de fluxo
+            // muito rápidas com o cruzamento vazio
+            dormir_ate(c->prazo_controlador);
+
+            // As filas de jusante da política de pressão são lidas antes do lock deste cruzamento (ver ler_filas_jusante())
+            if(politica == POLITICA_PRESSAO) ler_filas_jusante(c, jusante);
+
+            // Adquire o lock principal para garantir acesso exclusivo a todas as variáveis compartilhadas na struct cruzamento
+            adquirir_cruzamento(c);
+
+            // Verifica a flag de emergência para decidir qual protocolo seguir
+            if(c->modo_emergencia){
+
+                // Garante que o cruzamento esteja livre antes de liberar a passagem para a ambulância; ambulâncias que entraram durante o fluxo
+                // normal do seu eixo também precisam sair, pois a próxima fase pode ser a do eixo transversal
+                while(c->carros_no_cruzamento > 0 || c->ambulancias_no_cruzamento > 0){
+                    LOG_CONTROLE("---------------- ESPERANDO %d CARRO(S) E %d AMBULANCIA(S) SAIREM PARA TOMAR A PROXIMA DECISAO ----------------\n",
+                        c->carros_no_cruzamento, c->ambulancias_no_cruzamento);
+                    esperar_cruzamento(c);
+                }
+
+                // Abre o eixo com mais ambulâncias esperando
+                proximo_estado = controle_eixo_ambulancias(c->ambulancias_esperando);
+
+                iniciar_fase(c, proximo_estado);
+                c->fase_controlador = CONTROLE_EMERGENCIA;
+
+                LOG_CONTROLE("---------------- !!! EMERGENCIA !!! ----------------\n");
+                LOG_CONTROLE("---------------- !!! ABERTO PARA: AMBULANCIA(S) %s !!! ----------------\n", (proximo_estado == AMBULANCIA_NS) ? "NORTE-SUL" : "LESTE-OESTE");
+
+                // Notifica as ambulâncias; a próxima iteração entra em CONTROLE_EMERGENCIA ainda com o lock adquirido
+                pthread_cond_broadcast(&c->pode_cruzar);
+                break;
+            }
+
+            // Garante que o cruzamento esteja livre antes de abrir para um novo fluxo
+            while(c->carros_no_cruzamento > 0 || c->ambulancias_no_cruzamento > 0){
+                LOG_CONTROLE("---------------- ESPERANDO %d CARRO(S) E %d AMBULANCIA(S) SAIREM PARA MUDAR O FLUXO ----------------\n",
+                    c->carros_no_cruzamento, c->ambulancias_no_cruzamento);
+                esperar_cruzamento(c);
+            }
+
+            // Calcula a demanda de carros para decidir o próximo fluxo, pela faixa crítica de cada eixo (ver controle_demanda_faixas())
+            demanda_ns = controle_demanda_faixas(c->fila_faixa, num_faixas, FLUXO_NS);
+            demanda_lo = controle_demanda_faixas(c->fila_faixa, num_faixas, FLUXO_LO);
+
+            // Corredor coordenado: abre o eixo da janela corrente do plano até o seu fim; se ela já não comporta ao menos um segundo de
+            // verde, dorme até o início da próxima janela
+            if(corredor_coordenado){
+                if(!janela_coordenada(c, tempo_simulacao(), &proximo_estado, &janela_fim, &janela_seguinte)){
+                    c->prazo_controlador = janela_seguinte;
+                    pthread_mutex_unlock(&c->lock);
+                    break;
+                }
+                num_carros = fila_do_eixo(c, proximo_estado);
+                iniciar_fase(c, proximo_estado);
+                tempo_final = (int) (janela_fim - tempo_simulacao() + 0.5);
+
+                LOG_CONTROLE("---------------- CRUZAMENTO %d: FLUXO %s ABERTO PELO PLANO COORDENADO POR %d SEGUNDOS PARA %d CARROS ----------------\n",
+                    c->indice, proximo_estado == FLUXO_NS ? "NORTE-SUL" : "LESTE-OESTE", tempo_final, num_carros);
+
+                c->fase_controlador = CONTROLE_VERDE;
+                c->carros_fase = num_carros;
+                c->fim_verde = janela_fim;
+                c->inicio_verde = tempo_simulacao();
+                c->prazo_controlador = (c->inicio_verde + 1 < janela_fim) ? c->inicio_verde + 1 : janela_fim;
+                c->ultima_entrada = c->inicio_verde;
+                c->entradas_verde = 0;
+                abrir_faixas(c);
+
+                pthread_mutex_unlock(&c->lock);
+                break;
+            }
+
+            // Idade do carro mais antigo de cada eixo, usada pelo alvo de espera máxima e no desempate
+            espera_ns = espera_mais_antiga(c, FLUXO_NS, tempo_simulacao());
+            espera_lo = espera_mais_antiga(c, FLUXO_LO, tempo_simulacao());
+
+            // Critério da política em vigor: demanda (carros na fila) ou pressão (fila de montante menos a de jusante, pela vazão medida)
+            if(politica == POLITICA_PRESSAO){
+                criterio_ns = pressao(c, FLUXO_NS, jusante);
+                criterio_lo = pressao(c, FLUXO_LO, jusante);
+            }
+            else{
+                criterio_ns = demanda_ns;
+                criterio_lo = demanda_lo;
+            }
+
+            // Lógica de decisão para o próximo estado: o eixo de maior critério, salvo se algum eixo está prestes a estourar a espera máxima
+            proximo_estado = controle_escolher_eixo(criterio_ns, criterio_lo, espera_ns, espera_lo, espera_maxima, &intervencao);
+            if(intervencao){
+                atomic_fetch_add_explicit(&metricas.intervencoes_espera, 1, memory_order_relaxed);
+                LOG_CONTROLE("---------------- ALVO DE ESPERA: CARRO(S) %s ESPERANDO HA %.0fs, ABRINDO O FLUXO MESMO COM MENOR %s ----------------\n",
+                    proximo_estado == FLUXO_NS ? "NORTE-SUL" : "LESTE-OESTE", proximo_estado == FLUXO_NS ? espera_ns : espera_lo,
+                    politica == POLITICA_PRESSAO ? "PRESSAO" : "DEMANDA");
+            }
+            num_carros = fila_do_eixo(c, proximo_estado);
+            iniciar_fase(c, proximo_estado);
+
+            // Cálculo de Tempo Dinâmico: Define a duração da passagem que cada fluxo possui. Na política de pressão o verde só é limitado por
+            // T_MAXIMO: ele se encerra quando a pressão do outro eixo superar a do eixo aberto
+            if(politica == POLITICA_PRESSAO) tempo_final = T_MAXIMO;
+            else tempo_final = controle_tempo_verde(modelo_verde, c->vazao[proximo_estado], (proximo_estado == FLUXO_NS) ? demanda_ns : demanda_lo);
+
+            LOG_CONTROLE("---------------- FLUXO %s ABERTO POR ATE %d SEGUNDOS PARA %d CARROS ----------------\n",
+                c->estado_atual == FLUXO_NS ? "NORTE-SUL" : "LESTE-OESTE", tempo_final, num_carros);
+
+            // A thread dorme em incrementos de 1 segundo, verificando se a fila esvaziou
+            c->fase_controlador = CONTROLE_VERDE;
+            c->carros_fase = num_carros;
+            c->fim_verde = tempo_simulacao() + tempo_final;
+            c->prazo_controlador = tempo_simulacao() + 1;
+            c->inicio_verde = tempo_simulacao();
+            c->ultima_entrada = c->inicio_verde;
+            c->entradas_verde = 0;
+            // Notifica o primeiro carro de cada faixa do eixo aberto e libera o lock antes da espera
+            abrir_faixas(c);
+            pthread_mutex_unlock(&c->lock);
+            break;
+
+        case CONTROLE_VERDE:
+            // Acorda na próxima verificação ou antes, se alguma faixa tiver de ser liberada (prazo_admissao só é escrito por esta thread)
+            so_admissao = c->prazo_admissao < c->prazo_controlador - 1e-6;
+            dormir_ate(so_admissao ? c->prazo_admissao : c->prazo_controlador);
+            if(!so_admissao && politica == POLITICA_PRESSAO) ler_filas_jusante(c, jusante);
+
+            // Readquire o lock brevemente apenas para a verificação
+            adquirir_cruzamento(c);
+            liberar_faixas(c, so_admissao ? c->prazo_admissao : c->prazo_controlador);
+            if(so_admissao){
+                pthread_mutex_unlock(&c->lock);
+                break;
+            }
+
+            fila_ativa_esvaziou = false;
+
+            if(c->estado_atual == FLUXO_NS){
+                if(c->carros_esperando[NORTE] == 0 && c->carros_esperando[SUL] == 0) fila_ativa_esvaziou = true;
+            }
+            else{
+                if(c->carros_esperando[LESTE] == 0 && c->carros_esperando[OESTE] == 0) fila_ativa_esvaziou = true;
+            }
+
+            // Detector de starvation: se o carro mais antigo do eixo fechado está prestes a estourar a espera máxima, o verde é encerrado antes,
+            // mas só depois de T_MINIMO e se ele espera há mais tempo que o mais antigo do eixo aberto (ver controle_espera_estourou())
+            eixo_oposto = (c->estado_atual == FLUXO_NS) ? FLUXO_LO : FLUXO_NS;
+            espera_oposta = espera_mais_antiga(c, eixo_oposto, c->instante_controle);
+            espera_estourou = controle_espera_estourou(espera_maxima, c->instante_controle - c->inicio_verde, fila_ativa_esvaziou,
+                espera_mais_antiga(c, c->estado_atual, c->instante_controle), espera_oposta);
+
+            // No plano coordenado só o verde arterial pode terminar antes do fim da janela, e apenas depois de T_MINIMO, quando o pelotão
+            // vindo do cruzamento anterior já passou
+            if(corredor_coordenado){
+                espera_estourou = false;
+                if(c->estado_atual != FLUXO_LO || c->instante_controle - c->inicio_verde < T_MINIMO) fila_ativa_esvaziou = false;
+            }
+
+            // Max-pressure: passado o verde mínimo, encerra quando o eixo fechado tiver pressão maior que o aberto
+            pressao_superada = controle_pressao_superada(politica, c->instante_controle - c->inicio_verde, fila_ativa_esvaziou, espera_estourou,
+                pressao(c, c->estado_atual, jusante), pressao(c, eixo_oposto, jusante));
+
+            // Uma ambulância anunciada barra a entrada de carros (controle_pode_passar()): manter o verde até o fim só atrasaria o atendimento dela
+            emergencia_anunciada = c->modo_emergencia;
+
+            // Se a fila esvaziou, o outro eixo não pode mais esperar ou há emergência, interrompe a espera; senão, segue até o fim do tempo
+            // calculado. Ao encerrar, nenhum carro novo entra, para que o cruzamento esvazie no tempo de uma travessia
+            if(fila_ativa_esvaziou || espera_estourou || pressao_superada || emergencia_anunciada || c->prazo_controlador >= c->fim_verde - 1e-6){
+                c->fase_controlador = CONTROLE_PAUSA;
+                c->prazo_controlador = tempo_simulacao() + TEMPO_PAUSA;
+                c->fluxo_encerrado = true;
+                encerrar_verde(c);
+                if(espera_estourou) atomic_fetch_add_explicit(&metricas.intervencoes_espera, 1, memory_order_relaxed);
+            }
+            else c->prazo_controlador = (c->prazo_controlador + 1 < c->fim_verde) ? c->prazo_controlador + 1 : c->fim_verde;
+
+            pthread_mutex_unlock(&c->lock);
+
+            if(emergencia_anunciada){
+                LOG_CONTROLE("---------------- EMERGENCIA ANUNCIADA, ENCERRANDO PASSAGEM ----------------\n");
+            }
+            else if(fila_ativa_esvaziou){
+                LOG_CONTROLE("---------------- FILA ATUAL DE CARROS (%s) ESVAZIOU, ENCERRANDO PASSAGEM ----------------\n",
+                    c->estado_atual == FLUXO_NS ? "NORTE-SUL" : "LESTE-OESTE");
+            }
+            else if(espera_estourou){
+                LOG_CONTROLE("---------------- ALVO DE ESPERA: CARRO(S) %s ESPERANDO HA %.0fs, ENCERRANDO PASSAGEM ----------------\n",
+                    c->estado_atual == FLUXO_NS ? "LESTE-OESTE" : "NORTE-SUL", espera_oposta);
+            }
+            else if(pressao_superada){
+                LOG_CONTROLE("---------------- PRESSAO DO FLUXO %s SUPEROU A DO FLUXO ABERTO, ENCERRANDO PASSAGEM ----------------\n",
+                    c->estado_atual == FLUXO_NS ? "LESTE-OESTE" : "NORTE-SUL");
+            }
+            break;
+
+        case CONTROLE_EMERGENCIA:
+            // O controlador entra em um estado de espera passiva. Prosseguirá quando a última ambulância a sair definir modo_emergencia para false e der broadcast
+            while(c->modo_emergencia){
+                // Se o eixo aberto já foi atendido e há ambulâncias esperando no outro, alterna o eixo assim que o cruzamento esvaziar
+                if(controle_alternar_ambulancias(c->estado_atual, c->ambulancias_esperando, c->ambulancias_no_cruzamento)){
+                    proximo_estado = (c->estado_atual == AMBULANCIA_NS) ? AMBULANCIA_LO : AMBULANCIA_NS;
+                    iniciar_fase(c, proximo_estado);
+                    LOG_CONTROLE("---------------- !!! ABERTO PARA: AMBULANCIA(S) %s !!! ----------------\n", (proximo_estado == AMBULANCIA_NS) ? "NORTE-SUL" : "LESTE-OESTE");
+                    pthread_cond_broadcast(&c->pode_cruzar);
+                }
+                esperar_cruzamento(c);
+            }
+            LOG_CONTROLE("---------------- !!! EMERGENCIA FINALIZADA !!! ----------------\n");
+            LOG_CONTROLE("---------------- VOLTANDO AO MODO NORMAL ----------------\n");
+            c->fase_controlador = CONTROLE_PAUSA;
+            c->prazo_controlador = tempo_simulacao() + TEMPO_PAUSA;
+
+            // Libera o lock no final do ciclo de emergência
+            pthread_mutex_unlock(&c->lock);
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Descobre os nós NUMA e os processadores de cada um permitidos ao processo (em /sys/devices/system/node/nodeN/cpulist). Sem essa
+ * informação, todos os processadores permitidos formam um único nó.
+ *
+ * @return int 0 em caso de sucesso, -1 se não foi possível ler os processadores permitidos
+ */
+int carregar_nos_numa(void){
+    cpu_set_t permitidos;
+    char caminho[64];
+    FILE *f;
+    int no, inicio, fim, cpu, n;
+    char separador;
+
+    if(sched_getaffinity(0, sizeof(permitidos), &permitidos) != 0){
+        perror("sched_getaffinity");
+        return -1;
+    }
+    num_nos = 0;
+    for(no = 0; no < MAX_NOS_NUMA * 4 && num_nos < MAX_NOS_NUMA; no++){
+        snprintf(caminho, sizeof(caminho), DIRETORIO_NOS "/node%d/cpulist", no);
+        if((f = fopen(caminho, "r")) == NULL) continue;
+        // Lista no formato "0-3,8-11"
+        CPU_ZERO(&processadores_no[num_nos]);
+        while((n = fscanf(f, "%d%c", &inicio, &separador)) >= 1){
+            fim = inicio;
+            if(n == 2 && separador == '-' && fscanf(f, "%d%c", &fim, &separador) < 1) break;
+            for(cpu = inicio; cpu <= fim && cpu < CPU_SETSIZE; cpu++) if(CPU_ISSET(cpu, &permitidos)) CPU_SET(cpu, &processadores_no[num_nos]);
+            if(n == 1 || separador != ',') break;
+        }
+        fclose(f);
+        if(CPU_COUNT(&processadores_no[num_nos]) > 0) num_nos++;
+    }
+    if(num_nos == 0){
+        processadores_no[0] = permitidos;
+        num_nos = 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Restringe os atributos de criação de uma thread do cruzamento 'k' aos processadores do seu nó NUMA: os cruzamentos são
+ * distribuídos entre os nós em rodízio, e todas as threads de um cruzamento (a controladora e os veículos que partem dele) ficam no
+ * mesmo nó, de modo que o lock, a condicional e os contadores do cruzamento circulam só entre os caches de um soquete. A controladora,
+ * que acorda a cada segundo, vai para um processador fixo do nó; os veículos podem usar qualquer um deles.
+ *
+ * Com k = -1 (veículo sem cruzamento fixo: os carros Leste-Oeste de um corredor, que passam por todos os cruzamentos), a thread fica
+ * livre em todos os processadores permitidos. Como os atributos são reaproveitados entre as threads dos veículos, a afinidade é sempre
+ * reescrita.
+ *
+ * @return int 0 em caso de sucesso, -1 se pthread_attr_setaffinity_np() falhou (os atributos ficam como estavam)
+ */
+int fixar_atributos(pthread_attr_t *atributos, int k, bool controladora){
+    cpu_set_t todos, um, *nos;
+    int cpu, vez, erro, no;
+
+    if(k < 0){
+        CPU_ZERO(&todos);
+        for(no = 0; no < num_nos; no++) CPU_OR(&todos, &todos, &processadores_no[no]);
+        nos = &todos;
+    }else{
+        nos = &processadores_no[k % num_nos];
+    }
+    if(!controladora){
+        erro = pthread_attr_setaffinity_np(atributos, sizeof(cpu_set_t), nos);
+    }else{
+        vez = k / num_nos % CPU_COUNT(nos);
+        CPU_ZERO(&um);
+        for(cpu = 0; cpu < CPU_SETSIZE; cpu++){
+            if(CPU_ISSET(cpu, nos) && vez-- == 0){
+                CPU_SET(cpu, &um);
+                break;
+            }
+        }
+        erro = pthread_attr_setaffinity_np(atributos, sizeof(cpu_set_t), &um);
+    }
+    if(erro != 0){
+        fprintf(stderr, "pthread_attr_setaffinity_np: %s\n", strerror(erro));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Thread principal main responsáve pela inicialização de variáveis e criação das threads que serão utilizadas ao longo do código.
+ * 
+ * @param argc inteiro que indica o número de argumentos de linha de comando fornecidos quando o programa é executado, incluindo o próprio nome do programa
+ * @param argv parâmetro passado para a função principal, permitindo que o programa receba argumentos de linha de comando
+ * @return int declaração usada para indicar a execução bem-sucedida do programa para o sistema operacional
+ */
+int main(int argc, char * argv[]){
+    int i;                                       // Variável do laço for
+    int thread_idx = 0;                          // Contador para gerar os ids únicos de cada thread de veículos                       
+    int tipo, dir, k, replicas;                  // Variáveis dos laços de inicialização dos veículos e dos cruzamentos
+    int faixas_ns, faixas_lo;                    // Faixas de cada eixo (--faixas)
+    pthread_t veiculos_t[MAX_VEICULOS];          // Threads dos veículos envolvidos no corredor
+    pthread_t fluxo[MAX_CRUZAMENTOS];            // Threads de controle de cada cruzamento
+    Cruzamento *c;
+    pthread_t exportador;                        // Thread exportadora de métricas Prometheus
+    pthread_attr_t atributos;                    // Atributos de criação das threads da simulação (pilha e afinidade)
+    struct timespec fim_partida;
+    long pilha_kb;
+    int nivel;                                   // Nível pedido em --log
+    size_t pilha;
+    bool publicar_shm = false;                   // Publicar as métricas ao vivo em memória compartilhada (--shm)
+    bool corredor;                               // Veículo que percorre o corredor inteiro (sem afinidade fixa)
+    const char *destino_prometheus = NULL;       // Arquivo ou ":PORTA" para o exportador Prometheus (--prometheus)
+    const char *arquivo_gravar = NULL;           // Arquivo onde gravar o entrelaçamento das threads (--gravar)
+    const char *arquivo_reproduzir = NULL;       // Gravação cujo entrelaçamento deve ser reproduzido (--reproduzir)
+    int duracao = 0;                             // Duração da simulação em segundos (--duracao; 0 = até receber SIGINT/SIGTERM)
+    const char *arquivo_checkpoint = NULL;       // Arquivo onde salvar checkpoints (--checkpoint)
+    const char *arquivo_restaurar = NULL;        // Checkpoint a partir do qual a simulação continua (--restaurar)
+    const char *diretorio = NULL;                // Diretório dos registros colunares (--registros)
+    double instante_checkpoint = -1;             // Instante da simulação em que salvar o checkpoint (--checkpoint-em)
+    uint64_t semente = 0;                        // Semente dos geradores pseudoaleatórios dos veículos (--semente)
+    bool semente_definida = false;
+    bool verificar = false;                      // Ligar o verificador de invariantes de segurança (--verificar)
+    bool divergiu;                               // A gravação não pôde ser fechada ou a reprodução não conferiu com ela
+    sigset_t sinais;                             // Sinais tratados pela main: término ordenado e pedido de checkpoint
+    int sinal;
+    double espera, agora, duracao_fim;
+    struct timespec limite;
+
+    // Tratamento dos argumentos de linha de comando
+    for(i = 1; i < argc; i++){
+        if(strcmp(argv[i], "--shm") == 0) publicar_shm = true;
+        else if(strcmp(argv[i], "--monitor") == 0) return monitorar_metricas(1000);
+        else if(strcmp(argv[i], "--prometheus") == 0 && i + 1 < argc) destino_prometheus = argv[++i];
+        else if(strcmp(argv[i], "--gravar") == 0 && i + 1 < argc) arquivo_gravar = argv[++i];
+        else if(strcmp(argv[i], "--reproduzir") == 0 && i + 1 < argc) arquivo_reproduzir = argv[++i];
+        else if(strcmp(argv[i], "--duracao") == 0 && i + 1 < argc) duracao = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) arquivo_checkpoint = argv[++i];
+        else if(strcmp(argv[i], "--checkpoint-em") == 0 && i + 1 < argc) instante_checkpoint = atof(argv[++i]);
+        else if(strcmp(argv[i], "--restaurar") == 0 && i + 1 < argc) arquivo_restaurar = argv[++i];
+        else if(strcmp(argv[i], "--verificar") == 0) verificar = true;
+        else if(strcmp(argv[i], "--registros") == 0 && i + 1 < argc) diretorio = argv[++i];
+        else if(strcmp(argv[i], "--afinidade") == 0) afinidade = true;
+        else if(strcmp(argv[i], "--log") == 0 && i + 1 < argc){
+            for(nivel = NIVEL_LOG_NENHUM; nivel <= NIVEL_LOG_VEICULOS && strcmp(argv[i + 1], nome_nivel_log[nivel]) != 0; nivel++);
+            if(nivel > NIVEL_LOG_VEICULOS){
+                fprintf(stderr, "--log deve ser nenhum, avisos, controle ou veiculos\n");
+                return 1;
+            }
+            if(nivel > NIVEL_LOG_COMPILADO) fprintf(stderr, "--log %s: esta versao foi compilada so ate o nivel %s\n", argv[i + 1],
+                nome_nivel_log[NIVEL_LOG_COMPILADO]);
+            nivel_log = nivel;
+            i++;
+        }
+        else if(strcmp(argv[i], "--pilha") == 0 && i + 1 < argc){
+            pilha_kb = atol(argv[++i]);
+            if(pilha_kb != 0 && (pilha_kb < 0 || pilha_kb * 1024 < (long) PTHREAD_STACK_MIN)){
+                fprintf(stderr, "--pilha deve ser 0 (padrao do sistema) ou ao menos %ld KB\n", (long) PTHREAD_STACK_MIN / 1024);
+                return 1;
+            }
+            pilha_threads = (size_t) pilha_kb * 1024;
+        }
+        else if(strcmp(argv[i], "--verde") == 0 && i + 1 < argc && strcmp(argv[i + 1], "formula") == 0){
+            modelo_verde = VERDE_FORMULA;
+            i++;
+        }
+        else if(strcmp(argv[i], "--verde") == 0 && i + 1 < argc && strcmp(argv[i + 1], "vazao") == 0){
+            modelo_verde = VERDE_VAZAO;
+            i++;
+        }
+        else if(strcmp(argv[i], "--politica") == 0 && i + 1 < argc && strcmp(argv[i + 1], "demanda") == 0){
+            politica = POLITICA_DEMANDA;
+            i++;
+        }
+        else if(strcmp(argv[i], "--politica") == 0 && i + 1 < argc && strcmp(argv[i + 1], "pressao") == 0){
+            politica = POLITICA_PRESSAO;
+            i++;
+        }
+        else if(strcmp(argv[i], "--escala") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0) escala_tempo = atof(argv[++i]);
+        else if(strcmp(argv[i], "--espera-maxima") == 0 && i + 1 < argc){
+            espera_maxima = atof(argv[++i]);
+            if(espera_maxima != 0 && espera_maxima <= FOLGA_ESPERA){
+                fprintf(stderr, "--espera-maxima deve ser 0 (desligada) ou maior que %d segundos\n", FOLGA_ESPERA);
+                return 1;
+            }
+        }
+        else if(strcmp(argv[i], "--corredor") == 0 && i + 1 < argc){
+            num_cruzamentos = atoi(argv[++i]);
+            if(num_cruzamentos < 1 || num_cruzamentos > MAX_CRUZAMENTOS){
+                fprintf(stderr, "--corredor deve estar entre 1 e %d cruzamentos\n", MAX_CRUZAMENTOS);
+                return 1;
+            }
+        }
+        else if(strcmp(argv[i], "--coordenar") == 0) corredor_coordenado = true;
+        else if(strcmp(argv[i], "--trecho") == 0 && i + 1 < argc && atof(argv[i + 1]) >= 0) tempo_trecho = atof(argv[++i]);
+        else if(strcmp(argv[i], "--ciclo") == 0 && i + 1 < argc) ciclo_corredor = atof(argv[++i]);
+        else if(strcmp(argv[i], "--saturacao") == 0 && i + 1 < argc && atof(argv[i + 1]) >= 0) intervalo_saturacao = atof(argv[++i]);
+        else if(strcmp(argv[i], "--faixas") == 0 && i + 1 < argc){
+            if(sscanf(argv[++i], "%d,%d", &faixas_ns, &faixas_lo) != 2 || faixas_ns < 1 || faixas_ns > MAX_FAIXAS
+                || faixas_lo < 1 || faixas_lo > MAX_FAIXAS){
+                fprintf(stderr, "--faixas deve ser NS,LO com 1 a %d faixas em cada eixo\n", MAX_FAIXAS);
+                return 1;
+            }
+            num_faixas[NORTE] = num_faixas[SUL] = faixas_ns;
+            num_faixas[LESTE] = num_faixas[OESTE] = faixas_lo;
+        }
+        else if(strcmp(argv[i], "--semente") == 0 && i + 1 < argc){
+            semente = strtoull(argv[++i], NULL, 10);
+            semente_definida = true;
+        }
+        else{
+            fprintf(stderr, "Uso: %s [--shm] [--prometheus ARQUIVO|:PORTA] [--gravar ARQUIVO | --reproduzir ARQUIVO] [--duracao SEGUNDOS]\n"
+                            "          [--checkpoint ARQUIVO [--checkpoint-em SEGUNDOS]] [--restaurar ARQUIVO] [--semente N] [--verificar]\n"
+                            "          [--espera-maxima SEGUNDOS] [--verde formula|vazao] [--politica demanda|pressao] [--escala FATOR]\n"
+                            "          [--saturacao SEGUNDOS] [--faixas NS,LO] [--afinidade] [--pilha KB]\n"
+                            "          [--log nenhum|avisos|controle|veiculos] [--registros DIRETORIO]\n"
+                            "          [--corredor N [--coordenar] [--trecho SEGUNDOS] [--ciclo SEGUNDOS]]\n"
+                            "       %s --monitor\n", argv[0], argv[0]);
+            return 1;
+        }
+    }
+
+    if(afinidade && carregar_nos_numa() < 0) return 1;
+    if(ciclo_corredor <= 0) ciclo_corredor = 2 * (TEMPO_TRAVESSIA + tempo_trecho);
+    if(ciclo_corredor * FRACAO_ARTERIAL < TEMPO_TRAVESSIA + 1 || ciclo_corredor * (1 - FRACAO_ARTERIAL) < TEMPO_TRAVESSIA + 1){
+        fprintf(stderr, "--ciclo deve deixar ao menos %d segundos para cada eixo\n", TEMPO_TRAVESSIA + 1);
+        return 1;
+    }
+
+    // Inicialização dos elementos de threads (locks, condicionais), contadores e identificadores utilizados no código
+    for(k = 0; k < num_cruzamentos; k++){
+        c = &cruzamentos[k];
+        pthread_mutex_init(&c->lock, NULL);
+        pthread_cond_init(&c->pode_cruzar, NULL);
+        c->indice = k;
+        c->estado_atual = FLUXO_NS;
+        c->carros_no_cruzamento = 0;
+        c->ambulancias_no_cruzamento = 0;
+        c->modo_emergencia = false;
+        c->ambulancias_em_emergencia = 0;
+        for(i = 0; i < NUM_DIRECOES; i++){
+            c->carros_esperando[i] = 0;
+            c->contadores_id_carros[i] = 1;
+            c->contadores_id_ambulancias[i] = 1;
+            c->ambulancias_esperando[i] = 0;
+        }
+        for(i = 0; i < NUM_DIRECOES * MAX_FAIXAS; i++){
+            c->fila_faixa[i] = 0;
+            c->cabeca_faixa[i] = c->cauda_faixa[i] = -1;
+            c->proxima_entrada[i] = 0;
+            c->faixa_liberada[i] = true;
+        }
+        c->prazo_admissao = 0;
+        c->instante_controle = 0;
+        c->fase_controlador = CONTROLE_PAUSA;
+        c->prazo_controlador = TEMPO_PAUSA;
+        c->fluxo_encerrado = true;
+        c->vazao[FLUXO_NS] = c->vazao[FLUXO_LO] = VAZAO_INICIAL;
+        c->fase = 0;
+        c->atendidos_fase[TIPO_CARRO] = c->atendidos_fase[TIPO_AMBULANCIA] = 0;
+        c->abertura_fase = 0;
+        clock_gettime(CLOCK_REALTIME, &c->inicio_fase);
+    }
+    calcular_defasagens();
+    metricas.vazao_mcps[FLUXO_NS] = metricas.vazao_mcps[FLUXO_LO] = (uint64_t) (VAZAO_INICIAL * 1000);
+    clock_gettime(CLOCK_MONOTONIC, &origem_relogio);
+    if(!semente_definida) semente = (uint64_t) time(NULL);
+
+    // Estado inicial dos veículos, na mesma ordem de criação das threads: carros se aproximando com um tempo sorteado e
+    // ambulâncias anunciando a emergência logo na partida. No corredor, os carros Leste-Oeste são um único conjunto que percorre todos
+    // os cruzamentos; os carros Norte-Sul e as ambulâncias são replicados em cada cruzamento
+    for(tipo = 0; tipo < NUM_TIPOS; tipo++){
+        for(dir = 0; dir < NUM_DIRECOES; dir++){
+            replicas = (tipo == TIPO_CARRO && controle_eixo((Direcao) dir) == FLUXO_LO) ? 1 : num_cruzamentos;
+            for(k = 0; k < replicas; k++){
+                for(i = 0; i < quantidade_veiculos[tipo][dir]; i++){
+                    Veiculo *v = &veiculos[thread_idx];
+                    v->id = 0;
+                    v->direcao = (Direcao) dir;
+                    v->tipo = (TipoVeiculo) tipo;
+                    v->semente = semente_veiculo(semente, thread_idx);
+                    v->estado = VEICULO_APROXIMANDO;
+                    v->prazo = (tipo == TIPO_CARRO) ? sortear(&v->semente, 2, 8) : 0;
+                    v->chegada = 0;
+                    v->entrada = 0;
+                    v->fase = -1;
+                    v->cruzamento = primeiro_cruzamento(k, (Direcao) dir);
+                    v->inicio_percurso = 0;
+                    v->paradas_percurso = 0;
+                    v->seguinte = -1;
+                    pthread_cond_init(&v->vez, NULL);
+                    thread_idx++;
+                }
+            }
+        }
+    }
+    total_veiculos = thread_idx;
+
+    if(arquivo_restaurar != NULL){
+        if(restaurar_checkpoint(arquivo_restaurar) < 0) return 1;
+        // Uma semente explícita na restauração cria uma variação "e se" a partir do mesmo estado aquecido
+        if(semente_definida){
+            for(i = 0; i < total_veiculos; i++) veiculos[i].semente = semente_veiculo(semente, i);
+        }
+    }
+    if(verificar) iniciar_verificacao();
+    if(publicar_shm && iniciar_metricas_shm() == 0) publicar_metricas(&cruzamentos[0]);
+    if(destino_prometheus != NULL && pthread_create(&exportador, NULL, exportador_prometheus, (void*) destino_prometheus) != 0){
+        fprintf(stderr, "pthread_create falhou no exportador prometheus\n");
+        return 1;
+    }
+    if(arquivo_gravar != NULL && iniciar_gravacao(arquivo_gravar) < 0) return 1;
+    if(arquivo_reproduzir != NULL && iniciar_reproducao(arquivo_reproduzir) < 0) return 1;
+    if(diretorio != NULL && iniciar_registros(diretorio) < 0) return 1;
+
+    // Os sinais de término e de checkpoint (SIGUSR1) são bloqueados antes de criar as threads (que herdam a máscara) e tratados apenas pela main
+    sigemptyset(&sinais);
+    sigaddset(&sinais, SIGINT);
+    sigaddset(&sinais, SIGTERM);
+    sigaddset(&sinais, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &sinais, NULL);
+    
+    atribuir_ids();
+
+    // Criação das threads controladoras (fluxo_trafego), uma por cruzamento, com a pilha reduzida
+    clock_gettime(CLOCK_MONOTONIC, &inicio_partida);
+    for(k = 0; k < num_cruzamentos; k++){
+        pthread_attr_init(&atributos);
+        if(pilha_threads > 0) pthread_attr_setstacksize(&atributos, pilha_threads);
+        if(afinidade && fixar_atributos(&atributos, k, true) < 0) return 1;
+        if(pthread_create(&fluxo[k], &atributos, fluxo_trafego, &cruzamentos[k]) != 0){
+            fprintf(stderr, "pthread_create falhou na controladora do cruzamento %d\n", k);
+            return 1;
+        }
+        pthread_attr_destroy(&atributos);
+    }
+
+    // Criação das threads dos veículos, na ordem de veiculos[]: carros e depois ambulâncias, de Norte a Oeste. Os argumentos ficam em
+    // args_veiculos[], preenchido de uma vez, sem uma alocação por thread
+    for(thread_idx = 0; thread_idx < total_veiculos; thread_idx++){
+        args_veiculos[thread_idx].direcao = veiculos[thread_idx].direcao;
+        args_veiculos[thread_idx].indice = thread_idx + 1;
+    }
+    pthread_attr_init(&atributos);
+    if(pilha_threads > 0) pthread_attr_setstacksize(&atributos, pilha_threads);
+    for(thread_idx = 0; thread_idx < total_veiculos; thread_idx++){
+        // Os carros Leste-Oeste de um corredor não são fixados: eles passam por cruzamentos de todos os nós ao longo do percurso
+        corredor = num_cruzamentos > 1 && veiculos[thread_idx].tipo == TIPO_CARRO && controle_eixo(veiculos[thread_idx].direcao) == FLUXO_LO;
+        if(afinidade && fixar_atributos(&atributos, corredor ? -1 : veiculos[thread_idx].cruzamento, false) < 0) return 1;
+        if(pthread_create(&veiculos_t[thread_idx], &atributos, veiculos[thread_idx].tipo == TIPO_CARRO ? carros : ambulancia,
+            &args_veiculos[thread_idx]) != 0){
+            fprintf(stderr, "pthread_create falhou no veiculo %d de %d\n", thread_idx + 1, total_veiculos);
+            return 1;
+        }
+    }
+    pthread_attr_destroy(&atributos);
+    clock_gettime(CLOCK_MONOTONIC, &fim_partida);
+    partida_ms = (fim_partida.tv_sec - inicio_partida.tv_sec) * 1e3 + (fim_partida.tv_nsec - inicio_partida.tv_nsec) / 1e6;
+    pthread_attr_init(&atributos);
+    if(pilha_threads > 0) pthread_attr_setstacksize(&atributos, pilha_threads);
+    pthread_attr_getstacksize(&atributos, &pilha);
+    pthread_attr_destroy(&atributos);
+    LOG_AVISO("---------------- %d THREADS CRIADAS EM %.3f ms (PILHA DE %zu KB) ----------------\n", num_cruzamentos + total_veiculos, partida_ms,
+        pilha / 1024);
+
+    // As threads dos veículos nunca terminam: a main atende os pedidos de checkpoint e aguarda o fim da duração ou um sinal de término
+    // para encerrar o processo de forma ordenada. A duração é contada a partir do início desta execução, mesmo quando restaurada. Uma
+    // reprodução termina no último evento gravado, que envia o sinal de término (ver consumir_vez()), e ignora a duração.
+    duracao_fim = (duracao > 0 && !reproduzindo) ? tempo_simulacao() + duracao : -1;
+    while(1){
+        agora = tempo_simulacao();
+        if(instante_checkpoint >= 0 && arquivo_checkpoint != NULL && agora >= instante_checkpoint){
+            salvar_checkpoint(arquivo_checkpoint);
+            instante_checkpoint = -1;
+        }
+        if(duracao_fim >= 0 && agora >= duracao_fim) break;
+
+        // Espera até o próximo evento agendado (checkpoint ou fim), ou indefinidamente se não houver nenhum
+        espera = -1;
+        if(instante_checkpoint >= 0 && arquivo_checkpoint != NULL) espera = instante_checkpoint - agora;
+        if(duracao_fim >= 0 && (espera < 0 || duracao_fim - agora < espera)) espera = duracao_fim - agora;
+        if(espera >= 0){
+            espera /= escala_tempo;
+            limite.tv_sec = (time_t) espera;
+            limite.tv_nsec = (long) ((espera - (time_t) espera) * 1e9);
+            sinal = sigtimedwait(&sinais, NULL, &limite);
+        }
+        else sigwait(&sinais, &sinal);
+
+        if(sinal == SIGUSR1){
+            if(arquivo_checkpoint != NULL) salvar_checkpoint(arquivo_checkpoint);
+            else fprintf(stderr, "SIGUSR1 ignorado: use --checkpoint ARQUIVO para habilitar checkpoints\n");
+        }
+        else if(sinal == SIGINT || sinal == SIGTERM) break;
+    }
+
+    divergiu = finalizar_gravacao() < 0;
+    finalizar_registros();
+    relatorio_verificacao();
+    relatorio_espera();
+    relatorio_resumo();
+
+
+    return divergiu ? 1 : 0;
 }
\ No newline at end of file
@@ -0,0 +1,504 @@
+/**
+ *
+ * Interface pública do motor de simulação do cruzamento (libcruzamento.a).
+ *
+ *      O motor simula um cruzamento de quatro vias com a mesma controladora do simulador com threads (cruzamento.c): escolha do eixo
+ * por demanda ou pressão, tempo de verde pela vazão observada, alvo de espera máxima, vazão de saturação por faixa, filas em ordem
+ * de chegada e prioridade das ambulâncias. Cada instância (Motor) é independente, sem variáveis globais nem threads: os veículos são
+ * injetados por quem usa a biblioteca (motor_chegada(), motor_chegadas()), diretamente ou a partir dos geradores de demanda
+ * (demanda_gerar()), e o tempo só avança quando ele pede (motor_avancar(), motor_passo()), em um relógio virtual. Uma instância não é
+ * protegida por locks; instâncias diferentes podem ser usadas em threads diferentes, e o escalonador (escalonador_executar()) faz isso
+ * com roubo de tarefas entre as suas threads.
+ *
+ * Os tipos e parâmetros da controladora declarados aqui também são usados pelo simulador com threads.
+ *
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#ifndef CRUZAMENTO_H
+#define CRUZAMENTO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define T_MINIMO 5                      // Tempo mínimo que um fluxo fica aberto
+#define T_MAXIMO 20                     // Tempo máximo que um fluxo fica aberto
+
+// Parâmetros para a fórmula do cálculo de tempo que cada fluxo fica aberto
+#define T_BASE 1.8
+#define FATOR_CARRO 2.2
+
+// Parâmetros do modelo de tempo de verde baseado na vazão observada
+#define ALFA_VAZAO 0.3                  // Peso de cada nova medição na média móvel da vazão de cada eixo
+#define MIN_ENTRADAS_VAZAO 4            // Entradas que tornam amostra de vazão um verde que esvaziou a fila
+#define VAZAO_INICIAL (1.0 / FATOR_CARRO) // Vazão (carros/s) assumida antes da primeira medição, equivalente à fórmula
+
+#define TEMPO_TRAVESSIA 3               // Tempo que um carro leva para atravessar o cruzamento
+#define TEMPO_TRAVESSIA_AMBULANCIA 2    // Tempo que uma ambulância leva para atravessar o cruzamento
+#define TEMPO_ANUNCIO 1                 // Antecedência com que a ambulância anuncia a emergência antes de chegar à fila
+#define TEMPO_PAUSA 2                   // Pausa da controladora entre dois verdes (vermelho geral)
+#define INTERVALO_SATURACAO 2.0         // Intervalo mínimo (em segundos) entre entradas de carros da mesma faixa: 1800 carros/h de verde
+
+// Tamanho da linha de cache, usado para separar os dados escritos por threads diferentes
+#define TAMANHO_LINHA_CACHE 64
+
+// Faixas de cada aproximação: as filas de todas as faixas ficam em um único vetor de NUM_DIRECOES * MAX_FAIXAS posições
+#define MAX_FAIXAS 4                    // Número máximo de faixas por direção
+#define FAIXAS_NS 1                     // Faixas das aproximações Norte e Sul
+#define FAIXAS_LO 1                     // Faixas das aproximações Leste e Oeste (via arterial)
+#define FAIXA(direcao, faixa) ((direcao) * MAX_FAIXAS + (faixa))
+
+// Perfil de demanda dos geradores de chegadas
+#define MAX_TRECHOS_PERFIL 96           // Trechos de taxa constante de um perfil (um dia em trechos de 15 minutos)
+#define MAX_FLUXOS_DEMANDA 16           // Fluxos de chegadas de um conjunto (por exemplo, Poisson e pelotões em cada direção)
+
+// Alvo de espera máxima dos carros (prevenção de starvation). É um alvo, não uma garantia: a controladora só alterna os eixos, e com a
+// demanda acima da capacidade, emergências ou o plano coordenado do corredor a pior espera o ultrapassa
+#define ESPERA_MAXIMA 30                // Espera máxima (em segundos) visada para cada carro na fila; 0 desliga o alvo
+#define FOLGA_ESPERA 6                  // Antecedência da intervenção: pausa (2s) + travessia (3s) + período de verificação (1s)
+
+/**
+ * @brief Direções dos veículos
+ *
+ */
+typedef enum Direcao { NORTE, SUL, LESTE, OESTE, NUM_DIRECOES } Direcao;
+
+/**
+ * @brief Struct para definir qual fluxo de carros/ambulâncias (Norte-Sul ou Leste-Oeste) está passando no cruzamento no momento
+ *
+ */
+typedef enum{
+    FLUXO_NS,                           // Carros nas direções Norte e Sul
+    FLUXO_LO,                           // Carros nas direções Leste e Oeste
+    AMBULANCIA_NS,                      // Ambulancias nas direções Norte e Sul
+    AMBULANCIA_LO                       // Ambulancias nas direções Leste e Oeste
+} EstadoFluxo;
+
+/**
+ * @brief Tipos de Veículos presentes no cruzamento
+ *
+ */
+typedef enum{
+    TIPO_CARRO,
+    TIPO_AMBULANCIA,
+    NUM_TIPOS
+} TipoVeiculo;
+
+/**
+ * @brief Modelo usado pela controladora para calcular por quanto tempo um fluxo de carros fica aberto
+ *
+ */
+typedef enum{
+    VERDE_FORMULA,                      // T_BASE + (carros - 1) * FATOR_CARRO, independente de quão rápido a fila escoa
+    VERDE_VAZAO                         // Tempo previsto para esvaziar a fila com a vazão medida do eixo
+} ModeloVerde;
+
+/**
+ * @brief Política usada pela controladora para escolher qual eixo abrir e quando encerrar o verde
+ *
+ */
+typedef enum{
+    POLITICA_DEMANDA,                   // Abre o eixo com mais carros na fila e mantém o verde pelo tempo calculado
+    POLITICA_PRESSAO                    // Max-pressure: abre o eixo de maior pressão e encerra o verde quando o outro eixo o supera (no motor,
+                                        // a jusante vem de motor_jusante(); sem ela, a pressão é a fila pela vazão)
+} PoliticaControle;
+
+/**
+ * @brief Instância do motor: um cruzamento com a sua controladora, os veículos injetados e o relógio virtual. Opaca para quem usa a
+ * biblioteca.
+ *
+ */
+typedef struct Motor Motor;
+
+/**
+ * @brief Configuração de uma instância, equivalente às opções de linha de comando do simulador com threads. Preencha com
+ * motor_config_padrao() e altere apenas os campos desejados.
+ *
+ */
+typedef struct{
+    int faixas[NUM_DIRECOES];           // Faixas de cada direção, de 1 a MAX_FAIXAS (--faixas)
+    double intervalo_saturacao;         // Intervalo entre entradas da mesma faixa; 0 = sem limite (--saturacao)
+    double espera_maxima;               // Alvo de espera máxima dos carros; 0 desliga o alvo (--espera-maxima)
+    ModeloVerde modelo_verde;           // Modelo de tempo de verde (--verde)
+    PoliticaControle politica;          // Política de escolha do eixo (--politica)
+} ConfigMotor;
+
+/**
+ * @brief Chegada de um veículo, elemento de um lote injetado com motor_chegadas()
+ *
+ */
+typedef struct{
+    double instante;                    // Instante (relógio virtual) em que o carro chega à fila, ou em que a ambulância anuncia a emergência
+    Direcao direcao;
+    TipoVeiculo tipo;
+} Chegada;
+
+/**
+ * @brief Processo de chegadas de um fluxo (direção e tipo de veículo) dos geradores de demanda
+ *
+ */
+typedef enum{
+    PROCESSO_POISSON,                   // Chegadas de Poisson à taxa constante 'taxa'
+    PROCESSO_PERFIL,                    // Poisson com a taxa variando por trecho do perfil, repetido em ciclo (por exemplo, um dia)
+    PROCESSO_PELOTAO                    // Pelotões de Poisson (à taxa 'taxa', ou pelo perfil se num_trechos > 0), cada um com 'tamanho_pelotao' veículos
+} TipoProcesso;
+
+/**
+ * @brief Parâmetros de um processo de chegadas. As taxas são em chegadas (ou pelotões) por hora.
+ *
+ */
+typedef struct{
+    TipoProcesso tipo;
+    double taxa;                        // PROCESSO_POISSON e PROCESSO_PELOTAO sem perfil
+    int num_trechos;                    // Perfil: trechos consecutivos de 'duracao_trecho' segundos, de 1 a MAX_TRECHOS_PERFIL (0 = sem perfil)
+    double duracao_trecho;
+    double taxa_trecho[MAX_TRECHOS_PERFIL];
+    int tamanho_pelotao;                // PROCESSO_PELOTAO: veículos por pelotão
+    double intervalo_pelotao;           // PROCESSO_PELOTAO: intervalo, em segundos, entre veículos do mesmo pelotão
+} ProcessoChegada;
+
+/**
+ * @brief Conjunto de fluxos de chegadas de um cruzamento, com o estado dos seus geradores. Opaco para quem usa a biblioteca.
+ *
+ */
+typedef struct Demanda Demanda;
+
+/**
+ * @brief Retrato do estado e dos contadores cumulativos de uma instância, preenchido por motor_estatisticas(). Os tempos estão em
+ * segundos do relógio virtual.
+ *
+ */
+typedef struct{
+    double agora;                                                       // Instante do relógio virtual
+    EstadoFluxo estado_atual;                                           // Fluxo aberto (ou o último aberto, durante a pausa)
+    int carros_esperando[NUM_DIRECOES], ambulancias_esperando[NUM_DIRECOES];
+    int carros_no_cruzamento, ambulancias_no_cruzamento;
+    uint64_t chegadas[NUM_TIPOS][NUM_DIRECOES];                         // Veículos que entraram na fila de espera
+    uint64_t travessias[NUM_TIPOS][NUM_DIRECOES];                       // Veículos que saíram do cruzamento
+    double espera_soma[NUM_TIPOS], espera_pior[NUM_TIPOS];              // Soma e máximo das esperas na fila, na entrada no cruzamento
+    uint64_t trocas_fase[4];                                            // Aberturas de cada EstadoFluxo
+    uint64_t emergencias;                                               // Ativações do modo de emergência
+    uint64_t intervencoes_espera;                                       // Decisões forçadas pelo alvo de espera máxima
+    uint64_t verdes;                                                    // Verdes de carros encerrados
+    double verde_total, verde_ocioso;                                   // Duração dos verdes encerrados e o trecho sem entradas de carros
+    uint64_t fila_residual;                                             // Carros deixados na fila do eixo ao fim de cada verde
+    uint64_t eventos;                                                   // Eventos processados pelo motor
+} EstatisticasMotor;
+
+/**
+ * @brief Preenche 'config' com a configuração padrão do simulador.
+ *
+ */
+void motor_config_padrao(ConfigMotor *config);
+
+/**
+ * @brief Cria uma instância com o relógio virtual em 0 e a controladora na pausa inicial.
+ *
+ * @param config configuração, ou NULL para a padrão
+ * @return Motor* a instância, ou NULL com errno = EINVAL (configuração inválida) ou ENOMEM
+ */
+Motor *motor_criar(const ConfigMotor *config);
+
+/**
+ * @brief Libera a instância e todos os seus veículos.
+ *
+ */
+void motor_destruir(Motor *m);
+
+/**
+ * @brief Agenda a chegada de um veículo à fila da direção 'dir' no instante 'instante' (relógio virtual). O carro entra na faixa de
+ * menor fila da direção; a ambulância anuncia a emergência nesse instante e chega à fila TEMPO_ANUNCIO segundos depois. Cada veículo
+ * atravessa uma vez e deixa o motor.
+ *
+ * @return int 0 em caso de sucesso, -1 com errno = EINVAL (direção ou tipo inválido, instante anterior ao relógio) ou ENOMEM
+ */
+int motor_chegada(Motor *m, Direcao dir, TipoVeiculo tipo, double instante);
+
+/**
+ * @brief Agenda um lote de 'n' chegadas, como 'n' chamadas de motor_chegada() na ordem do vetor, mas com uma única reserva de memória.
+ * Cada chegada entra, em tempo constante, na posição da roda de temporizadores em que vence; as que vencem além da volta corrente do
+ * nível 0 descem de nível (cascata) quando a roda chega à volta delas, e as chegadas de um mesmo tick só são ordenadas quando o tick
+ * vence. O lote não precisa estar ordenado por instante. Ou todas as chegadas são agendadas, ou nenhuma.
+ *
+ * @return int 0 em caso de sucesso, -1 com errno = EINVAL (alguma chegada inválida, como em motor_chegada()) ou ENOMEM (também se o
+ * motor já falhou por falta de memória, ver motor_passo())
+ */
+int motor_chegadas(Motor *m, const Chegada *chegadas, int n);
+
+/**
+ * @brief Processa o próximo evento agendado (chegada, saída do cruzamento ou ação da controladora), avançando o relógio até ele. Se
+ * faltar memória para um evento agendado durante o processamento, esse evento se perde: o passo falha com ENOMEM, assim como toda
+ * chamada seguinte de motor_passo(), motor_avancar() e motor_chegadas(), e a instância só serve para motor_estatisticas() e
+ * motor_destruir().
+ *
+ * @return int 1 se um evento foi processado, 0 se não há eventos agendados, ou -1 com errno = ENOMEM
+ */
+int motor_passo(Motor *m);
+
+/**
+ * @brief Processa, em ordem, todos os eventos agendados até o instante 'ate', inclusive, e leva o relógio a 'ate'.
+ *
+ * @return int número de eventos processados, ou -1 com errno = EINVAL se 'ate' é anterior ao relógio ou ENOMEM (ver motor_passo()); na
+ * falha por memória o relógio fica no último evento processado
+ */
+int motor_avancar(Motor *m, double ate);
+
+/**
+ * @brief Informa a fila de jusante de cada direção: os carros que esperam, na mesma direção, no cruzamento para onde os carros desta
+ * instância seguem ao atravessar. A política max-pressure a subtrai da fila de montante (controle_pressao()). Cada instância simula um
+ * cruzamento isolado, cujos carros deixam o motor ao atravessar; quem conduz uma rede de instâncias (como bench/bench_grade) lê as filas
+ * dos vizinhos com motor_estatisticas() e as repassa aqui. O valor vale até a próxima chamada; sem nenhuma, a jusante é vazia.
+ *
+ * @param jusante NUM_DIRECOES filas, indexadas por Direcao, ou NULL para esvaziá-las
+ * @return int 0 em caso de sucesso, -1 com errno = EINVAL se alguma fila é negativa (nesse caso nada muda)
+ */
+int motor_jusante(Motor *m, const int *jusante);
+
+/**
+ * @brief Instante do próximo evento agendado, para quem conduz o relógio por fora (por exemplo, em tempo real com um timerfd).
+ *
+ * @return double instante do próximo evento, ou INFINITY se não há eventos agendados
+ */
+double motor_proximo(Motor *m);
+
+/**
+ * @brief Instante atual do relógio virtual da instância.
+ *
+ */
+double motor_agora(const Motor *m);
+
+/**
+ * @brief Copia para 'estatisticas' o estado e os contadores da instância.
+ *
+ */
+void motor_estatisticas(const Motor *m, EstatisticasMotor *estatisticas);
+
+/*
+ * Regras de decisão da controladora (controle.c), usadas pelo motor e pelo simulador com threads. São funções puras: recebem o estado
+ * já lido por quem chama (com o lock do cruzamento adquirido, no simulador com threads) e não guardam nada entre chamadas.
+ */
+
+extern const char *const nome_direcao[NUM_DIRECOES];                    // Nome de cada Direcao, para as mensagens
+extern const char *const nome_estado[4];                                // Nome de cada EstadoFluxo, para as mensagens
+
+/**
+ * @brief Eixo (FLUXO_NS ou FLUXO_LO) ao qual pertence uma direção
+ *
+ */
+EstadoFluxo controle_eixo(Direcao dir);
+
+/**
+ * @brief Indica se um veículo do tipo 'tipo' vindo da direção 'dir' pode entrar com o cruzamento no estado 'estado': o estado abre o
+ * eixo da direção, os estados de ambulância só admitem ambulâncias e uma emergência declarada barra os carros.
+ *
+ */
+bool controle_pode_passar(bool modo_emergencia, Direcao dir, EstadoFluxo estado, TipoVeiculo tipo);
+
+/**
+ * @brief Faixa em que um carro que chega pela direção 'dir' entra: a de menor fila, e entre filas iguais a de menor índice.
+ *
+ * @param fila_faixa filas das faixas, com NUM_DIRECOES * MAX_FAIXAS posições indexadas por FAIXA()
+ * @param faixas faixas em uso em cada direção
+ * @return int índice da faixa dentro da direção (de 0 a faixas[dir] - 1)
+ */
+int controle_escolher_faixa(const int *fila_faixa, const int *faixas, Direcao dir);
+
+/**
+ * @brief Demanda de um eixo medida pela faixa crítica: as faixas escoam em paralelo, cada uma a um carro por intervalo de saturação,
+ * então o eixo esvazia quando esvazia a sua faixa de maior fila. Retorna essa fila multiplicada pelo número de faixas do eixo, ou seja,
+ * os carros que o eixo escoaria no mesmo tempo com as filas equilibradas, na mesma unidade de carros que a vazão medida do eixo. Com as
+ * filas equilibradas coincide com o total de carros.
+ *
+ */
+int controle_demanda_faixas(const int *fila_faixa, const int *faixas, EstadoFluxo fluxo);
+
+/**
+ * @brief Indica se o carro mais antigo de um eixo, que espera há 'espera' segundos, já está a FOLGA_ESPERA segundos de estourar a espera
+ * máxima, ou seja, se a controladora precisa abrir esse eixo agora. A espera é arredondada para o segundo mais próximo, a resolução em
+ * que a controladora age: chegadas e verificações caem quase sempre em segundos inteiros umas das outras, e sem o arredondamento a
+ * decisão ficaria a cargo de poucos milissegundos de atraso do escalonador (e a reprodução de uma gravação poderia divergir). Com
+ * 'espera_maxima' 0 a regra fica desligada.
+ *
+ */
+bool controle_espera_estourando(double espera_maxima, double espera);
+
+/**
+ * @brief Eixo a abrir ao fim da pausa: o de maior critério da política (demanda ou pressão), com empate decidido pela espera mais
+ * antiga, salvo quando algum eixo está prestes a estourar a espera máxima; nesse caso abre o eixo de espera mais antiga.
+ *
+ * @param intervencao recebe true se a espera máxima mudou a escolha da política
+ * @return EstadoFluxo FLUXO_NS ou FLUXO_LO
+ */
+EstadoFluxo controle_escolher_eixo(double criterio_ns, double criterio_lo, double espera_ns, double espera_lo, double espera_maxima,
+    bool *intervencao);
+
+/**
+ * @brief Segundos de verde para 'num_carros' carros:
+ *      - VERDE_FORMULA: T_BASE + (carros - 1) * FATOR_CARRO, truncado;
+ *      - VERDE_VAZAO: tempo previsto para esvaziar a fila, carros / 'vazao', arredondado para cima (a controladora verifica a fila a
+ * cada segundo, então frações de segundo seriam perdidas de qualquer forma).
+ * Em ambos os casos aplica os limites T_MINIMO e T_MAXIMO.
+ *
+ */
+int controle_tempo_verde(ModeloVerde modelo, double vazao, int num_carros);
+
+/**
+ * @brief Indica se o verde aberto há 'decorrido' segundos deve ser encerrado pela espera máxima do eixo fechado: só depois de T_MINIMO,
+ * com carros ainda na fila do eixo aberto, e se o mais antigo do eixo fechado espera há mais tempo que o do eixo aberto.
+ *
+ */
+bool controle_espera_estourou(double espera_maxima, double decorrido, bool fila_vazia, double espera_aberta, double espera_oposta);
+
+/**
+ * @brief Pressão de uma direção para a política max-pressure: a fila de montante (carros esperando para atravessar) menos a de jusante
+ * (carros esperando na mesma direção no cruzamento seguinte do percurso), ponderada pela vazão medida do eixo. A pressão de um eixo é a
+ * soma das suas duas direções.
+ *
+ */
+double controle_pressao(int montante, int jusante, double vazao);
+
+/**
+ * @brief Max-pressure: indica se, passado T_MINIMO, o eixo fechado tem pressão maior que o aberto e o verde deve ser encerrado por isso
+ *
+ */
+bool controle_pressao_superada(PoliticaControle politica, double decorrido, bool fila_vazia, bool espera_estourou, double pressao_aberta,
+    double pressao_oposta);
+
+/**
+ * @brief Nova vazão medida de um eixo ao fim de um verde com 'entradas' entradas de carros, a última 'util' segundos depois da abertura,
+ * e 'residual' carros ainda na fila do eixo. A amostra é entradas / util, com o trecho limitado a no mínimo um segundo (a granularidade
+ * das verificações da controladora), e entra na média móvel com peso ALFA_VAZAO. Só mede a vazão de saturação o verde em que os carros
+ * entraram em fila: um verde que esvaziou a fila com menos de MIN_ENTRADAS_VAZAO entradas mediria a chegada dos carros, e não muda a
+ * vazão, assim como um verde sem entradas.
+ *
+ */
+double controle_vazao(double vazao, int entradas, double util, int residual);
+
+/**
+ * @brief Eixo de ambulâncias a abrir em uma emergência: o de mais ambulâncias na fila, Norte-Sul no empate
+ *
+ */
+EstadoFluxo controle_eixo_ambulancias(const int *ambulancias_esperando);
+
+/**
+ * @brief Indica se, na emergência com o eixo de ambulâncias 'estado' aberto, a passagem deve alternar para o outro eixo: o aberto já
+ * foi atendido, há ambulâncias esperando no outro e o cruzamento está vazio
+ *
+ */
+bool controle_alternar_ambulancias(EstadoFluxo estado, const int *ambulancias_esperando, int ambulancias_no_cruzamento);
+
+/**
+ * @brief Admissão pela vazão de saturação no instante planejado 'instante': libera as faixas bloqueadas cujo proxima_entrada já passou,
+ * chamando admitir(contexto, faixa) para cada uma (acordar ou retomar o primeiro carro da faixa), e deixa em *prazo_admissao o próximo
+ * instante de liberação, no máximo 'fim_verde'. 'admitir' pode fazer um carro entrar, bloqueando a faixa de novo e antecipando
+ * *prazo_admissao.
+ *
+ */
+void controle_liberar_faixas(bool *faixa_liberada, const double *proxima_entrada, double instante, double fim_verde, double *prazo_admissao,
+    void (*admitir)(void *contexto, int faixa), void *contexto);
+
+/**
+ * @brief Cria um conjunto de fluxos de chegadas vazio. Cada fluxo acrescentado recebe um gerador próprio derivado de 'semente'.
+ *
+ * @return Demanda* o conjunto, ou NULL com errno = ENOMEM
+ */
+Demanda *demanda_criar(uint64_t semente);
+
+/**
+ * @brief Libera o conjunto de fluxos.
+ *
+ */
+void demanda_destruir(Demanda *d);
+
+/**
+ * @brief Acrescenta um fluxo de chegadas de veículos do tipo 'tipo' pela direção 'dir', com o processo 'processo', a partir do instante 0.
+ * Uma direção pode ter mais de um fluxo (por exemplo, chegadas de Poisson mais pelotões vindos de um cruzamento a montante).
+ *
+ * @return int 0 em caso de sucesso, -1 com errno = EINVAL (parâmetros inválidos ou MAX_FLUXOS_DEMANDA fluxos já acrescentados)
+ */
+int demanda_fluxo(Demanda *d, Direcao dir, TipoVeiculo tipo, const ProcessoChegada *processo);
+
+/**
+ * @brief Gera, em 'chegadas', as próximas chegadas de todos os fluxos com instante até 'ate', inclusive, sem repetir as já entregues.
+ * Se 'capacidade' não bastar, as chegadas restantes ficam para a próxima chamada. O vetor pode ser passado diretamente a
+ * motor_chegadas().
+ *
+ * @return int número de chegadas geradas
+ */
+int demanda_gerar(Demanda *d, double ate, Chegada *chegadas, int capacidade);
+
+/**
+ * @brief Instante da próxima chegada ainda não entregue (INFINITY se nenhum fluxo tem chegadas).
+ *
+ */
+double demanda_proxima(const Demanda *d);
+
+/**
+ * @brief Escalonador com roubo de tarefas: um conjunto de threads que executa em paralelo as tarefas de uma rodada (tipicamente, um passo
+ * de cada cruzamento de uma grade). Cada thread começa a rodada com um bloco contíguo de tarefas em sua deque e, quando a esvazia,
+ * rouba tarefas das outras, de modo que cruzamentos congestionados não prendem a rodada em uma única thread.
+ *
+ */
+typedef struct Escalonador Escalonador;
+
+/**
+ * @brief Tarefa de uma rodada: 'indice' em [0, num_tarefas), 'contexto' como passado a escalonador_executar()
+ *
+ */
+typedef void (*TarefaEscalonador)(int indice, void *contexto);
+
+/**
+ * @brief Contadores acumulados de um escalonador
+ *
+ */
+typedef struct{
+    uint64_t rodadas, tarefas;
+    uint64_t roubos;                    // Tarefas executadas por uma thread diferente da dona da deque
+    double segundos;                    // Tempo real somado das rodadas
+    double ocupado;                     // Tempo de CPU somado das threads nas rodadas
+    double ocupado_maximo;              // Soma, sobre as rodadas, do tempo de CPU da thread mais ocupada da rodada
+} EstatisticasEscalonador;
+
+/**
+ * @brief Cria um escalonador com 'num_trabalhadores' threads, contando a que chama escalonador_executar(). Com 'roubo' falso, cada
+ * thread executa só o seu bloco (particionamento estático), para comparação.
+ *
+ * @return Escalonador* novo escalonador, ou NULL com errno = EINVAL (num_trabalhadores < 1), ENOMEM ou o erro de pthread_create()
+ */
+Escalonador *escalonador_criar(int num_trabalhadores, bool roubo);
+
+/**
+ * @brief Encerra as threads do escalonador e libera sua memória.
+ *
+ */
+void escalonador_destruir(Escalonador *e);
+
+/**
+ * @brief Fixa cada thread do escalonador em um processador: a thread i (a 0 é a que chama esta função, e deve ser a mesma que chama
+ * escalonador_executar()) vai para o i-ésimo processador permitido ao processo, voltando ao primeiro quando há mais threads que
+ * processadores. Fixadas, as threads não migram, e a memória que cada uma toca primeiro (as instâncias que ela cria e avança) fica no
+ * nó NUMA do seu processador.
+ *
+ * @return int 0 em caso de sucesso, -1 com errno = o erro de sched_getaffinity() ou pthread_setaffinity_np()
+ */
+int escalonador_fixar(Escalonador *e);
+
+/**
+ * @brief Executa uma rodada: tarefa(i, contexto) para cada i em [0, num_tarefas), cada uma uma vez, em paralelo, e retorna quando todas
+ * terminaram. Tarefas diferentes devem tocar instâncias diferentes.
+ *
+ * @return int 0 em caso de sucesso, -1 com errno = EINVAL (num_tarefas < 0) ou ENOMEM
+ */
+int escalonador_executar(Escalonador *e, int num_tarefas, TarefaEscalonador tarefa, void *contexto);
+
+/**
+ * @brief Copia os contadores acumulados do escalonador.
+ *
+ */
+void escalonador_estatisticas(const Escalonador *e, EstatisticasEscalonador *estatisticas);
+
+#endif
@@ -0,0 +1,109 @@
+/**
+ *
+ * Estado de um cruzamento do simulador com threads (cruzamento.c).
+ *
+ *      Fica fora de cruzamento.c para que bench/bench_layout meça o layout da struct que o simulador de fato usa e monte, da mesma lista
+ * de campos, o layout anterior à separação em regiões para comparação. Não faz parte da interface da biblioteca (cruzamento.h): o
+ * motor guarda o seu próprio estado, sem locks.
+ *
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#ifndef CRUZAMENTO_SIMULADOR_H
+#define CRUZAMENTO_SIMULADOR_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "cruzamento.h"
+
+/**
+ * @brief Etapa da máquina de estados da thread controladora
+ *
+ */
+typedef enum{
+    CONTROLE_PAUSA,                     // Aguardando as filas se formarem antes da próxima decisão (até 'prazo_controlador')
+    CONTROLE_VERDE,                     // Fluxo de carros aberto até 'fim_verde', verificando a fila a cada segundo
+    CONTROLE_EMERGENCIA                 // Passagem liberada para ambulâncias, aguardando o fim da emergência
+} EstadoControlador;
+
+/**
+ * @brief Campos de Cruzamento, cada um com a sua região. VEICULOS, FAIXAS, CONTROLADORA e FIXO são macros (tipo, nome, dimensão)
+ * escolhidas por quem expande a lista; DECLARAR_CAMPO declara o campo e IGNORAR_CAMPO o omite. A lista segue a ordem em que os campos
+ * estavam antes da separação em regiões (os acrescentados depois vão ao fim): bench/bench_layout a declara inteira, sem alinhamento,
+ * como a struct de comparação, e Cruzamento declara os campos de cada região nessa mesma ordem. Um campo novo entra só aqui, e as duas
+ * structs o recebem.
+ *
+ */
+#define CAMPOS_CRUZAMENTO(VEICULOS, FAIXAS, CONTROLADORA, FIXO) \
+    VEICULOS(int, carros_esperando, [NUM_DIRECOES])                 /* Carros esperando em cada direção */ \
+    VEICULOS(int, ambulancias_esperando, [NUM_DIRECOES])            /* Ambulâncias esperando em cada direção */ \
+    VEICULOS(int, carros_no_cruzamento, )                           /* Carros dentro do cruzamento */ \
+    VEICULOS(int, ambulancias_no_cruzamento, )                      /* Ambulâncias dentro do cruzamento */ \
+    VEICULOS(bool, modo_emergencia, )                               /* Há ambulâncias querendo entrar no cruzamento (Modo Emergência) */ \
+    VEICULOS(int, ambulancias_em_emergencia, )                      /* Ambulâncias entre o anúncio da emergência e a saída do cruzamento */ \
+    VEICULOS(EstadoFluxo, estado_atual, )                           /* Estado atual do fluxo de veículos no cruzamento */ \
+    VEICULOS(pthread_mutex_t, lock, )                               /* Exclusão mútua de todo o estado do cruzamento */ \
+    VEICULOS(pthread_cond_t, pode_cruzar, )                         /* Mudanças de estado que a controladora e as ambulâncias aguardam */ \
+    FIXO(int, contadores_id_carros, [NUM_DIRECOES])                 /* Próximo id de cada direção de carros (ver atribuir_ids()) */ \
+    FIXO(int, contadores_id_ambulancias, [NUM_DIRECOES])            /* Próximo id de cada direção de ambulâncias */ \
+    CONTROLADORA(struct timespec, inicio_fase, )                    /* Instante (CLOCK_REALTIME) em que o estado atual foi aberto */ \
+    CONTROLADORA(EstadoControlador, fase_controlador, )             /* Etapa atual da thread controladora */ \
+    CONTROLADORA(double, prazo_controlador, )                       /* Próximo instante em que a controladora age (pausa ou verificação) */ \
+    CONTROLADORA(double, fim_verde, )                               /* Instante em que o fluxo de carros aberto se encerra */ \
+    CONTROLADORA(int, carros_fase, )                                /* Demanda que motivou a abertura do fluxo atual */ \
+    VEICULOS(bool, fluxo_encerrado, )                               /* Verde encerrado: carros não entram mais enquanto o cruzamento esvazia */ \
+    CONTROLADORA(double, inicio_verde, )                            /* Instante em que o fluxo de carros atual foi aberto */ \
+    VEICULOS(double, ultima_entrada, )                              /* Instante da última entrada de carro no verde atual */ \
+    VEICULOS(int, entradas_verde, )                                 /* Carros que entraram no verde atual */ \
+    CONTROLADORA(double, vazao, [2])                                /* Vazão medida de cada eixo (FLUXO_NS, FLUXO_LO), em carros por segundo de verde */ \
+    FIXO(int, indice, )                                             /* Posição no corredor, de Oeste (0) para Leste */ \
+    FIXO(double, defasagem, )                                       /* Início do verde arterial no ciclo coordenado (ver calcular_defasagens()) */ \
+    FAIXAS(int, fila_faixa, [NUM_DIRECOES * MAX_FAIXAS])            /* Carros esperando em cada faixa, indexado por FAIXA(direcao, faixa) */ \
+    FAIXAS(int, cabeca_faixa, [NUM_DIRECOES * MAX_FAIXAS])          /* Primeiro carro da fila de cada faixa (-1 se vazia) */ \
+    FAIXAS(int, cauda_faixa, [NUM_DIRECOES * MAX_FAIXAS])           /* Último carro da fila de cada faixa (-1 se vazia) */ \
+    FAIXAS(double, proxima_entrada, [NUM_DIRECOES * MAX_FAIXAS])    /* Instante a partir do qual cada faixa admite o próximo carro */ \
+    FAIXAS(bool, faixa_liberada, [NUM_DIRECOES * MAX_FAIXAS])       /* A faixa admite a entrada de um carro (ver liberar_faixas()) */ \
+    CONTROLADORA(double, prazo_admissao, )                          /* Próximo instante em que a controladora libera uma faixa */ \
+    CONTROLADORA(double, instante_controle, )                       /* Instante planejado da última ação da controladora no verde */ \
+    VEICULOS(int, fase, )                                           /* Número da fase atual nesta execução (0 = estado em que o cruzamento partiu) */ \
+    VEICULOS(int, atendidos_fase, [NUM_TIPOS])                      /* Veículos de cada tipo que entraram na fase atual */ \
+    CONTROLADORA(double, abertura_fase, )                           /* Instante (relógio da simulação) em que a fase atual foi aberta */
+
+#define DECLARAR_CAMPO(tipo, nome, dimensao) tipo nome dimensao;
+#define IGNORAR_CAMPO(tipo, nome, dimensao)
+
+/**
+ * @brief Struct que define parâmetros importantes para o controle do fluxo de veículos no cruzamento. Os campos são agrupados pelo padrão
+ * de acesso, cada grupo começando em uma linha de cache própria: o lock e o estado que todo veículo lê e escreve a cada chegada, entrada
+ * e saída; as filas por faixa; o estado que só a controladora escreve; e os campos fixos depois da inicialização, entre eles os
+ * contadores de id, que só a main escreve. Assim, a controladora não disputa com os veículos linhas que só ela escreve, e o cruzamento
+ * vizinho do corredor começa em outra linha. Os campos e a sua região vêm de CAMPOS_CRUZAMENTO.
+ *
+ */
+typedef struct{
+    // Estado compartilhado pelos veículos e pela controladora, sempre com 'lock' adquirido
+    _Alignas(TAMANHO_LINHA_CACHE) struct{ CAMPOS_CRUZAMENTO(DECLARAR_CAMPO, IGNORAR_CAMPO, IGNORAR_CAMPO, IGNORAR_CAMPO) };
+    // Filas por faixa, com 'lock' adquirido
+    _Alignas(TAMANHO_LINHA_CACHE) struct{ CAMPOS_CRUZAMENTO(IGNORAR_CAMPO, DECLARAR_CAMPO, IGNORAR_CAMPO, IGNORAR_CAMPO) };
+    // Estado escrito só pela controladora, com 'lock' adquirido
+    _Alignas(TAMANHO_LINHA_CACHE) struct{ CAMPOS_CRUZAMENTO(IGNORAR_CAMPO, IGNORAR_CAMPO, DECLARAR_CAMPO, IGNORAR_CAMPO) };
+    // Fixos depois da inicialização
+    _Alignas(TAMANHO_LINHA_CACHE) struct{ CAMPOS_CRUZAMENTO(IGNORAR_CAMPO, IGNORAR_CAMPO, IGNORAR_CAMPO, DECLARAR_CAMPO) };
+} Cruzamento;
+
+// Cada região começa em uma linha de cache própria (o primeiro campo de cada uma em CAMPOS_CRUZAMENTO), e o tamanho é múltiplo da linha,
+// para que o cruzamento seguinte de um vetor (o vizinho do corredor) também comece em uma linha própria
+_Static_assert(offsetof(Cruzamento, carros_esperando) % TAMANHO_LINHA_CACHE == 0, "estado dos veiculos fora do inicio de uma linha de cache");
+_Static_assert(offsetof(Cruzamento, fila_faixa) % TAMANHO_LINHA_CACHE == 0, "filas por faixa fora do inicio de uma linha de cache");
+_Static_assert(offsetof(Cruzamento, inicio_fase) % TAMANHO_LINHA_CACHE == 0, "estado da controladora fora do inicio de uma linha de cache");
+_Static_assert(offsetof(Cruzamento, contadores_id_carros) % TAMANHO_LINHA_CACHE == 0, "campos fixos fora do inicio de uma linha de cache");
+_Static_assert(sizeof(Cruzamento) % TAMANHO_LINHA_CACHE == 0, "tamanho de Cruzamento nao e multiplo da linha de cache");
+
+#endif
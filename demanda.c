@@ -0,0 +1,213 @@
+/**
+ *
+ * Geradores de demanda do motor (ver cruzamento.h).
+ *
+ *      Substituem, para o motor, o retorno de cada veículo à fila após um intervalo uniforme de 2 a 9 segundos: cada fluxo (direção e
+ * tipo de veículo) segue o seu processo de chegadas, e as chegadas são geradas em lotes, à frente do relógio, prontos para
+ * motor_chegadas(). Cada fluxo tem o seu próprio gerador pseudoaleatório e guarda a próxima chegada ainda não entregue, então a
+ * sequência de chegadas de um fluxo não depende de como as chamadas de demanda_gerar() dividem o tempo nem da capacidade dos lotes.
+ *
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <math.h>
+
+#include "cruzamento.h"
+
+/**
+ * @brief Estado de um fluxo de chegadas
+ *
+ */
+typedef struct{
+    Direcao direcao;
+    TipoVeiculo tipo;
+    ProcessoChegada processo;
+    uint64_t semente;                   // Estado do gerador xorshift64* do fluxo
+    double base;                        // Instante da última chegada do processo de Poisson (início do último pelotão)
+    int trecho;                         // Trecho do perfil em que 'base' está
+    double fim_trecho;                  // Fim desse trecho
+    int restantes;                      // Veículos do pelotão corrente ainda não entregues
+    double proxima;                     // Próxima chegada a entregar (INFINITY se o fluxo nunca tem chegadas)
+} FluxoDemanda;
+
+/**
+ * @brief Conjunto de fluxos de chegadas de um cruzamento
+ *
+ */
+struct Demanda{
+    uint64_t semente;
+    int num_fluxos;
+    FluxoDemanda fluxos[MAX_FLUXOS_DEMANDA];
+};
+
+/**
+ * @brief Variável uniforme em (0, 1] do gerador xorshift64* do fluxo
+ *
+ */
+static double uniforme(uint64_t *semente){
+    *semente ^= *semente >> 12;
+    *semente ^= *semente << 25;
+    *semente ^= *semente >> 27;
+    return (double) (((*semente * 0x2545F4914F6CDD1DULL) >> 11) + 1) / 9007199254740992.0;
+}
+
+/**
+ * @brief Indica se as chegadas (ou os pelotões) do processo seguem o perfil de taxas por trecho
+ *
+ */
+static bool usa_perfil(const ProcessoChegada *p){
+    return p->tipo == PROCESSO_PERFIL || (p->tipo == PROCESSO_PELOTAO && p->num_trechos > 0);
+}
+
+/**
+ * @brief Avança 'f->base' até a próxima chegada do processo de Poisson do fluxo. No perfil, a taxa é constante por trecho, e a chegada é
+ * obtida pela mudança de escala do tempo: uma exponencial de taxa 1 é consumida trecho a trecho, à taxa de cada um, o que dá o processo
+ * de Poisson não homogêneo exato, sem sorteios descartados.
+ *
+ */
+static void avancar_base(FluxoDemanda *f){
+    const ProcessoChegada *p = &f->processo;
+    double exponencial = -log(uniforme(&f->semente)), taxa;
+    int vazios;
+
+    if(!usa_perfil(p)){
+        f->base = (p->taxa > 0) ? f->base + exponencial * 3600 / p->taxa : INFINITY;
+        return;
+    }
+
+    // Um ciclo inteiro de trechos sem chegadas significa que o perfil é nulo
+    for(vazios = 0; vazios <= p->num_trechos; ){
+        taxa = p->taxa_trecho[f->trecho] / 3600;
+        if(taxa > 0 && exponencial <= taxa * (f->fim_trecho - f->base)){
+            f->base += exponencial / taxa;
+            return;
+        }
+        if(taxa > 0){
+            exponencial -= taxa * (f->fim_trecho - f->base);
+            vazios = 0;
+        }
+        else vazios++;
+        f->base = f->fim_trecho;
+        f->trecho = (f->trecho + 1) % p->num_trechos;
+        f->fim_trecho += p->duracao_trecho;
+    }
+    f->base = INFINITY;
+}
+
+/**
+ * @brief Calcula a próxima chegada a entregar: o veículo seguinte do pelotão corrente ou, terminado o pelotão (ou fora do processo de
+ * pelotões), a próxima chegada do processo de Poisson. Um pelotão que começaria antes de o anterior terminar é atrasado até o fim dele,
+ * de modo que as chegadas de um fluxo são entregues sempre em ordem crescente de instante.
+ *
+ */
+static void avancar_fluxo(FluxoDemanda *f, bool primeira){
+    if(f->restantes > 0){
+        f->restantes--;
+        f->proxima += f->processo.intervalo_pelotao;
+        return;
+    }
+    avancar_base(f);
+    if(f->processo.tipo == PROCESSO_PELOTAO){
+        if(!primeira && f->base < f->proxima + f->processo.intervalo_pelotao) f->proxima += f->processo.intervalo_pelotao;
+        else f->proxima = f->base;
+        f->restantes = f->processo.tamanho_pelotao - 1;
+    }
+    else f->proxima = f->base;
+}
+
+Demanda *demanda_criar(uint64_t semente){
+    Demanda *d = calloc(1, sizeof(Demanda));
+
+    if(d == NULL){
+        errno = ENOMEM;
+        return NULL;
+    }
+    d->semente = semente;
+    return d;
+}
+
+void demanda_destruir(Demanda *d){
+    free(d);
+}
+
+int demanda_fluxo(Demanda *d, Direcao dir, TipoVeiculo tipo, const ProcessoChegada *processo){
+    FluxoDemanda *f;
+    uint64_t z;
+    int i;
+
+    if(dir < NORTE || dir >= NUM_DIRECOES || tipo < TIPO_CARRO || tipo >= NUM_TIPOS || d->num_fluxos == MAX_FLUXOS_DEMANDA
+        || (processo->tipo != PROCESSO_POISSON && processo->tipo != PROCESSO_PERFIL && processo->tipo != PROCESSO_PELOTAO)
+        || (processo->tipo == PROCESSO_PELOTAO && (processo->tamanho_pelotao < 1 || processo->intervalo_pelotao < 0))){
+        errno = EINVAL;
+        return -1;
+    }
+    if(usa_perfil(processo)){
+        if(processo->num_trechos < 1 || processo->num_trechos > MAX_TRECHOS_PERFIL || !(processo->duracao_trecho > 0)){
+            errno = EINVAL;
+            return -1;
+        }
+        for(i = 0; i < processo->num_trechos; i++){
+            if(processo->taxa_trecho[i] < 0){
+                errno = EINVAL;
+                return -1;
+            }
+        }
+    }
+    else if(processo->taxa < 0){
+        errno = EINVAL;
+        return -1;
+    }
+
+    f = &d->fluxos[d->num_fluxos];
+    f->direcao = dir;
+    f->tipo = tipo;
+    f->processo = *processo;
+
+    // Semente do fluxo derivada da semente do conjunto e da ordem do fluxo (splitmix64), distinta e não nula
+    z = d->semente + (uint64_t) (d->num_fluxos + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    f->semente = z != 0 ? z : 1;
+
+    f->base = 0;
+    f->trecho = 0;
+    f->fim_trecho = processo->duracao_trecho;
+    f->restantes = 0;
+    avancar_fluxo(f, true);
+    d->num_fluxos++;
+    return 0;
+}
+
+int demanda_gerar(Demanda *d, double ate, Chegada *chegadas, int capacidade){
+    FluxoDemanda *f;
+    int i, n = 0;
+
+    // Fluxo a fluxo, em laços curtos que só leem e escrevem o estado de um fluxo; a ordem entre fluxos não importa para o motor
+    for(i = 0; i < d->num_fluxos; i++){
+        f = &d->fluxos[i];
+        while(f->proxima <= ate && n < capacidade){
+            chegadas[n].instante = f->proxima;
+            chegadas[n].direcao = f->direcao;
+            chegadas[n].tipo = f->tipo;
+            n++;
+            avancar_fluxo(f, false);
+        }
+    }
+    return n;
+}
+
+double demanda_proxima(const Demanda *d){
+    double proxima = INFINITY;
+    int i;
+
+    for(i = 0; i < d->num_fluxos; i++) if(d->fluxos[i].proxima < proxima) proxima = d->fluxos[i].proxima;
+    return proxima;
+}
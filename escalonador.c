@@ -0,0 +1,335 @@
+/**
+ *
+ * Escalonador com roubo de tarefas para conduzir muitas instâncias do motor em paralelo (ver cruzamento.h).
+ *
+ *      Cada thread tem uma deque de tarefas no formato de Chase e Lev: a dona retira do fim sem sincronização (salvo quando resta uma
+ * tarefa), e as demais roubam do início com uma única comparação e troca. No começo de uma rodada, a thread que chama
+ * escalonador_executar() põe em cada deque um bloco contíguo de índices, o mesmo particionamento estático que se faria à mão, e acorda as
+ * outras; cada uma executa o seu bloco e, ao esvaziá-lo, percorre as outras deques roubando uma tarefa por vez. Nenhuma tarefa é criada
+ * durante a rodada, então uma thread que encontra todas as deques vazias pode terminar: as tarefas que restam já estão em execução.
+ * Como os blocos são os mesmos a cada rodada, cada instância é quase sempre avançada pela mesma thread, e com as threads fixadas
+ * (escalonador_fixar()) a memória dela continua no nó NUMA em que foi tocada pela primeira vez.
+ *
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#define _GNU_SOURCE                     // pthread_setaffinity_np() e cpu_set_t
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <time.h>
+
+#include "cruzamento.h"
+
+#define DEQUE_VAZIA -1
+#define ROUBO_DISPUTADO -2              // Outra thread levou a tarefa no meio do roubo; vale tentar de novo
+
+/**
+ * @brief Thread do escalonador e sua deque. Os índices da deque ficam em linhas de cache próprias: 'topo' é disputado pelos ladrões e
+ * 'base' só é escrito pela dona.
+ *
+ */
+typedef struct{
+    _Alignas(TAMANHO_LINHA_CACHE) _Atomic long topo;                   // Próxima tarefa a roubar
+    _Alignas(TAMANHO_LINHA_CACHE) _Atomic long base;                   // Uma depois da próxima tarefa da dona
+    _Alignas(TAMANHO_LINHA_CACHE) int *tarefas;
+    int capacidade;
+    pthread_t thread;
+    uint64_t roubos;                                                    // Tarefas roubadas por esta thread
+    double ocupado;                                                     // Tempo de CPU desta thread na última rodada
+} Trabalhador;
+
+struct Escalonador{
+    int num_trabalhadores;
+    bool roubo;
+    Trabalhador *trabalhadores;
+    pthread_mutex_t lock;
+    pthread_cond_t inicio_rodada, fim_rodada;
+    uint64_t rodada;                                                    // Número da rodada corrente (as threads esperam ele mudar)
+    int trabalhando;                                                    // Threads auxiliares ainda na rodada corrente
+    bool encerrar;
+    TarefaEscalonador tarefa;
+    void *contexto;
+    EstatisticasEscalonador estatisticas;
+};
+
+/**
+ * @brief Argumento de uma thread auxiliar
+ *
+ */
+typedef struct{
+    Escalonador *e;
+    int id;
+} ArgsTrabalhador;
+
+static double segundos_cpu_thread(void){
+    struct timespec t;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static double segundos_reais(void){
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Retira a última tarefa da própria deque
+ *
+ * @return int índice da tarefa, ou DEQUE_VAZIA
+ */
+static int retirar(Trabalhador *t){
+    long base = atomic_load_explicit(&t->base, memory_order_relaxed) - 1, topo;
+    int tarefa;
+
+    atomic_store_explicit(&t->base, base, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    topo = atomic_load_explicit(&t->topo, memory_order_relaxed);
+    if(topo > base){
+        atomic_store_explicit(&t->base, base + 1, memory_order_relaxed);
+        return DEQUE_VAZIA;
+    }
+    tarefa = t->tarefas[base];
+    if(topo == base){
+        // Última tarefa: disputa com os ladrões pelo topo
+        if(!atomic_compare_exchange_strong_explicit(&t->topo, &topo, topo + 1, memory_order_seq_cst, memory_order_relaxed)) tarefa = DEQUE_VAZIA;
+        atomic_store_explicit(&t->base, base + 1, memory_order_relaxed);
+    }
+    return tarefa;
+}
+
+/**
+ * @brief Rouba a primeira tarefa da deque de outra thread
+ *
+ * @return int índice da tarefa, DEQUE_VAZIA ou ROUBO_DISPUTADO
+ */
+static int roubar(Trabalhador *vitima){
+    long topo = atomic_load_explicit(&vitima->topo, memory_order_acquire), base;
+    int tarefa;
+
+    atomic_thread_fence(memory_order_seq_cst);
+    base = atomic_load_explicit(&vitima->base, memory_order_acquire);
+    if(topo >= base) return DEQUE_VAZIA;
+    tarefa = vitima->tarefas[topo];
+    if(!atomic_compare_exchange_strong_explicit(&vitima->topo, &topo, topo + 1, memory_order_seq_cst, memory_order_relaxed)) return ROUBO_DISPUTADO;
+    return tarefa;
+}
+
+/**
+ * @brief Executa a parte da rodada da thread 'id': o próprio bloco e, com roubo, as tarefas que restarem nas outras deques
+ *
+ */
+static void trabalhar(Escalonador *e, int id){
+    Trabalhador *t = &e->trabalhadores[id];
+    double inicio = segundos_cpu_thread();
+    int tarefa, k;
+    bool restam = true;
+
+    while(restam){
+        while((tarefa = retirar(t)) != DEQUE_VAZIA) e->tarefa(tarefa, e->contexto);
+        if(!e->roubo) break;
+
+        // Percorre as outras deques a partir da vizinha, tentando de novo a mesma vítima quando o roubo é disputado
+        restam = false;
+        for(k = 1; k < e->num_trabalhadores && !restam; k++){
+            while((tarefa = roubar(&e->trabalhadores[(id + k) % e->num_trabalhadores])) == ROUBO_DISPUTADO);
+            if(tarefa != DEQUE_VAZIA){
+                e->tarefa(tarefa, e->contexto);
+                t->roubos++;
+                restam = true;
+            }
+        }
+    }
+    t->ocupado = segundos_cpu_thread() - inicio;
+}
+
+/**
+ * @brief Thread auxiliar: espera o início de cada rodada, trabalha e avisa o fim
+ *
+ * @param arg ArgsTrabalhador* da thread (liberado por ela)
+ */
+static void *executar_trabalhador(void *arg){
+    ArgsTrabalhador args = *(ArgsTrabalhador*) arg;
+    Escalonador *e = args.e;
+    uint64_t vista = 0;
+
+    free(arg);
+    for(;;){
+        pthread_mutex_lock(&e->lock);
+        while(e->rodada == vista && !e->encerrar) pthread_cond_wait(&e->inicio_rodada, &e->lock);
+        if(e->encerrar){
+            pthread_mutex_unlock(&e->lock);
+            return NULL;
+        }
+        vista = e->rodada;
+        pthread_mutex_unlock(&e->lock);
+
+        trabalhar(e, args.id);
+
+        pthread_mutex_lock(&e->lock);
+        if(--e->trabalhando == 0) pthread_cond_signal(&e->fim_rodada);
+        pthread_mutex_unlock(&e->lock);
+    }
+}
+
+Escalonador *escalonador_criar(int num_trabalhadores, bool roubo){
+    Escalonador *e;
+    ArgsTrabalhador *args;
+    int i, erro;
+
+    if(num_trabalhadores < 1){
+        errno = EINVAL;
+        return NULL;
+    }
+    e = calloc(1, sizeof(Escalonador));
+    if(e == NULL || (e->trabalhadores = aligned_alloc(TAMANHO_LINHA_CACHE, num_trabalhadores * sizeof(Trabalhador))) == NULL){
+        free(e);
+        errno = ENOMEM;
+        return NULL;
+    }
+    e->num_trabalhadores = num_trabalhadores;
+    e->roubo = roubo;
+    pthread_mutex_init(&e->lock, NULL);
+    pthread_cond_init(&e->inicio_rodada, NULL);
+    pthread_cond_init(&e->fim_rodada, NULL);
+    for(i = 0; i < num_trabalhadores; i++){
+        atomic_init(&e->trabalhadores[i].topo, 0);
+        atomic_init(&e->trabalhadores[i].base, 0);
+        e->trabalhadores[i].tarefas = NULL;
+        e->trabalhadores[i].capacidade = 0;
+        e->trabalhadores[i].roubos = 0;
+        e->trabalhadores[i].ocupado = 0;
+    }
+
+    // A thread 0 é a que chama escalonador_executar()
+    for(i = 1; i < num_trabalhadores; i++){
+        args = malloc(sizeof(ArgsTrabalhador));
+        if(args == NULL){
+            erro = ENOMEM;
+            break;
+        }
+        args->e = e;
+        args->id = i;
+        if((erro = pthread_create(&e->trabalhadores[i].thread, NULL, executar_trabalhador, args)) != 0){
+            free(args);
+            break;
+        }
+    }
+    if(i < num_trabalhadores){
+        e->num_trabalhadores = i;
+        escalonador_destruir(e);
+        errno = erro;
+        return NULL;
+    }
+    return e;
+}
+
+void escalonador_destruir(Escalonador *e){
+    int i;
+
+    if(e == NULL) return;
+    pthread_mutex_lock(&e->lock);
+    e->encerrar = true;
+    pthread_cond_broadcast(&e->inicio_rodada);
+    pthread_mutex_unlock(&e->lock);
+    for(i = 1; i < e->num_trabalhadores; i++) pthread_join(e->trabalhadores[i].thread, NULL);
+    for(i = 0; i < e->num_trabalhadores; i++) free(e->trabalhadores[i].tarefas);
+    pthread_mutex_destroy(&e->lock);
+    pthread_cond_destroy(&e->inicio_rodada);
+    pthread_cond_destroy(&e->fim_rodada);
+    free(e->trabalhadores);
+    free(e);
+}
+
+int escalonador_fixar(Escalonador *e){
+    cpu_set_t permitidos, um;
+    int processadores[CPU_SETSIZE], num_processadores = 0, i, erro;
+    pthread_t thread;
+
+    if(sched_getaffinity(0, sizeof(permitidos), &permitidos) != 0) return -1;
+    for(i = 0; i < CPU_SETSIZE; i++) if(CPU_ISSET(i, &permitidos)) processadores[num_processadores++] = i;
+    for(i = 0; i < e->num_trabalhadores; i++){
+        CPU_ZERO(&um);
+        CPU_SET(processadores[i % num_processadores], &um);
+        thread = (i == 0) ? pthread_self() : e->trabalhadores[i].thread;
+        if((erro = pthread_setaffinity_np(thread, sizeof(um), &um)) != 0){
+            errno = erro;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int escalonador_executar(Escalonador *e, int num_tarefas, TarefaEscalonador tarefa, void *contexto){
+    Trabalhador *t;
+    int i, j, inicio, fim, *maior;
+    double comeco, ocupado_maximo = 0;
+
+    if(num_tarefas < 0){
+        errno = EINVAL;
+        return -1;
+    }
+    comeco = segundos_reais();
+
+    // Bloco contíguo de cada thread, empilhado do fim para o começo: a dona executa o bloco em ordem crescente e os ladrões levam o fim
+    for(i = 0; i < e->num_trabalhadores; i++){
+        t = &e->trabalhadores[i];
+        inicio = (int) ((long) num_tarefas * i / e->num_trabalhadores);
+        fim = (int) ((long) num_tarefas * (i + 1) / e->num_trabalhadores);
+        if(fim - inicio > t->capacidade){
+            maior = realloc(t->tarefas, (fim - inicio) * sizeof(int));
+            if(maior == NULL){
+                errno = ENOMEM;
+                return -1;
+            }
+            t->tarefas = maior;
+            t->capacidade = fim - inicio;
+        }
+        for(j = 0; j < fim - inicio; j++) t->tarefas[j] = fim - 1 - j;
+        atomic_store_explicit(&t->topo, 0, memory_order_relaxed);
+        atomic_store_explicit(&t->base, fim - inicio, memory_order_relaxed);
+    }
+
+    pthread_mutex_lock(&e->lock);
+    e->tarefa = tarefa;
+    e->contexto = contexto;
+    e->rodada++;
+    e->trabalhando = e->num_trabalhadores - 1;
+    pthread_cond_broadcast(&e->inicio_rodada);
+    pthread_mutex_unlock(&e->lock);
+
+    trabalhar(e, 0);
+
+    pthread_mutex_lock(&e->lock);
+    while(e->trabalhando > 0) pthread_cond_wait(&e->fim_rodada, &e->lock);
+    pthread_mutex_unlock(&e->lock);
+
+    e->estatisticas.rodadas++;
+    e->estatisticas.tarefas += (uint64_t) num_tarefas;
+    e->estatisticas.segundos += segundos_reais() - comeco;
+    for(i = 0; i < e->num_trabalhadores; i++){
+        e->estatisticas.ocupado += e->trabalhadores[i].ocupado;
+        if(e->trabalhadores[i].ocupado > ocupado_maximo) ocupado_maximo = e->trabalhadores[i].ocupado;
+    }
+    e->estatisticas.ocupado_maximo += ocupado_maximo;
+    return 0;
+}
+
+void escalonador_estatisticas(const Escalonador *e, EstatisticasEscalonador *estatisticas){
+    int i;
+
+    *estatisticas = e->estatisticas;
+    estatisticas->roubos = 0;
+    for(i = 0; i < e->num_trabalhadores; i++) estatisticas->roubos += e->trabalhadores[i].roubos;
+}
@@ -0,0 +1,1015 @@
+/**
+ *
+ * Motor de simulação do cruzamento como biblioteca (ver cruzamento.h).
+ *
+ *      O simulador com threads dá a cada veículo e à controladora uma thread que dorme pelo relógio real; aqui as mesmas máquinas de
+ * estados (as etapas de carros(), ambulancia() e fluxo_trafego() em cruzamento.c) são dirigidas por eventos em um relógio virtual. Cada
+ * instância guarda os eventos com instante marcado (chegadas, saídas do cruzamento e ações da controladora) e os processa em ordem: uma
+ * espera por tempo vira um evento agendado, e uma espera em variável de condição vira uma reavaliação no ponto em que a thread seria
+ * acordada. Eventos do mesmo instante são processados na ordem do tipo e, depois, na ordem em que foram agendados, de modo que uma
+ * mesma sequência de chamadas produz sempre o mesmo resultado.
+ *
+ *      Os eventos ficam em uma roda de temporizadores hierárquica: cada nível tem POSICOES_NIVEL posições, e uma posição do nível n
+ * cobre uma volta inteira do nível n - 1. Agendar põe o evento na lista da posição em que ele vence, em tempo constante; quando o
+ * nível 0 começa uma nova volta, a posição corrente dos níveis de cima desce para os de baixo. Só ao vencer os eventos de um tick são
+ * ordenados, e eles são poucos, de modo que o custo por evento não cresce com o número de eventos agendados.
+ *
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <math.h>
+
+#include "cruzamento.h"
+
+#define CAPACIDADE_INICIAL 64           // Capacidade inicial dos vetores de eventos e de veículos (dobram quando enchem)
+#define TICKS_POR_SEGUNDO 4             // Resolução da roda de temporizadores; os eventos de um mesmo tick são ordenados ao vencer
+#define BITS_NIVEL 6
+#define POSICOES_NIVEL (1 << BITS_NIVEL) // Posições de cada nível da roda: uma volta do nível n dura POSICOES_NIVEL^(n + 1) ticks
+#define NIVEIS_RODA 5                   // Alcance da roda: 2^30 ticks, cerca de oito anos; eventos além dele esperam em uma lista
+#define TICK_MAXIMO (1ULL << 62)
+
+/*
+ * Corrotinas sem pilha, no estilo das protothreads: o corpo da corrotina é um switch sobre o ponto de retomada guardado em 'retomada'
+ * (0 no início), e cada espera grava a linha em que está e retorna. Variáveis locais não sobrevivem a uma espera; o que atravessa
+ * esperas fica na estrutura dona de 'retomada'.
+ */
+#define CORROTINA_INICIO(retomada) switch(retomada){ case 0:
+#define CORROTINA_FIM }
+#define CORROTINA_ESPERAR_QUE(retomada, condicao) \
+    do{ (retomada) = __LINE__; __attribute__((fallthrough)); case __LINE__: if(!(condicao)) return; } while(0)
+#define CORROTINA_SUSPENDER(retomada) do{ (retomada) = __LINE__; return; case __LINE__:; } while(0)
+
+/**
+ * @brief Tipos de evento agendados em uma instância, na ordem em que são processados quando caem no mesmo instante
+ *
+ */
+typedef enum{
+    EVENTO_SAIDA,                       // Veículo termina a travessia e sai do cruzamento
+    EVENTO_CHEGADA,                     // Carro chega à fila da sua direção, ou ambulância anuncia a emergência
+    EVENTO_FILA_AMBULANCIA,             // Ambulância anunciada chega à fila da sua direção
+    EVENTO_CONTROLADOR                  // Prazo da controladora (fim da pausa, verificação do verde ou liberação de faixa)
+} TipoEvento;
+
+/**
+ * @brief Evento agendado. Eventos do mesmo instante são ordenados pelo tipo e, entre eventos do mesmo tipo, por 'sequencia', a ordem de
+ * agendamento. Ordenar primeiro pelo tipo faz o resultado depender só dos instantes das chegadas, e não de quando elas foram injetadas:
+ * uma chegada injetada com uma hora de antecedência, em um lote, e a mesma chegada injetada no último passo antes do seu instante
+ * encontram a controladora no mesmo estado.
+ *
+ */
+typedef struct{
+    double instante;
+    uint64_t sequencia;
+    TipoEvento tipo;
+    int alvo;                           // Índice do veículo em Motor.veiculos, ou a geração da controladora (EVENTO_CONTROLADOR)
+    int seguinte;                       // Próximo evento na mesma lista (posição da roda, prontos, distantes ou posições livres)
+} Evento;
+
+/**
+ * @brief Etapa da máquina de estados da controladora
+ *
+ */
+typedef enum{
+    CONTROLE_PAUSA,                     // Aguardando as filas se formarem antes da próxima decisão (até 'prazo_controlador')
+    CONTROLE_VERDE,                     // Fluxo de carros aberto até 'fim_verde', verificando a fila a cada segundo
+    CONTROLE_EMERGENCIA                 // Passagem liberada para ambulâncias, aguardando o fim da emergência
+} EstadoControlador;
+
+/**
+ * @brief Veículo injetado. As posições livres de Motor.veiculos formam uma lista encadeada por 'seguinte', reaproveitada a cada chegada.
+ *
+ */
+typedef struct{
+    Direcao direcao;
+    TipoVeiculo tipo;
+    int retomada;                       // Ponto de retomada da corrotina veiculo()
+    int faixa;                          // Faixa em que o carro espera, como índice FAIXA(direcao, faixa)
+    double chegada;                     // Instante em que o veículo entrou na fila de espera
+    int seguinte;                       // Próximo veículo na fila (ou na lista de posições livres), -1 se é o último
+} VeiculoMotor;
+
+/**
+ * @brief Estado de uma instância: os campos do cruzamento e da controladora têm o mesmo significado que em struct Cruzamento
+ * (cruzamento.c), sem locks nem variáveis de condição.
+ *
+ */
+struct Motor{
+    ConfigMotor config;
+    double agora;                                                       // Relógio virtual: instante do último evento processado
+    Evento *eventos;                                                    // Eventos agendados, encadeados nas listas abaixo
+    int num_eventos, capacidade_eventos;
+    int livre_evento;                                                   // Primeira posição livre de eventos (-1 se cheio)
+    uint64_t tick;                                                      // Próximo tick da roda: ela só guarda eventos de ticks >= tick
+    uint64_t ocupadas[NIVEIS_RODA];                                     // Mapa das posições ocupadas de cada nível
+    int prontos;                                                        // Eventos de ticks já examinados, em ordem de processamento
+    int distantes;                                                      // Eventos além do alcance da roda
+    uint64_t sequencia;                                                 // Próximo número de sequência de evento
+    bool sem_memoria;                                                   // Um agendamento falhou e o evento se perdeu (ver agendar())
+    VeiculoMotor *veiculos;
+    int capacidade_veiculos, veiculos_em_uso;
+    int livre;                                                          // Primeira posição livre de veiculos (-1 se cheio)
+    int carros_esperando[NUM_DIRECOES], ambulancias_esperando[NUM_DIRECOES];
+    int jusante[NUM_DIRECOES];                                          // Fila de jusante de cada direção, informada por motor_jusante()
+    int carros_no_cruzamento, ambulancias_no_cruzamento;
+    bool modo_emergencia;
+    int ambulancias_em_emergencia;
+    EstadoFluxo estado_atual;
+    EstadoControlador fase_controlador;
+    double prazo_controlador, fim_verde;
+    bool fluxo_encerrado;
+    bool aguardando_saida;                                              // Controladora esperando o cruzamento esvaziar para decidir
+    bool controladora_avisada;                                          // Um veículo mudou o estado que a controladora espera
+    int geracao_controlador;                                            // Só o evento da controladora com esta geração é válido
+    double proximo_controle;                                            // Instante do evento válido da controladora
+    double inicio_verde, ultima_entrada;
+    int entradas_verde;
+    double vazao[2];
+    int fila_faixa[NUM_DIRECOES * MAX_FAIXAS];
+    int cabeca_faixa[NUM_DIRECOES * MAX_FAIXAS], cauda_faixa[NUM_DIRECOES * MAX_FAIXAS];
+    double proxima_entrada[NUM_DIRECOES * MAX_FAIXAS];
+    bool faixa_liberada[NUM_DIRECOES * MAX_FAIXAS];
+    double prazo_admissao, instante_controle;
+    int cabeca_ambulancia[NUM_DIRECOES], cauda_ambulancia[NUM_DIRECOES];  // Fila de ambulâncias de cada direção
+    EstatisticasMotor estatisticas;
+    int roda[NIVEIS_RODA][POSICOES_NIVEL];                              // Primeiro evento de cada posição, se ela está ocupada
+};
+
+/**
+ * @brief Indica se o evento 'a' vem antes do evento 'b'
+ *
+ */
+static bool evento_antes(const Evento *a, const Evento *b){
+    if(a->instante != b->instante) return a->instante < b->instante;
+    if(a->tipo != b->tipo) return a->tipo < b->tipo;
+    return a->sequencia < b->sequencia;
+}
+
+/**
+ * @brief Tick da roda em que cai um instante; instantes além de TICK_MAXIMO (inclusive os infinitos) ficam todos em TICK_MAXIMO
+ *
+ */
+static uint64_t tick_do_instante(double instante){
+    return (instante < (double) TICK_MAXIMO / TICKS_POR_SEGUNDO) ? (uint64_t) (instante * TICKS_POR_SEGUNDO) : TICK_MAXIMO;
+}
+
+/**
+ * @brief Garante ao menos 'n' posições de evento livres, dobrando o vetor quantas vezes for preciso. As novas posições entram na
+ * lista de posições livres.
+ *
+ * @return int 0 em caso de sucesso, -1 com errno = ENOMEM
+ */
+static int reservar_eventos(Motor *m, int n){
+    Evento *maior;
+    int i, capacidade = m->capacidade_eventos;
+
+    while(capacidade - m->num_eventos < n) capacidade *= 2;
+    if(capacidade == m->capacidade_eventos) return 0;
+    maior = realloc(m->eventos, capacidade * sizeof(Evento));
+    if(maior == NULL){
+        errno = ENOMEM;
+        return -1;
+    }
+    m->eventos = maior;
+    for(i = m->capacidade_eventos; i < capacidade; i++) m->eventos[i].seguinte = (i + 1 < capacidade) ? i + 1 : m->livre_evento;
+    m->livre_evento = m->capacidade_eventos;
+    m->capacidade_eventos = capacidade;
+    return 0;
+}
+
+/**
+ * @brief Põe o evento 'i' na lista de prontos, na sua ordem. Só recebe eventos de ticks já examinados: a lista tem os eventos de um
+ * tick e os agendados depois para esse tick ou para um anterior ainda não alcançado pelo relógio, então é curta.
+ *
+ */
+static void inserir_pronto(Motor *m, int i){
+    int *anterior = &m->prontos;
+
+    while(*anterior >= 0 && evento_antes(&m->eventos[*anterior], &m->eventos[i])) anterior = &m->eventos[*anterior].seguinte;
+    m->eventos[i].seguinte = *anterior;
+    *anterior = i;
+}
+
+/**
+ * @brief Põe o evento 'i' na posição da roda que vence no seu tick: no nível 0 se ele vence nesta volta, no nível mais baixo cuja volta
+ * o alcança se vence depois, na lista de distantes se está além do alcance da roda, ou na lista de prontos se o tick já foi examinado.
+ *
+ */
+static void colocar_evento(Motor *m, int i){
+    uint64_t tick = tick_do_instante(m->eventos[i].instante);
+    int nivel, posicao;
+
+    if(tick < m->tick){
+        inserir_pronto(m, i);
+        return;
+    }
+    for(nivel = 0; nivel < NIVEIS_RODA; nivel++){
+        if(tick - m->tick < (1ULL << (BITS_NIVEL * (nivel + 1)))){
+            posicao = (int) (tick >> (BITS_NIVEL * nivel)) & (POSICOES_NIVEL - 1);
+            m->eventos[i].seguinte = (m->ocupadas[nivel] & (1ULL << posicao)) ? m->roda[nivel][posicao] : -1;
+            m->roda[nivel][posicao] = i;
+            m->ocupadas[nivel] |= 1ULL << posicao;
+            return;
+        }
+    }
+    m->eventos[i].seguinte = m->distantes;
+    m->distantes = i;
+}
+
+/**
+ * @brief Recoloca todos os eventos de uma lista, relativos ao tick corrente da roda
+ *
+ */
+static void recolocar_eventos(Motor *m, int lista){
+    int seguinte;
+
+    for(; lista >= 0; lista = seguinte){
+        seguinte = m->eventos[lista].seguinte;
+        colocar_evento(m, lista);
+    }
+}
+
+/**
+ * @brief Agenda um evento, dobrando o vetor de eventos quando ele enche. Os agendamentos feitos ao processar um evento (saídas,
+ * ambulâncias, controladora) não têm como desfazer o que já foi processado: se um deles falha, o evento se perde, m->sem_memoria fica
+ * marcado e motor_passo() passa a falhar com ENOMEM.
+ *
+ * @return int 0 em caso de sucesso, -1 com errno = ENOMEM
+ */
+static int agendar(Motor *m, double instante, TipoEvento tipo, int alvo){
+    Evento *novo;
+    int i;
+
+    if(reservar_eventos(m, 1) < 0){
+        m->sem_memoria = true;
+        return -1;
+    }
+    i = m->livre_evento;
+    novo = &m->eventos[i];
+    m->livre_evento = novo->seguinte;
+    m->num_eventos++;
+
+    novo->instante = instante;
+    novo->sequencia = m->sequencia++;
+    novo->tipo = tipo;
+    novo->alvo = alvo;
+    colocar_evento(m, i);
+    return 0;
+}
+
+/**
+ * @brief Ordena uma lista encadeada de eventos (mergesort)
+ *
+ * @return int primeiro evento da lista ordenada
+ */
+static int ordenar_eventos(Motor *m, int lista){
+    int lenta, rapida, a, b, resultado, *fim = &resultado;
+
+    if(lista < 0 || m->eventos[lista].seguinte < 0) return lista;
+    for(lenta = lista, rapida = m->eventos[lista].seguinte; rapida >= 0 && m->eventos[rapida].seguinte >= 0;
+        rapida = m->eventos[m->eventos[rapida].seguinte].seguinte) lenta = m->eventos[lenta].seguinte;
+    b = m->eventos[lenta].seguinte;
+    m->eventos[lenta].seguinte = -1;
+    a = ordenar_eventos(m, lista);
+    b = ordenar_eventos(m, b);
+
+    while(a >= 0 && b >= 0){
+        if(evento_antes(&m->eventos[b], &m->eventos[a])){
+            *fim = b;
+            b = m->eventos[b].seguinte;
+        }
+        else{
+            *fim = a;
+            a = m->eventos[a].seguinte;
+        }
+        fim = &m->eventos[*fim].seguinte;
+    }
+    *fim = (a >= 0) ? a : b;
+    return resultado;
+}
+
+/**
+ * @brief Ao entrar em uma nova volta do nível 0, desce para os níveis inferiores os eventos da posição que vence nos níveis de cima,
+ * subindo de nível enquanto a volta também é nova no nível de cima. Uma volta completa do último nível traz os eventos distantes que
+ * entraram no alcance.
+ *
+ */
+static void cascatear(Motor *m){
+    int nivel, posicao;
+
+    for(nivel = 1; nivel < NIVEIS_RODA; nivel++){
+        posicao = (int) (m->tick >> (BITS_NIVEL * nivel)) & (POSICOES_NIVEL - 1);
+        if(m->ocupadas[nivel] & (1ULL << posicao)){
+            m->ocupadas[nivel] &= ~(1ULL << posicao);
+            recolocar_eventos(m, m->roda[nivel][posicao]);
+        }
+        if(posicao != 0) return;
+    }
+    posicao = m->distantes;
+    m->distantes = -1;
+    recolocar_eventos(m, posicao);
+}
+
+/**
+ * @brief Primeiro tick depois do corrente em que a roda tem trabalho: o início da próxima posição ocupada de algum nível (na volta
+ * corrente do nível, ou na seguinte se as posições ocupadas já ficaram para trás) ou, com eventos distantes, a próxima volta completa
+ * do último nível. Entre o tick corrente e esse não há posição a descer nem evento a vencer.
+ *
+ */
+static uint64_t proximo_tick(const Motor *m){
+    uint64_t menor = TICK_MAXIMO, volta, adiante, inicio;
+    int nivel, deslocamento, posicao;
+
+    for(nivel = 0; nivel < NIVEIS_RODA; nivel++){
+        if(m->ocupadas[nivel] == 0) continue;
+        deslocamento = BITS_NIVEL * nivel;
+        posicao = (int) (m->tick >> deslocamento) & (POSICOES_NIVEL - 1);
+        volta = m->tick >> (deslocamento + BITS_NIVEL) << (deslocamento + BITS_NIVEL);
+        adiante = (posicao + 1 < POSICOES_NIVEL) ? m->ocupadas[nivel] >> (posicao + 1) << (posicao + 1) : 0;
+        if(adiante != 0) inicio = volta + ((uint64_t) __builtin_ctzll(adiante) << deslocamento);
+        else inicio = volta + (1ULL << (deslocamento + BITS_NIVEL)) + ((uint64_t) __builtin_ctzll(m->ocupadas[nivel]) << deslocamento);
+        if(inicio < menor) menor = inicio;
+    }
+    if(m->distantes >= 0){
+        inicio = (m->tick >> (BITS_NIVEL * NIVEIS_RODA) << (BITS_NIVEL * NIVEIS_RODA)) + (1ULL << (BITS_NIVEL * NIVEIS_RODA));
+        if(inicio < menor) menor = inicio;
+    }
+    return menor;
+}
+
+/**
+ * @brief Gira a roda até o próximo tick com eventos, se a lista de prontos está vazia, e passa os eventos desse tick, em ordem, para
+ * a lista de prontos. Trechos sem eventos são saltados pelos mapas de ocupação de cada nível, sem visitar tick a tick.
+ *
+ */
+static void avancar_roda(Motor *m){
+    uint64_t resto, menor;
+    int nivel, posicao, i;
+
+    while(m->prontos < 0 && m->num_eventos > 0){
+        for(nivel = 0; nivel < NIVEIS_RODA && m->ocupadas[nivel] == 0; nivel++);
+        if(nivel == NIVEIS_RODA){
+            // Só há eventos distantes: a roda vazia salta direto para o mais próximo deles
+            for(menor = TICK_MAXIMO, i = m->distantes; i >= 0; i = m->eventos[i].seguinte){
+                if(tick_do_instante(m->eventos[i].instante) < menor) menor = tick_do_instante(m->eventos[i].instante);
+            }
+            m->tick = menor;
+            i = m->distantes;
+            m->distantes = -1;
+            recolocar_eventos(m, i);
+            continue;
+        }
+
+        posicao = (int) (m->tick & (POSICOES_NIVEL - 1));
+        resto = m->ocupadas[0] >> posicao;
+        if(resto != 0){
+            posicao += __builtin_ctzll(resto);
+            m->tick += (uint64_t) __builtin_ctzll(resto);
+            m->ocupadas[0] &= ~(1ULL << posicao);
+            m->prontos = ordenar_eventos(m, m->roda[0][posicao]);
+            if((++m->tick & (POSICOES_NIVEL - 1)) == 0) cascatear(m);
+            return;
+        }
+
+        // Nada no nível 0 até o fim da volta
+        m->tick = proximo_tick(m);
+        if((m->tick & (POSICOES_NIVEL - 1)) == 0) cascatear(m);
+    }
+}
+
+/**
+ * @brief Retira o primeiro evento da lista de prontos, que não pode estar vazia, e devolve a posição dele à lista de posições livres.
+ *
+ */
+static Evento retirar_evento(Motor *m){
+    int i = m->prontos;
+    Evento primeiro = m->eventos[i];
+
+    m->prontos = primeiro.seguinte;
+    m->eventos[i].seguinte = m->livre_evento;
+    m->livre_evento = i;
+    m->num_eventos--;
+    return primeiro;
+}
+
+/**
+ * @brief Agenda a próxima ação da controladora, invalidando o evento anterior dela que ainda estiver na fila. Uma falha de memória fica
+ * em m->sem_memoria (ver agendar()).
+ *
+ */
+static void agendar_controlador(Motor *m, double instante){
+    m->proximo_controle = instante;
+    agendar(m, instante, EVENTO_CONTROLADOR, ++m->geracao_controlador);
+}
+
+/**
+ * @brief Garante ao menos 'n' posições de veículo livres, dobrando o vetor quantas vezes for preciso. As novas posições entram na
+ * lista de posições livres.
+ *
+ * @return int 0 em caso de sucesso, -1 com errno = ENOMEM
+ */
+static int reservar_veiculos(Motor *m, int n){
+    VeiculoMotor *maior;
+    int i, capacidade = m->capacidade_veiculos;
+
+    while(capacidade - m->veiculos_em_uso < n) capacidade *= 2;
+    if(capacidade == m->capacidade_veiculos) return 0;
+    maior = realloc(m->veiculos, capacidade * sizeof(VeiculoMotor));
+    if(maior == NULL){
+        errno = ENOMEM;
+        return -1;
+    }
+    m->veiculos = maior;
+    for(i = m->capacidade_veiculos; i < capacidade; i++) m->veiculos[i].seguinte = (i + 1 < capacidade) ? i + 1 : m->livre;
+    m->livre = m->capacidade_veiculos;
+    m->capacidade_veiculos = capacidade;
+    return 0;
+}
+
+/**
+ * @brief Retira uma posição da lista de posições livres; deve haver uma reservada com reservar_veiculos()
+ *
+ * @return int índice em m->veiculos
+ */
+static int alocar_veiculo(Motor *m){
+    int indice = m->livre;
+
+    m->livre = m->veiculos[indice].seguinte;
+    m->veiculos_em_uso++;
+    return indice;
+}
+
+/**
+ * @brief Devolve a posição de um veículo que saiu do cruzamento à lista de posições livres
+ *
+ */
+static void liberar_veiculo(Motor *m, int indice){
+    m->veiculos[indice].seguinte = m->livre;
+    m->livre = indice;
+    m->veiculos_em_uso--;
+}
+
+/**
+ * @brief Marca o início de uma nova fase
+ *
+ */
+static void iniciar_fase(Motor *m, EstadoFluxo estado){
+    m->estado_atual = estado;
+    m->fluxo_encerrado = false;
+    m->estatisticas.trocas_fase[estado]++;
+}
+
+/**
+ * @brief Contabiliza a espera de um veículo que acabou de entrar no cruzamento
+ *
+ */
+static void registrar_entrada(Motor *m, const VeiculoMotor *v){
+    double espera = m->agora - v->chegada;
+
+    m->estatisticas.espera_soma[v->tipo] += espera;
+    if(espera > m->estatisticas.espera_pior[v->tipo]) m->estatisticas.espera_pior[v->tipo] = espera;
+}
+
+/**
+ * @brief Idade do carro que espera há mais tempo em um eixo. As filas das faixas estão em ordem de chegada, então basta olhar o
+ * primeiro carro de cada faixa.
+ *
+ */
+static double espera_mais_antiga(const Motor *m, EstadoFluxo fluxo){
+    Direcao dir;
+    int f, cabeca;
+    double maior = 0;
+
+    for(dir = NORTE; dir < NUM_DIRECOES; dir++){
+        if(controle_eixo(dir) != fluxo) continue;
+        for(f = 0; f < m->config.faixas[dir]; f++){
+            cabeca = m->cabeca_faixa[FAIXA(dir, f)];
+            if(cabeca >= 0 && m->agora - m->veiculos[cabeca].chegada > maior) maior = m->agora - m->veiculos[cabeca].chegada;
+        }
+    }
+    return maior;
+}
+
+/**
+ * @brief Pressão de um eixo para a política max-pressure (controle_pressao()): a fila de montante de cada direção menos a de jusante
+ * informada por motor_jusante(), vazia enquanto quem conduz a instância não a informa (cruzamento isolado).
+ *
+ */
+static double pressao(const Motor *m, EstadoFluxo fluxo){
+    Direcao primeira = (fluxo == FLUXO_NS) ? NORTE : LESTE, segunda = (fluxo == FLUXO_NS) ? SUL : OESTE;
+
+    return controle_pressao(m->carros_esperando[primeira], m->jusante[primeira], m->vazao[fluxo])
+         + controle_pressao(m->carros_esperando[segunda], m->jusante[segunda], m->vazao[fluxo]);
+}
+
+/**
+ * @brief Contabiliza o verde que acabou de ser encerrado e atualiza a vazão medida do eixo (controle_vazao())
+ *
+ */
+static void encerrar_verde(Motor *m){
+    EstadoFluxo fluxo = m->estado_atual;
+    double util;
+    int residual;
+
+    residual = (fluxo == FLUXO_NS) ? m->carros_esperando[NORTE] + m->carros_esperando[SUL]
+                                   : m->carros_esperando[LESTE] + m->carros_esperando[OESTE];
+    util = (m->entradas_verde > 0) ? m->ultima_entrada - m->inicio_verde : 0;
+    m->estatisticas.verdes++;
+    m->estatisticas.verde_total += m->agora - m->inicio_verde;
+    m->estatisticas.verde_ocioso += m->agora - m->inicio_verde - util;
+    m->estatisticas.fila_residual += (uint64_t) residual;
+
+    m->vazao[fluxo] = controle_vazao(m->vazao[fluxo], m->entradas_verde, util, residual);
+}
+
+static void veiculo(Motor *m, int indice);
+
+/**
+ * @brief Indica se a faixa 'faixa' admite o seu primeiro carro: verde da direção aberto e faixa liberada pelo intervalo de saturação
+ *
+ */
+static bool faixa_admite(const Motor *m, int faixa){
+    return !m->fluxo_encerrado && m->faixa_liberada[faixa]
+        && controle_pode_passar(m->modo_emergencia, (Direcao) (faixa / MAX_FAIXAS), m->estado_atual, TIPO_CARRO);
+}
+
+/**
+ * @brief Primeiro carro da fila da faixa 'faixa' entra no cruzamento, e a faixa fica bloqueada pelo intervalo de saturação. Chamada pela
+ * corrotina do carro.
+ *
+ */
+static void entrar_carro(Motor *m, int faixa){
+    int indice = m->cabeca_faixa[faixa];
+    VeiculoMotor *v = &m->veiculos[indice];
+
+    m->cabeca_faixa[faixa] = v->seguinte;
+    if(m->cabeca_faixa[faixa] < 0) m->cauda_faixa[faixa] = -1;
+    m->fila_faixa[faixa]--;
+    m->carros_esperando[v->direcao]--;
+    m->carros_no_cruzamento++;
+    m->entradas_verde++;
+    m->ultima_entrada = m->agora;
+    if(m->config.intervalo_saturacao > 0){
+        m->proxima_entrada[faixa] = m->agora + m->config.intervalo_saturacao;
+        m->faixa_liberada[faixa] = false;
+        // Um carro que chega com a faixa livre entra fora das ações da controladora e pode antecipar a próxima liberação
+        if(m->proxima_entrada[faixa] < m->prazo_admissao){
+            m->prazo_admissao = m->proxima_entrada[faixa];
+            if(m->prazo_admissao < m->proximo_controle) agendar_controlador(m, m->prazo_admissao);
+        }
+    }
+    registrar_entrada(m, v);
+}
+
+/**
+ * @brief Retoma, em ordem de chegada, os carros da faixa 'faixa' enquanto ela os admitir (sem intervalo de saturação, a fila inteira
+ * entra de uma vez)
+ *
+ */
+static void admitir_faixa(Motor *m, int faixa){
+    while(m->cabeca_faixa[faixa] >= 0 && faixa_admite(m, faixa)) veiculo(m, m->cabeca_faixa[faixa]);
+}
+
+/**
+ * @brief Retoma todas as ambulâncias na fila cuja direção é compatível com o estado atual
+ *
+ */
+static void admitir_ambulancias(Motor *m){
+    Direcao dir;
+
+    for(dir = NORTE; dir < NUM_DIRECOES; dir++){
+        while(m->cabeca_ambulancia[dir] >= 0 && controle_pode_passar(m->modo_emergencia, dir, m->estado_atual, TIPO_AMBULANCIA)){
+            veiculo(m, m->cabeca_ambulancia[dir]);
+        }
+    }
+}
+
+/**
+ * @brief admitir de controle_liberar_faixas(): retoma os carros da faixa liberada
+ *
+ */
+static void admitir_liberada(void *contexto, int faixa){
+    admitir_faixa((Motor*) contexto, faixa);
+}
+
+/**
+ * @brief Libera as faixas cujo intervalo de saturação terminou até 'instante' e admite o primeiro carro de cada uma
+ *
+ */
+static void liberar_faixas(Motor *m, double instante){
+    m->instante_controle = instante;
+    controle_liberar_faixas(m->faixa_liberada, m->proxima_entrada, instante, m->fim_verde, &m->prazo_admissao, admitir_liberada, m);
+}
+
+/**
+ * @brief Abre todas as faixas no início de um verde e admite o primeiro carro de cada faixa do eixo aberto
+ *
+ */
+static void abrir_faixas(Motor *m){
+    int f;
+
+    m->instante_controle = m->inicio_verde;
+    m->prazo_admissao = m->fim_verde;
+    for(f = 0; f < NUM_DIRECOES * MAX_FAIXAS; f++) m->faixa_liberada[f] = true;
+    for(f = 0; f < NUM_DIRECOES * MAX_FAIXAS; f++){
+        if(controle_eixo((Direcao) (f / MAX_FAIXAS)) == m->estado_atual) admitir_faixa(m, f);
+    }
+}
+
+/**
+ * @brief Ação da controladora, a etapa correspondente de fluxo_trafego() em cruzamento.c. É chamada no prazo agendado da etapa e, nas
+ * esperas que na versão com threads são feitas em pode_cruzar (cruzamento esvaziando antes de uma decisão, emergência em curso), a
+ * cada mudança no estado dos veículos.
+ *
+ */
+static void controlar(Motor *m){
+    EstadoFluxo proximo_estado, eixo_oposto;
+    int demanda_ns, demanda_lo, tempo_final;
+    double espera_ns, espera_lo, espera_oposta, criterio_ns, criterio_lo;
+    bool so_admissao, fila_ativa_esvaziou, espera_estourou, pressao_superada, intervencao;
+
+    switch(m->fase_controlador){
+    case CONTROLE_PAUSA:
+        // Garante que o cruzamento esteja livre antes de tomar a próxima decisão; a última saída chama a controladora de novo
+        m->aguardando_saida = m->carros_no_cruzamento > 0 || m->ambulancias_no_cruzamento > 0;
+        if(m->aguardando_saida) return;
+
+        if(m->modo_emergencia){
+            iniciar_fase(m, controle_eixo_ambulancias(m->ambulancias_esperando));
+            m->fase_controlador = CONTROLE_EMERGENCIA;
+            admitir_ambulancias(m);
+            return;
+        }
+
+        demanda_ns = controle_demanda_faixas(m->fila_faixa, m->config.faixas, FLUXO_NS);
+        demanda_lo = controle_demanda_faixas(m->fila_faixa, m->config.faixas, FLUXO_LO);
+        espera_ns = espera_mais_antiga(m, FLUXO_NS);
+        espera_lo = espera_mais_antiga(m, FLUXO_LO);
+
+        if(m->config.politica == POLITICA_PRESSAO){
+            criterio_ns = pressao(m, FLUXO_NS);
+            criterio_lo = pressao(m, FLUXO_LO);
+        }
+        else{
+            criterio_ns = demanda_ns;
+            criterio_lo = demanda_lo;
+        }
+
+        proximo_estado = controle_escolher_eixo(criterio_ns, criterio_lo, espera_ns, espera_lo, m->config.espera_maxima, &intervencao);
+        if(intervencao) m->estatisticas.intervencoes_espera++;
+
+        iniciar_fase(m, proximo_estado);
+        if(m->config.politica == POLITICA_PRESSAO) tempo_final = T_MAXIMO;
+        else tempo_final = controle_tempo_verde(m->config.modelo_verde, m->vazao[proximo_estado],
+            (proximo_estado == FLUXO_NS) ? demanda_ns : demanda_lo);
+
+        m->fase_controlador = CONTROLE_VERDE;
+        m->fim_verde = m->agora + tempo_final;
+        m->prazo_controlador = m->agora + 1;
+        m->inicio_verde = m->agora;
+        m->ultima_entrada = m->inicio_verde;
+        m->entradas_verde = 0;
+        abrir_faixas(m);
+        agendar_controlador(m, (m->prazo_admissao < m->prazo_controlador) ? m->prazo_admissao : m->prazo_controlador);
+        return;
+
+    case CONTROLE_VERDE:
+        // O evento é o da próxima liberação de faixa, se ela vem antes da próxima verificação
+        so_admissao = m->prazo_admissao < m->prazo_controlador - 1e-6;
+        liberar_faixas(m, so_admissao ? m->prazo_admissao : m->prazo_controlador);
+        if(so_admissao){
+            agendar_controlador(m, (m->prazo_admissao < m->prazo_controlador) ? m->prazo_admissao : m->prazo_controlador);
+            return;
+        }
+
+        if(m->estado_atual == FLUXO_NS) fila_ativa_esvaziou = m->carros_esperando[NORTE] == 0 && m->carros_esperando[SUL] == 0;
+        else fila_ativa_esvaziou = m->carros_esperando[LESTE] == 0 && m->carros_esperando[OESTE] == 0;
+
+        eixo_oposto = (m->estado_atual == FLUXO_NS) ? FLUXO_LO : FLUXO_NS;
+        espera_oposta = espera_mais_antiga(m, eixo_oposto);
+        espera_estourou = controle_espera_estourou(m->config.espera_maxima, m->instante_controle - m->inicio_verde, fila_ativa_esvaziou,
+            espera_mais_antiga(m, m->estado_atual), espera_oposta);
+        pressao_superada = controle_pressao_superada(m->config.politica, m->instante_controle - m->inicio_verde, fila_ativa_esvaziou,
+            espera_estourou, pressao(m, m->estado_atual), pressao(m, eixo_oposto));
+
+        if(fila_ativa_esvaziou || espera_estourou || pressao_superada || m->modo_emergencia || m->prazo_controlador >= m->fim_verde - 1e-6){
+            m->fase_controlador = CONTROLE_PAUSA;
+            m->prazo_controlador = m->agora + TEMPO_PAUSA;
+            m->fluxo_encerrado = true;
+            encerrar_verde(m);
+            if(espera_estourou) m->estatisticas.intervencoes_espera++;
+            agendar_controlador(m, m->prazo_controlador);
+            return;
+        }
+        m->prazo_controlador = (m->prazo_controlador + 1 < m->fim_verde) ? m->prazo_controlador + 1 : m->fim_verde;
+        agendar_controlador(m, (m->prazo_admissao < m->prazo_controlador) ? m->prazo_admissao : m->prazo_controlador);
+        return;
+
+    case CONTROLE_EMERGENCIA:
+        if(m->modo_emergencia){
+            // Se o eixo aberto já foi atendido e há ambulâncias esperando no outro, alterna o eixo assim que o cruzamento esvaziar
+            if(controle_alternar_ambulancias(m->estado_atual, m->ambulancias_esperando, m->ambulancias_no_cruzamento)){
+                iniciar_fase(m, (m->estado_atual == AMBULANCIA_NS) ? AMBULANCIA_LO : AMBULANCIA_NS);
+                admitir_ambulancias(m);
+            }
+            return;
+        }
+        m->fase_controlador = CONTROLE_PAUSA;
+        m->prazo_controlador = m->agora + TEMPO_PAUSA;
+        agendar_controlador(m, m->prazo_controlador);
+        return;
+    }
+}
+
+/**
+ * @brief Reavalia a controladora depois de uma mudança no estado dos veículos, se ela está em uma das esperas que dependem dele
+ *
+ */
+static void reagir(Motor *m){
+    if(m->aguardando_saida || m->fase_controlador == CONTROLE_EMERGENCIA) controlar(m);
+}
+
+/**
+ * @brief Comportamento de um veículo, na sequência de carros() e ambulancia() em cruzamento.c, como corrotina sem pilha. A aproximação é
+ * o evento de chegada agendado por motor_chegadas(); as esperas por tempo agendam o evento que retoma a corrotina, e as esperas pela vez
+ * de entrar são retomadas pela controladora ao abrir a passagem, como o pthread_cond_wait() em pode_cruzar. O veículo avisa a
+ * controladora onde a versão com threads faz o pthread_cond_broadcast(): ela reage depois que o veículo suspende.
+ *
+ */
+static void veiculo(Motor *m, int indice){
+    VeiculoMotor *v = &m->veiculos[indice];
+    int faixa;
+
+    CORROTINA_INICIO(v->retomada);
+    if(v->tipo == TIPO_CARRO){
+        // Entra no fim da fila da faixa de menor fila
+        faixa = FAIXA(v->direcao, controle_escolher_faixa(m->fila_faixa, m->config.faixas, v->direcao));
+        v->faixa = faixa;
+        v->seguinte = -1;
+        if(m->cauda_faixa[faixa] < 0) m->cabeca_faixa[faixa] = indice;
+        else m->veiculos[m->cauda_faixa[faixa]].seguinte = indice;
+        m->cauda_faixa[faixa] = indice;
+        m->fila_faixa[faixa]++;
+        m->carros_esperando[v->direcao]++;
+        v->chegada = m->agora;
+        m->estatisticas.chegadas[TIPO_CARRO][v->direcao]++;
+
+        // Espera ser o primeiro da faixa com ela liberada no verde da direção, atravessa e sai
+        CORROTINA_ESPERAR_QUE(v->retomada, m->cabeca_faixa[v->faixa] == indice && faixa_admite(m, v->faixa));
+        entrar_carro(m, v->faixa);
+        agendar(m, m->agora + TEMPO_TRAVESSIA, EVENTO_SAIDA, indice);
+        CORROTINA_SUSPENDER(v->retomada);
+        m->carros_no_cruzamento--;
+    }
+    else{
+        // Anuncia a emergência, o que barra a entrada de carros, e chega à fila TEMPO_ANUNCIO segundos depois
+        if(!m->modo_emergencia) m->estatisticas.emergencias++;
+        m->ambulancias_em_emergencia++;
+        m->modo_emergencia = true;
+        m->controladora_avisada = true;
+        agendar(m, m->agora + TEMPO_ANUNCIO, EVENTO_FILA_AMBULANCIA, indice);
+        CORROTINA_SUSPENDER(v->retomada);
+
+        v->seguinte = -1;
+        if(m->cauda_ambulancia[v->direcao] < 0) m->cabeca_ambulancia[v->direcao] = indice;
+        else m->veiculos[m->cauda_ambulancia[v->direcao]].seguinte = indice;
+        m->cauda_ambulancia[v->direcao] = indice;
+        m->ambulancias_esperando[v->direcao]++;
+        v->chegada = m->agora;
+        m->estatisticas.chegadas[TIPO_AMBULANCIA][v->direcao]++;
+        m->controladora_avisada = true;
+
+        // Espera ser a primeira da fila com a passagem liberada para a sua direção, atravessa e sai
+        CORROTINA_ESPERAR_QUE(v->retomada, m->cabeca_ambulancia[v->direcao] == indice
+            && controle_pode_passar(m->modo_emergencia, v->direcao, m->estado_atual, TIPO_AMBULANCIA));
+        m->cabeca_ambulancia[v->direcao] = v->seguinte;
+        if(m->cabeca_ambulancia[v->direcao] < 0) m->cauda_ambulancia[v->direcao] = -1;
+        m->ambulancias_esperando[v->direcao]--;
+        m->ambulancias_no_cruzamento++;
+        registrar_entrada(m, v);
+        agendar(m, m->agora + TEMPO_TRAVESSIA_AMBULANCIA, EVENTO_SAIDA, indice);
+        CORROTINA_SUSPENDER(v->retomada);
+
+        // A emergência só termina quando não resta nenhuma ambulância anunciada, na fila ou dentro do cruzamento
+        m->ambulancias_no_cruzamento--;
+        m->ambulancias_em_emergencia--;
+        m->modo_emergencia = m->ambulancias_em_emergencia > 0;
+    }
+    m->estatisticas.travessias[v->tipo][v->direcao]++;
+    m->controladora_avisada = true;
+    liberar_veiculo(m, indice);
+    CORROTINA_FIM;
+}
+
+/**
+ * @brief Retoma o veículo no seu evento e deixa a controladora reagir, se ele a avisou
+ *
+ */
+static void processar_veiculo(Motor *m, int indice){
+    veiculo(m, indice);
+    if(m->controladora_avisada){
+        m->controladora_avisada = false;
+        reagir(m);
+    }
+}
+
+void motor_config_padrao(ConfigMotor *config){
+    config->faixas[NORTE] = config->faixas[SUL] = FAIXAS_NS;
+    config->faixas[LESTE] = config->faixas[OESTE] = FAIXAS_LO;
+    config->intervalo_saturacao = INTERVALO_SATURACAO;
+    config->espera_maxima = ESPERA_MAXIMA;
+    config->modelo_verde = VERDE_VAZAO;
+    config->politica = POLITICA_DEMANDA;
+}
+
+Motor *motor_criar(const ConfigMotor *config){
+    Motor *m;
+    int i;
+
+    m = calloc(1, sizeof(Motor));
+    if(m == NULL){
+        errno = ENOMEM;
+        return NULL;
+    }
+    if(config != NULL) m->config = *config;
+    else motor_config_padrao(&m->config);
+
+    for(i = 0; i < NUM_DIRECOES; i++){
+        if(m->config.faixas[i] < 1 || m->config.faixas[i] > MAX_FAIXAS) break;
+    }
+    if(i < NUM_DIRECOES || m->config.intervalo_saturacao < 0 || m->config.espera_maxima < 0
+        || (m->config.modelo_verde != VERDE_FORMULA && m->config.modelo_verde != VERDE_VAZAO)
+        || (m->config.politica != POLITICA_DEMANDA && m->config.politica != POLITICA_PRESSAO)){
+        free(m);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    m->eventos = malloc(CAPACIDADE_INICIAL * sizeof(Evento));
+    m->veiculos = malloc(CAPACIDADE_INICIAL * sizeof(VeiculoMotor));
+    if(m->eventos == NULL || m->veiculos == NULL){
+        motor_destruir(m);
+        errno = ENOMEM;
+        return NULL;
+    }
+    m->capacidade_eventos = m->capacidade_veiculos = CAPACIDADE_INICIAL;
+    for(i = 0; i < CAPACIDADE_INICIAL; i++){
+        m->eventos[i].seguinte = m->veiculos[i].seguinte = (i + 1 < CAPACIDADE_INICIAL) ? i + 1 : -1;
+    }
+    m->livre = m->livre_evento = 0;
+    m->prontos = m->distantes = -1;
+
+    for(i = 0; i < NUM_DIRECOES * MAX_FAIXAS; i++){
+        m->cabeca_faixa[i] = m->cauda_faixa[i] = -1;
+        m->faixa_liberada[i] = true;
+    }
+    for(i = 0; i < NUM_DIRECOES; i++) m->cabeca_ambulancia[i] = m->cauda_ambulancia[i] = -1;
+    m->estado_atual = FLUXO_NS;
+    m->fluxo_encerrado = true;
+    m->vazao[FLUXO_NS] = m->vazao[FLUXO_LO] = VAZAO_INICIAL;
+    m->fase_controlador = CONTROLE_PAUSA;
+    m->prazo_controlador = TEMPO_PAUSA;
+    agendar_controlador(m, m->prazo_controlador);
+    if(m->sem_memoria){
+        motor_destruir(m);
+        errno = ENOMEM;
+        return NULL;
+    }
+    return m;
+}
+
+void motor_destruir(Motor *m){
+    if(m == NULL) return;
+    free(m->eventos);
+    free(m->veiculos);
+    free(m);
+}
+
+int motor_chegadas(Motor *m, const Chegada *chegadas, int n){
+    int i, indice;
+
+    if(n < 0){
+        errno = EINVAL;
+        return -1;
+    }
+    if(m->sem_memoria){
+        errno = ENOMEM;
+        return -1;
+    }
+    for(i = 0; i < n; i++){
+        if(chegadas[i].direcao < NORTE || chegadas[i].direcao >= NUM_DIRECOES || chegadas[i].tipo < TIPO_CARRO
+            || chegadas[i].tipo >= NUM_TIPOS || !(chegadas[i].instante >= m->agora)){
+            errno = EINVAL;
+            return -1;
+        }
+    }
+    // Todo o espaço do lote é reservado antes de qualquer inserção: ou o lote inteiro é agendado, ou nenhuma chegada
+    if(reservar_veiculos(m, n) < 0 || reservar_eventos(m, n) < 0) return -1;
+
+    for(i = 0; i < n; i++){
+        indice = alocar_veiculo(m);
+        m->veiculos[indice].direcao = chegadas[i].direcao;
+        m->veiculos[indice].tipo = chegadas[i].tipo;
+        m->veiculos[indice].retomada = 0;
+        agendar(m, chegadas[i].instante, EVENTO_CHEGADA, indice);
+    }
+    return 0;
+}
+
+int motor_chegada(Motor *m, Direcao dir, TipoVeiculo tipo, double instante){
+    Chegada chegada;
+
+    chegada.instante = instante;
+    chegada.direcao = dir;
+    chegada.tipo = tipo;
+    return motor_chegadas(m, &chegada, 1);
+}
+
+/**
+ * @brief Traz para a lista de prontos os eventos do próximo tick e descarta do início dela os eventos da controladora substituídos por
+ * um agendamento posterior
+ *
+ */
+static void descartar_obsoletos(Motor *m){
+    for(avancar_roda(m); m->prontos >= 0 && m->eventos[m->prontos].tipo == EVENTO_CONTROLADOR
+        && m->eventos[m->prontos].alvo != m->geracao_controlador; avancar_roda(m)) retirar_evento(m);
+}
+
+int motor_passo(Motor *m){
+    Evento evento;
+
+    if(m->sem_memoria){
+        errno = ENOMEM;
+        return -1;
+    }
+    descartar_obsoletos(m);
+    if(m->prontos < 0) return 0;
+
+    evento = retirar_evento(m);
+    m->agora = evento.instante;
+    m->estatisticas.eventos++;
+    if(evento.tipo == EVENTO_CONTROLADOR) controlar(m);
+    else processar_veiculo(m, evento.alvo);
+    if(m->sem_memoria){
+        errno = ENOMEM;
+        return -1;
+    }
+    return 1;
+}
+
+int motor_avancar(Motor *m, double ate){
+    int processados = 0;
+
+    if(!(ate >= m->agora)){
+        errno = EINVAL;
+        return -1;
+    }
+    for(descartar_obsoletos(m); m->prontos >= 0 && m->eventos[m->prontos].instante <= ate; descartar_obsoletos(m)){
+        if(motor_passo(m) < 0) return -1;
+        processados++;
+    }
+    m->agora = ate;
+    return processados;
+}
+
+int motor_jusante(Motor *m, const int *jusante){
+    int d;
+
+    for(d = 0; jusante != NULL && d < NUM_DIRECOES; d++){
+        if(jusante[d] < 0){
+            errno = EINVAL;
+            return -1;
+        }
+    }
+    for(d = 0; d < NUM_DIRECOES; d++) m->jusante[d] = (jusante != NULL) ? jusante[d] : 0;
+    return 0;
+}
+
+double motor_proximo(Motor *m){
+    descartar_obsoletos(m);
+    return (m->prontos >= 0) ? m->eventos[m->prontos].instante : INFINITY;
+}
+
+double motor_agora(const Motor *m){
+    return m->agora;
+}
+
+void motor_estatisticas(const Motor *m, EstatisticasMotor *estatisticas){
+    int d;
+
+    *estatisticas = m->estatisticas;
+    estatisticas->agora = m->agora;
+    estatisticas->estado_atual = m->estado_atual;
+    for(d = 0; d < NUM_DIRECOES; d++){
+        estatisticas->carros_esperando[d] = m->carros_esperando[d];
+        estatisticas->ambulancias_esperando[d] = m->ambulancias_esperando[d];
+    }
+    estatisticas->carros_no_cruzamento = m->carros_no_cruzamento;
+    estatisticas->ambulancias_no_cruzamento = m->ambulancias_no_cruzamento;
+}
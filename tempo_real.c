@@ -0,0 +1,461 @@
+/**
+ *
+ * Execução em tempo real de muitos cruzamentos do motor (cruzamento.h) com laços de eventos epoll, timerfd e eventfd.
+ *
+ *      O simulador com threads dá a cada veículo uma thread que dorme em sleep() e espera em pthread_cond_wait(); aqui não há uma thread
+ * por veículo nem por cruzamento. Cada laço (por padrão, um por núcleo) conduz uma parte das instâncias do motor pelo relógio real,
+ * multiplicado por VELOCIDADE:
+ *      (a) um timerfd acorda o laço no instante real do próximo evento das suas instâncias, nunca antes de RESOLUCAO milissegundos
+ *          depois do despertar anterior, de modo que eventos próximos são processados juntos;
+ *      (b) as chegadas são geradas pelos geradores de demanda HORIZONTE_DEMANDA segundos à frente e injetadas em lotes;
+ *      (c) um eventfd acorda o laço para as injeções pedidas de fora (ambulâncias pela entrada padrão) e para encerrar.
+ * A thread principal espera em epoll pela entrada padrão, por um timerfd de um segundo que atualiza o painel e por SIGINT/SIGTERM
+ * (signalfd). Ao fim imprime o uso de CPU, que cai com a população apenas pelo custo dos eventos, sem trocas de contexto por veículo.
+ *
+ * Uso: tempo_real [-i INSTANCIAS] [-n LACOS] [-t TAXA] [-a TAXA] [-d DURACAO] [-v VELOCIDADE] [-r RESOLUCAO] [-s SEMENTE]
+ *
+ *   -i INSTANCIAS número de cruzamentos (padrão 1000)
+ *   -n LACOS      número de laços de eventos, cada um em uma thread (padrão: número de núcleos)
+ *   -t TAXA       carros por hora em cada direção de cada cruzamento (padrão 300)
+ *   -a TAXA       ambulâncias por hora em cada direção de cada cruzamento (padrão 0.5)
+ *   -d DURACAO    duração, em segundos de relógio real (padrão: até "q" ou SIGINT)
+ *   -v VELOCIDADE segundos simulados por segundo real (padrão 1)
+ *   -r RESOLUCAO  intervalo mínimo entre dois despertares de um laço, em milissegundos (padrão 10)
+ *   -s SEMENTE    semente dos geradores de demanda (padrão 1)
+ *
+ * Comandos na entrada padrão: "a DIRECAO" (N, S, L ou O) injeta uma ambulância no cruzamento 0; "q" encerra.
+ *
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/resource.h>
+
+#include "cruzamento.h"
+
+#define USO "Uso: %s [-i INSTANCIAS] [-n LACOS] [-t TAXA] [-a TAXA] [-d DURACAO] [-v VELOCIDADE] [-r RESOLUCAO] [-s SEMENTE]\n"
+#define HORIZONTE_DEMANDA 5.0           // Antecedência, em segundos simulados, com que as chegadas são geradas e injetadas
+#define CAPACIDADE_LOTE 1024
+#define MAX_PEDIDOS 64                  // Injeções externas pendentes por laço
+
+
+/**
+ * @brief Laço de eventos de uma thread e as instâncias que ele conduz
+ *
+ */
+typedef struct{
+    int inicio, fim;                    // Instâncias [inicio, fim) de 'motores' e 'demandas'
+    int epoll, temporizador, aviso;     // Descritores do epoll, do timerfd e do eventfd do laço
+    pthread_t thread;
+    pthread_mutex_t lock;               // Protege os campos abaixo, compartilhados com a thread principal
+    Chegada pedidos[MAX_PEDIDOS];       // Injeções externas ainda não entregues ao motor (sempre no cruzamento 0)
+    int num_pedidos;
+    bool encerrar;
+    bool falhou;                        // O laço parou por falha de um motor (e pediu o encerramento com SIGTERM)
+    EstatisticasMotor resumo;           // Soma das estatísticas das instâncias, publicada a cada segundo
+    EstatisticasMotor primeiro;         // Estatísticas do cruzamento 0, se ele é deste laço
+    uint64_t despertares;
+} Laco;
+
+Motor **motores;
+Demanda **demandas;
+double *proximo_evento;                 // Instante do próximo evento de cada instância: só as vencidas são avançadas a cada despertar
+double velocidade = 1, resolucao = 0.010;
+struct timespec inicio_real;
+
+/**
+ * @brief Segundos de relógio real (CLOCK_MONOTONIC) desde o início da execução
+ *
+ */
+double segundos_reais(void){
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (t.tv_sec - inicio_real.tv_sec) + (t.tv_nsec - inicio_real.tv_nsec) / 1e9;
+}
+
+/**
+ * @brief Arma o timerfd para o instante real (em segundos desde o início) 'segundos', de forma absoluta
+ *
+ */
+void armar(int temporizador, double segundos){
+    struct itimerspec prazo;
+    double inteiro;
+
+    memset(&prazo, 0, sizeof(prazo));
+    prazo.it_value.tv_nsec = (long) (modf(segundos, &inteiro) * 1e9) + inicio_real.tv_nsec;
+    prazo.it_value.tv_sec = (time_t) inteiro + inicio_real.tv_sec + prazo.it_value.tv_nsec / 1000000000L;
+    prazo.it_value.tv_nsec %= 1000000000L;
+    timerfd_settime(temporizador, TFD_TIMER_ABSTIME, &prazo, NULL);
+}
+
+/**
+ * @brief Acumula em 'total' as estatísticas de uma instância
+ *
+ */
+void somar_estatisticas(EstatisticasMotor *total, const EstatisticasMotor *e){
+    int d, t;
+
+    for(d = 0; d < NUM_DIRECOES; d++){
+        total->carros_esperando[d] += e->carros_esperando[d];
+        total->ambulancias_esperando[d] += e->ambulancias_esperando[d];
+        for(t = 0; t < NUM_TIPOS; t++){
+            total->chegadas[t][d] += e->chegadas[t][d];
+            total->travessias[t][d] += e->travessias[t][d];
+        }
+    }
+    for(t = 0; t < NUM_TIPOS; t++){
+        total->espera_soma[t] += e->espera_soma[t];
+        if(e->espera_pior[t] > total->espera_pior[t]) total->espera_pior[t] = e->espera_pior[t];
+    }
+    total->carros_no_cruzamento += e->carros_no_cruzamento;
+    total->ambulancias_no_cruzamento += e->ambulancias_no_cruzamento;
+    total->emergencias += e->emergencias;
+    total->eventos += e->eventos;
+}
+
+/**
+ * @brief Registra a falha de 'operacao' em um motor do laço e pede o encerramento de todo o programa com SIGTERM, que a thread principal
+ * recebe pelo signalfd. Continuar apenas com as instâncias restantes deixaria o RESUMO sem parte da demanda, sem aviso.
+ *
+ */
+void falhar(Laco *l, const char *operacao){
+    perror(operacao);
+    pthread_mutex_lock(&l->lock);
+    l->falhou = true;
+    pthread_mutex_unlock(&l->lock);
+    kill(getpid(), SIGTERM);
+}
+
+/**
+ * @brief Laço de eventos de uma thread: a cada despertar (timerfd ou eventfd), entrega as injeções pedidas, gera a demanda à frente,
+ * leva o relógio de cada instância ao instante simulado correspondente ao relógio real e dorme até o próximo evento.
+ *
+ * @param arg Laco* do laço
+ */
+void *executar_laco(void *arg){
+    Laco *l = (Laco*) arg;
+    struct epoll_event prontos[2];
+    Chegada lote[CAPACIDADE_LOTE], pedidos[MAX_PEDIDOS];
+    EstatisticasMotor resumo, e;
+    int i, k, n, num_pedidos;
+    bool encerrar = false;
+    uint64_t valor, despertares = 0;
+    double agora, proximo, gerado_ate = 0, publicacao = 0, despertar_anterior = 0;
+
+    while(!encerrar){
+        n = epoll_wait(l->epoll, prontos, 2, -1);
+        for(k = 0; k < n; k++){
+            if(read(prontos[k].data.fd, &valor, sizeof(valor)) < 0) continue;  // Esvazia o timerfd ou o eventfd
+        }
+        despertares++;
+
+        pthread_mutex_lock(&l->lock);
+        num_pedidos = l->num_pedidos;
+        memcpy(pedidos, l->pedidos, num_pedidos * sizeof(Chegada));
+        l->num_pedidos = 0;
+        encerrar = l->encerrar;
+        pthread_mutex_unlock(&l->lock);
+
+        despertar_anterior = segundos_reais();
+        agora = despertar_anterior * velocidade;
+
+        // Injeções externas chegam agora
+        for(k = 0; k < num_pedidos; k++){
+            pedidos[k].instante = fmax(agora, motor_agora(motores[0]));
+            if(motor_chegadas(motores[0], &pedidos[k], 1) < 0){
+                falhar(l, "motor_chegadas");
+                return NULL;
+            }
+            proximo_evento[0] = pedidos[k].instante;
+        }
+
+        // Demanda gerada em lotes, sempre ao menos HORIZONTE_DEMANDA segundos à frente
+        if(agora + HORIZONTE_DEMANDA > gerado_ate){
+            gerado_ate = agora + 2 * HORIZONTE_DEMANDA;
+            for(i = l->inicio; i < l->fim; i++){
+                do{
+                    n = demanda_gerar(demandas[i], gerado_ate, lote, CAPACIDADE_LOTE);
+                    if(n > 0 && motor_chegadas(motores[i], lote, n) < 0){
+                        falhar(l, "motor_chegadas");
+                        return NULL;
+                    }
+                } while(n == CAPACIDADE_LOTE);
+                proximo_evento[i] = motor_proximo(motores[i]);
+            }
+        }
+
+        proximo = gerado_ate - HORIZONTE_DEMANDA;
+        for(i = l->inicio; i < l->fim; i++){
+            if(proximo_evento[i] <= agora || encerrar){
+                if(motor_avancar(motores[i], agora) < 0){
+                    falhar(l, "motor_avancar");
+                    return NULL;
+                }
+                proximo_evento[i] = motor_proximo(motores[i]);
+            }
+            if(proximo_evento[i] < proximo) proximo = proximo_evento[i];
+        }
+
+        // Publicação das estatísticas para o painel, uma vez por segundo real
+        if(despertar_anterior >= publicacao || encerrar){
+            memset(&resumo, 0, sizeof(resumo));
+            for(i = l->inicio; i < l->fim; i++){
+                motor_estatisticas(motores[i], &e);
+                somar_estatisticas(&resumo, &e);
+            }
+            resumo.agora = agora;
+            pthread_mutex_lock(&l->lock);
+            l->resumo = resumo;
+            if(l->inicio == 0) motor_estatisticas(motores[0], &l->primeiro);
+            l->despertares = despertares;
+            pthread_mutex_unlock(&l->lock);
+            publicacao = floor(despertar_anterior) + 1;
+        }
+
+        armar(l->temporizador, fmax(fmin(proximo / velocidade, publicacao), despertar_anterior + resolucao));
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]){
+    Laco *lacos, *l;
+    ProcessoChegada carros, ambulancias;
+    EstatisticasMotor total, primeiro;
+    struct epoll_event evento, prontos[3];
+    struct itimerspec painel;
+    struct signalfd_siginfo sinal;
+    struct rusage uso, uso_inicial;
+    sigset_t sinais;
+    char linha[64];
+    int num_instancias = 1000, num_lacos = (int) sysconf(_SC_NPROCESSORS_ONLN), opcao, i, d, k, n, epoll, temporizador, sinalizador;
+    int dir;
+    bool executando = true, falhou = false;
+    double taxa = 300, taxa_ambulancias = 0.5, duracao = INFINITY, real, cpu, entradas;
+    uint64_t semente = 1, valor = 1, travessias, despertares;
+
+    while((opcao = getopt(argc, argv, "i:n:t:a:d:v:r:s:")) != -1){
+        switch(opcao){
+        case 'i': num_instancias = atoi(optarg); break;
+        case 'n': num_lacos = atoi(optarg); break;
+        case 't': taxa = atof(optarg); break;
+        case 'a': taxa_ambulancias = atof(optarg); break;
+        case 'd': duracao = atof(optarg); break;
+        case 'v': velocidade = atof(optarg); break;
+        case 'r': resolucao = atof(optarg) / 1000; break;
+        case 's': semente = strtoull(optarg, NULL, 10); break;
+        default:
+            fprintf(stderr, USO, argv[0]);
+            return 1;
+        }
+    }
+    if(num_instancias < 1 || num_lacos < 1 || taxa < 0 || taxa_ambulancias < 0 || !(duracao > 0) || !(velocidade > 0) || resolucao < 0){
+        fprintf(stderr, USO, argv[0]);
+        return 1;
+    }
+    if(num_lacos > num_instancias) num_lacos = num_instancias;
+
+    carros.tipo = ambulancias.tipo = PROCESSO_POISSON;
+    carros.taxa = taxa;
+    ambulancias.taxa = taxa_ambulancias;
+    motores = calloc(num_instancias, sizeof(Motor*));
+    demandas = calloc(num_instancias, sizeof(Demanda*));
+    proximo_evento = calloc(num_instancias, sizeof(double));
+    lacos = calloc(num_lacos, sizeof(Laco));
+    if(motores == NULL || demandas == NULL || proximo_evento == NULL || lacos == NULL){
+        perror("calloc");
+        return 1;
+    }
+    for(i = 0; i < num_instancias; i++){
+        motores[i] = motor_criar(NULL);
+        demandas[i] = demanda_criar(semente * 1000003 + (uint64_t) i);
+        if(motores[i] == NULL || demandas[i] == NULL){
+            perror("motor_criar");
+            return 1;
+        }
+        for(d = 0; d < NUM_DIRECOES; d++){
+            demanda_fluxo(demandas[i], (Direcao) d, TIPO_CARRO, &carros);
+            demanda_fluxo(demandas[i], (Direcao) d, TIPO_AMBULANCIA, &ambulancias);
+        }
+    }
+
+    // SIGINT e SIGTERM chegam pelo signalfd da thread principal; as threads dos laços herdam a máscara
+    sigemptyset(&sinais);
+    sigaddset(&sinais, SIGINT);
+    sigaddset(&sinais, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &sinais, NULL);
+
+    getrusage(RUSAGE_SELF, &uso_inicial);
+    clock_gettime(CLOCK_MONOTONIC, &inicio_real);
+    for(k = 0; k < num_lacos; k++){
+        l = &lacos[k];
+        l->inicio = (int) ((long) num_instancias * k / num_lacos);
+        l->fim = (int) ((long) num_instancias * (k + 1) / num_lacos);
+        l->epoll = epoll_create1(0);
+        l->temporizador = timerfd_create(CLOCK_MONOTONIC, 0);
+        l->aviso = eventfd(0, 0);
+        if(l->epoll < 0 || l->temporizador < 0 || l->aviso < 0){
+            perror("epoll/timerfd/eventfd");
+            return 1;
+        }
+        pthread_mutex_init(&l->lock, NULL);
+        evento.events = EPOLLIN;
+        evento.data.fd = l->temporizador;
+        if(epoll_ctl(l->epoll, EPOLL_CTL_ADD, l->temporizador, &evento) < 0){
+            perror("epoll_ctl");
+            return 1;
+        }
+        evento.data.fd = l->aviso;
+        if(epoll_ctl(l->epoll, EPOLL_CTL_ADD, l->aviso, &evento) < 0){
+            perror("epoll_ctl");
+            return 1;
+        }
+        armar(l->temporizador, 0);
+        if(pthread_create(&l->thread, NULL, executar_laco, l) != 0){
+            fprintf(stderr, "pthread_create falhou no laco %d\n", k);
+            return 1;
+        }
+    }
+
+    epoll = epoll_create1(0);
+    temporizador = timerfd_create(CLOCK_MONOTONIC, 0);
+    sinalizador = signalfd(-1, &sinais, 0);
+    if(epoll < 0 || temporizador < 0 || sinalizador < 0){
+        perror("epoll/timerfd/signalfd");
+        return 1;
+    }
+    memset(&painel, 0, sizeof(painel));
+    painel.it_value.tv_sec = painel.it_interval.tv_sec = 1;
+    timerfd_settime(temporizador, 0, &painel, NULL);
+    evento.events = EPOLLIN;
+    evento.data.fd = temporizador;
+    if(epoll_ctl(epoll, EPOLL_CTL_ADD, temporizador, &evento) < 0){
+        perror("epoll_ctl");
+        return 1;
+    }
+    evento.data.fd = sinalizador;
+    if(epoll_ctl(epoll, EPOLL_CTL_ADD, sinalizador, &evento) < 0){
+        perror("epoll_ctl");
+        return 1;
+    }
+    evento.data.fd = STDIN_FILENO;
+    // Falha com EPERM (e é ignorada: sem comandos) se a entrada padrão é um arquivo comum
+    if(epoll_ctl(epoll, EPOLL_CTL_ADD, STDIN_FILENO, &evento) < 0 && errno != EPERM){
+        perror("epoll_ctl");
+        return 1;
+    }
+
+    printf("---------------- %d CRUZAMENTO(S) EM %d LACO(S), VELOCIDADE %gx ----------------\n", num_instancias, num_lacos, velocidade);
+    while(executando){
+        n = epoll_wait(epoll, prontos, 3, -1);
+        for(k = 0; k < n; k++){
+            if(prontos[k].data.fd == sinalizador){
+                if(read(sinalizador, &sinal, sizeof(sinal)) > 0) executando = false;
+            }
+            else if(prontos[k].data.fd == STDIN_FILENO){
+                if(fgets(linha, sizeof(linha), stdin) == NULL){
+                    epoll_ctl(epoll, EPOLL_CTL_DEL, STDIN_FILENO, NULL);
+                    continue;
+                }
+                if(linha[0] == 'q') executando = false;
+                else if(linha[0] == 'a'){
+                    for(dir = NORTE; dir < NUM_DIRECOES && (strlen(linha) < 3 || linha[2] != nome_direcao[dir][0]); dir++);
+                    if(dir == NUM_DIRECOES) dir = NORTE;
+                    pthread_mutex_lock(&lacos[0].lock);
+                    if(lacos[0].num_pedidos < MAX_PEDIDOS){
+                        lacos[0].pedidos[lacos[0].num_pedidos].direcao = (Direcao) dir;
+                        lacos[0].pedidos[lacos[0].num_pedidos++].tipo = TIPO_AMBULANCIA;
+                    }
+                    pthread_mutex_unlock(&lacos[0].lock);
+                    if(write(lacos[0].aviso, &valor, sizeof(valor)) < 0) perror("write");
+                    printf("AMBULANCIA INJETADA NA DIRECAO %s DO CRUZAMENTO 0!\n", nome_direcao[dir]);
+                }
+            }
+            else if(prontos[k].data.fd == temporizador){
+                if(read(temporizador, &valor, sizeof(valor)) < 0) continue;
+                valor = 1;
+                memset(&total, 0, sizeof(total));
+                for(i = 0; i < num_lacos; i++){
+                    pthread_mutex_lock(&lacos[i].lock);
+                    somar_estatisticas(&total, &lacos[i].resumo);
+                    if(i == 0) primeiro = lacos[i].primeiro;
+                    pthread_mutex_unlock(&lacos[i].lock);
+                }
+                travessias = 0;
+                for(d = 0; d < NUM_DIRECOES; d++) travessias += total.travessias[TIPO_CARRO][d];
+                entradas = travessias + total.carros_no_cruzamento;
+                printf("[t=%.0fs] cruzamento 0: [%s%s] fila %d/%d/%d/%d | todos: no cruzamento %d carro(s), %d ambulancia(s), passaram %llu, "
+                    "espera media %.2fs\n", segundos_reais() * velocidade, nome_estado[primeiro.estado_atual],
+                    (primeiro.ambulancias_esperando[NORTE] + primeiro.ambulancias_esperando[SUL] + primeiro.ambulancias_esperando[LESTE]
+                    + primeiro.ambulancias_esperando[OESTE] + primeiro.ambulancias_no_cruzamento > 0) ? ", EMERGENCIA" : "",
+                    primeiro.carros_esperando[NORTE], primeiro.carros_esperando[SUL], primeiro.carros_esperando[LESTE],
+                    primeiro.carros_esperando[OESTE], total.carros_no_cruzamento, total.ambulancias_no_cruzamento,
+                    (unsigned long long) travessias, entradas > 0 ? total.espera_soma[TIPO_CARRO] / entradas : 0);
+                fflush(stdout);
+                if(segundos_reais() >= duracao) executando = false;
+            }
+        }
+    }
+
+    for(k = 0; k < num_lacos; k++){
+        pthread_mutex_lock(&lacos[k].lock);
+        lacos[k].encerrar = true;
+        pthread_mutex_unlock(&lacos[k].lock);
+        valor = 1;
+        if(write(lacos[k].aviso, &valor, sizeof(valor)) < 0) perror("write");
+    }
+    memset(&total, 0, sizeof(total));
+    despertares = 0;
+    for(k = 0; k < num_lacos; k++){
+        pthread_join(lacos[k].thread, NULL);
+        somar_estatisticas(&total, &lacos[k].resumo);
+        despertares += lacos[k].despertares;
+        falhou = falhou || lacos[k].falhou;
+        close(lacos[k].epoll);
+        close(lacos[k].temporizador);
+        close(lacos[k].aviso);
+        pthread_mutex_destroy(&lacos[k].lock);
+    }
+    real = segundos_reais();
+    getrusage(RUSAGE_SELF, &uso);
+    cpu = (uso.ru_utime.tv_sec - uso_inicial.ru_utime.tv_sec) + (uso.ru_utime.tv_usec - uso_inicial.ru_utime.tv_usec) / 1e6
+        + (uso.ru_stime.tv_sec - uso_inicial.ru_stime.tv_sec) + (uso.ru_stime.tv_usec - uso_inicial.ru_stime.tv_usec) / 1e6;
+
+    travessias = 0;
+    for(d = 0; d < NUM_DIRECOES; d++) travessias += total.travessias[TIPO_CARRO][d];
+    entradas = travessias + total.carros_no_cruzamento;
+    printf("RESUMO instancias=%d lacos=%d real=%.1f simulado=%.1f travessias=%llu espera_media=%.3f eventos=%llu despertares_por_segundo=%.1f "
+        "cpu=%.3f\n", num_instancias, num_lacos, real, real * velocidade, (unsigned long long) travessias,
+        entradas > 0 ? total.espera_soma[TIPO_CARRO] / entradas : 0, (unsigned long long) total.eventos, despertares / real, cpu / real);
+
+    for(i = 0; i < num_instancias; i++){
+        motor_destruir(motores[i]);
+        demanda_destruir(demandas[i]);
+    }
+    free(motores);
+    free(demandas);
+    free(proximo_evento);
+    free(lacos);
+    close(epoll);
+    close(temporizador);
+    close(sinalizador);
+    return falhou ? 1 : 0;
+}
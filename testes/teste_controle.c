@@ -0,0 +1,307 @@
+/**
+ *
+ * Testes das regras da controladora (controle.c) e do motor (motor.c) de libcruzamento.a.
+ *
+ *      Cada VERIFICAR() que falha imprime a condição e a linha, e o programa termina com status 1 se algum falhou. Os casos do motor
+ * conduzem instâncias pela interface pública, com chegadas de Poisson, e conferem o que não depende da política: todo
+ * veículo injetado atravessa, a mesma sequência de chamadas produz o mesmo resultado e as chamadas inválidas são recusadas.
+ *
+ * Uso: make teste
+ *
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#include "cruzamento.h"
+
+#define VERIFICAR(condicao) do{ \
+    if(!(condicao)){ fprintf(stderr, "%s:%d: falhou: %s\n", __FILE__, __LINE__, #condicao); falhas++; } \
+    verificacoes++; \
+} while(0)
+
+int falhas = 0, verificacoes = 0;
+
+/**
+ * @brief Contexto de controle_liberar_faixas() nos testes: conta as faixas admitidas e, se 'bloquear' é verdadeiro, simula a entrada de
+ * um carro, que bloqueia a faixa de novo e antecipa o prazo de admissão
+ *
+ */
+typedef struct{
+    int admitidas[NUM_DIRECOES * MAX_FAIXAS];
+    bool bloquear;
+    bool *faixa_liberada;
+    double *proxima_entrada, *prazo_admissao, nova_entrada;
+} Admissao;
+
+void admitir_teste(void *contexto, int faixa){
+    Admissao *a = (Admissao*) contexto;
+
+    a->admitidas[faixa]++;
+    if(a->bloquear){
+        a->faixa_liberada[faixa] = false;
+        a->proxima_entrada[faixa] = a->nova_entrada;
+        if(a->nova_entrada < *a->prazo_admissao) *a->prazo_admissao = a->nova_entrada;
+    }
+}
+
+void testar_passagem(void){
+    VERIFICAR(controle_eixo(NORTE) == FLUXO_NS && controle_eixo(SUL) == FLUXO_NS);
+    VERIFICAR(controle_eixo(LESTE) == FLUXO_LO && controle_eixo(OESTE) == FLUXO_LO);
+
+    VERIFICAR(controle_pode_passar(false, NORTE, FLUXO_NS, TIPO_CARRO));
+    VERIFICAR(!controle_pode_passar(false, LESTE, FLUXO_NS, TIPO_CARRO));
+    VERIFICAR(controle_pode_passar(false, OESTE, FLUXO_LO, TIPO_AMBULANCIA));
+    VERIFICAR(!controle_pode_passar(true, NORTE, FLUXO_NS, TIPO_CARRO));
+    VERIFICAR(controle_pode_passar(true, NORTE, FLUXO_NS, TIPO_AMBULANCIA));
+    VERIFICAR(!controle_pode_passar(false, SUL, AMBULANCIA_NS, TIPO_CARRO));
+    VERIFICAR(controle_pode_passar(true, SUL, AMBULANCIA_NS, TIPO_AMBULANCIA));
+    VERIFICAR(!controle_pode_passar(true, LESTE, AMBULANCIA_NS, TIPO_AMBULANCIA));
+}
+
+void testar_faixas(void){
+    int fila[NUM_DIRECOES * MAX_FAIXAS] = {0};
+    int faixas[NUM_DIRECOES] = {3, 1, 2, 2};
+
+    // Menor fila, e a de menor índice no empate
+    VERIFICAR(controle_escolher_faixa(fila, faixas, NORTE) == 0);
+    fila[FAIXA(NORTE, 0)] = 2;
+    fila[FAIXA(NORTE, 1)] = 1;
+    fila[FAIXA(NORTE, 2)] = 1;
+    VERIFICAR(controle_escolher_faixa(fila, faixas, NORTE) == 1);
+    // Faixas além das em uso não contam
+    fila[FAIXA(SUL, 1)] = -5;
+    VERIFICAR(controle_escolher_faixa(fila, faixas, SUL) == 0);
+
+    // Faixa crítica vezes as faixas do eixo: 2 carros na pior faixa de 3 + 1 faixas
+    VERIFICAR(controle_demanda_faixas(fila, faixas, FLUXO_NS) == 2 * 4);
+    VERIFICAR(controle_demanda_faixas(fila, faixas, FLUXO_LO) == 0);
+    fila[FAIXA(OESTE, 1)] = 5;
+    VERIFICAR(controle_demanda_faixas(fila, faixas, FLUXO_LO) == 5 * 4);
+}
+
+void testar_espera(void){
+    bool intervencao;
+
+    // Com espera máxima de 30s a intervenção começa aos 24s (30 - FOLGA_ESPERA), arredondados para o segundo mais próximo
+    VERIFICAR(!controle_espera_estourando(30, 23.4));
+    VERIFICAR(controle_espera_estourando(30, 23.5));
+    VERIFICAR(!controle_espera_estourando(0, 1000));
+
+    // Maior critério, espera mais antiga no empate
+    VERIFICAR(controle_escolher_eixo(5, 3, 0, 10, 30, &intervencao) == FLUXO_NS && !intervencao);
+    VERIFICAR(controle_escolher_eixo(3, 3, 2, 10, 30, &intervencao) == FLUXO_LO && !intervencao);
+    // Espera prestes a estourar vence a política
+    VERIFICAR(controle_escolher_eixo(9, 1, 2, 25, 30, &intervencao) == FLUXO_LO && intervencao);
+    VERIFICAR(controle_escolher_eixo(9, 1, 2, 25, 0, &intervencao) == FLUXO_NS && !intervencao);
+
+    // O verde só é encerrado pela espera depois de T_MINIMO, com fila no eixo aberto e se o fechado espera há mais tempo
+    VERIFICAR(controle_espera_estourou(30, T_MINIMO, false, 5, 25));
+    VERIFICAR(!controle_espera_estourou(30, T_MINIMO - 1, false, 5, 25));
+    VERIFICAR(!controle_espera_estourou(30, T_MINIMO, true, 5, 25));
+    VERIFICAR(!controle_espera_estourou(30, T_MINIMO, false, 26, 25));
+
+    VERIFICAR(controle_pressao_superada(POLITICA_PRESSAO, T_MINIMO, false, false, 2, 3));
+    VERIFICAR(!controle_pressao_superada(POLITICA_DEMANDA, T_MINIMO, false, false, 2, 3));
+    VERIFICAR(!controle_pressao_superada(POLITICA_PRESSAO, T_MINIMO, false, true, 2, 3));
+    VERIFICAR(!controle_pressao_superada(POLITICA_PRESSAO, T_MINIMO, false, false, 3, 3));
+
+    // Pressão: montante menos jusante, pela vazão; uma jusante mais cheia que a montante dá pressão negativa
+    VERIFICAR(controle_pressao(6, 0, 0.5) == 3);
+    VERIFICAR(controle_pressao(6, 2, 0.5) == 2);
+    VERIFICAR(controle_pressao(2, 6, 0.5) == -2);
+    VERIFICAR(controle_pressao(4, 4, 0.5) == 0);
+}
+
+void testar_verde(void){
+    double vazao;
+
+    VERIFICAR(controle_tempo_verde(VERDE_FORMULA, 1, 0) == T_MINIMO);
+    VERIFICAR(controle_tempo_verde(VERDE_FORMULA, 1, 3) == (int) (T_BASE + 2 * FATOR_CARRO));
+    VERIFICAR(controle_tempo_verde(VERDE_FORMULA, 1, 100) == T_MAXIMO);
+    // Pela vazão o tempo é arredondado para cima: 7 carros a 0,5 carro/s pedem 14s, 7 a 0,6 pedem 11,67s
+    VERIFICAR(controle_tempo_verde(VERDE_VAZAO, 0.5, 7) == 14);
+    VERIFICAR(controle_tempo_verde(VERDE_VAZAO, 0.6, 7) == 12);
+    VERIFICAR(controle_tempo_verde(VERDE_VAZAO, 0.5, 1) == T_MINIMO);
+
+    VERIFICAR(controle_vazao(0.4, 0, 10, 3) == 0.4);
+    vazao = controle_vazao(0.4, 5, 10, 3);
+    VERIFICAR(fabs(vazao - ((1 - ALFA_VAZAO) * 0.4 + ALFA_VAZAO * 0.5)) < 1e-12);
+    // Trecho útil menor que um segundo conta como um segundo
+    vazao = controle_vazao(0.4, 1, 0, 3);
+    VERIFICAR(fabs(vazao - ((1 - ALFA_VAZAO) * 0.4 + ALFA_VAZAO * 1.0)) < 1e-12);
+    // Um verde que esvaziou a fila só é amostra com MIN_ENTRADAS_VAZAO entradas
+    VERIFICAR(controle_vazao(0.4, MIN_ENTRADAS_VAZAO - 1, 2, 0) == 0.4);
+    vazao = controle_vazao(0.4, MIN_ENTRADAS_VAZAO, 10, 0);
+    VERIFICAR(fabs(vazao - ((1 - ALFA_VAZAO) * 0.4 + ALFA_VAZAO * MIN_ENTRADAS_VAZAO / 10.0)) < 1e-12);
+}
+
+void testar_ambulancias(void){
+    int esperando[NUM_DIRECOES] = {0};
+
+    VERIFICAR(controle_eixo_ambulancias(esperando) == AMBULANCIA_NS);
+    esperando[LESTE] = 1;
+    VERIFICAR(controle_eixo_ambulancias(esperando) == AMBULANCIA_LO);
+    VERIFICAR(controle_alternar_ambulancias(AMBULANCIA_NS, esperando, 0));
+    VERIFICAR(!controle_alternar_ambulancias(AMBULANCIA_NS, esperando, 1));
+    VERIFICAR(!controle_alternar_ambulancias(AMBULANCIA_LO, esperando, 0));
+    esperando[SUL] = 1;
+    VERIFICAR(!controle_alternar_ambulancias(AMBULANCIA_NS, esperando, 0));
+}
+
+void testar_liberacao(void){
+    bool liberada[NUM_DIRECOES * MAX_FAIXAS];
+    double proxima[NUM_DIRECOES * MAX_FAIXAS], prazo = -1;
+    Admissao a;
+    int f;
+
+    memset(&a, 0, sizeof(a));
+    for(f = 0; f < NUM_DIRECOES * MAX_FAIXAS; f++){
+        liberada[f] = true;
+        proxima[f] = 0;
+    }
+    liberada[FAIXA(NORTE, 0)] = false;
+    proxima[FAIXA(NORTE, 0)] = 10;
+    liberada[FAIXA(SUL, 1)] = false;
+    proxima[FAIXA(SUL, 1)] = 12;
+
+    // Só a faixa vencida é liberada; o prazo é a próxima liberação
+    controle_liberar_faixas(liberada, proxima, 10, 30, &prazo, admitir_teste, &a);
+    VERIFICAR(liberada[FAIXA(NORTE, 0)] && a.admitidas[FAIXA(NORTE, 0)] == 1);
+    VERIFICAR(!liberada[FAIXA(SUL, 1)] && a.admitidas[FAIXA(SUL, 1)] == 0);
+    VERIFICAR(prazo == 12);
+
+    // Sem faixas bloqueadas o prazo é o fim do verde
+    controle_liberar_faixas(liberada, proxima, 12, 30, &prazo, admitir_teste, &a);
+    VERIFICAR(a.admitidas[FAIXA(SUL, 1)] == 1 && prazo == 30);
+
+    // Um carro que entra ao ser admitido bloqueia a faixa e antecipa o prazo
+    a.bloquear = true;
+    a.faixa_liberada = liberada;
+    a.proxima_entrada = proxima;
+    a.prazo_admissao = &prazo;
+    a.nova_entrada = 14;
+    liberada[FAIXA(LESTE, 0)] = false;
+    proxima[FAIXA(LESTE, 0)] = 13;
+    controle_liberar_faixas(liberada, proxima, 13, 30, &prazo, admitir_teste, &a);
+    VERIFICAR(!liberada[FAIXA(LESTE, 0)] && prazo == 14);
+}
+
+/**
+ * @brief Conduz uma instância por 'duracao' segundos com chegadas de Poisson e mais 'duracao' segundos sem chegadas, para esvaziá-la
+ *
+ */
+Motor *conduzir(const ConfigMotor *config, uint64_t semente, double duracao, EstatisticasMotor *e){
+    ProcessoChegada carros, ambulancias;
+    Chegada lote[1024];
+    Demanda *d = demanda_criar(semente);
+    Motor *m = motor_criar(config);
+    Direcao dir;
+    double t;
+    int n;
+
+    memset(&carros, 0, sizeof(carros));
+    carros.tipo = PROCESSO_POISSON;
+    carros.taxa = 400;
+    ambulancias = carros;
+    ambulancias.taxa = 4;
+    for(dir = NORTE; dir < NUM_DIRECOES; dir++){
+        demanda_fluxo(d, dir, TIPO_CARRO, &carros);
+        demanda_fluxo(d, dir, TIPO_AMBULANCIA, &ambulancias);
+    }
+    for(t = 60; t <= duracao; t += 60){
+        n = demanda_gerar(d, t, lote, 1024);
+        VERIFICAR(motor_chegadas(m, lote, n) == 0);
+        VERIFICAR(motor_avancar(m, t) >= 0);
+    }
+    VERIFICAR(motor_avancar(m, 2 * duracao) >= 0);
+    motor_estatisticas(m, e);
+    demanda_destruir(d);
+    return m;
+}
+
+void testar_motor(void){
+    ConfigMotor config;
+    EstatisticasMotor a, b;
+    Motor *m;
+    int politica, faixas, tipo, dir, i, jusante_cheia;
+    const int jusante[NUM_DIRECOES] = {10, 10, 0, 0};
+
+    for(politica = POLITICA_DEMANDA; politica <= POLITICA_PRESSAO; politica++){
+        for(faixas = 1; faixas <= 2; faixas++){
+            motor_config_padrao(&config);
+            config.politica = (PoliticaControle) politica;
+            for(dir = NORTE; dir < NUM_DIRECOES; dir++) config.faixas[dir] = faixas;
+
+            // Todo veículo injetado atravessa, e a mesma sequência de chamadas dá o mesmo resultado
+            motor_destruir(conduzir(&config, 7, 3600, &a));
+            motor_destruir(conduzir(&config, 7, 3600, &b));
+            for(tipo = TIPO_CARRO; tipo < NUM_TIPOS; tipo++){
+                for(dir = NORTE; dir < NUM_DIRECOES; dir++){
+                    VERIFICAR(a.chegadas[tipo][dir] > 0 && a.chegadas[tipo][dir] == a.travessias[tipo][dir]);
+                    VERIFICAR(a.travessias[tipo][dir] == b.travessias[tipo][dir]);
+                }
+                VERIFICAR(a.espera_soma[tipo] == b.espera_soma[tipo] && a.espera_pior[tipo] == b.espera_pior[tipo]);
+            }
+            VERIFICAR(a.eventos == b.eventos && a.verdes == b.verdes && a.emergencias > 0);
+            VERIFICAR(a.carros_no_cruzamento == 0 && a.ambulancias_no_cruzamento == 0);
+        }
+    }
+
+    // Chamadas inválidas
+    m = motor_criar(NULL);
+    errno = 0;
+    VERIFICAR(motor_chegada(m, NUM_DIRECOES, TIPO_CARRO, 1) == -1 && errno == EINVAL);
+    VERIFICAR(motor_avancar(m, 10) >= 0);
+    errno = 0;
+    VERIFICAR(motor_chegada(m, NORTE, TIPO_CARRO, 5) == -1 && errno == EINVAL);
+    errno = 0;
+    VERIFICAR(motor_avancar(m, 5) == -1 && errno == EINVAL);
+    VERIFICAR(motor_agora(m) == 10);
+    motor_destruir(m);
+
+    motor_config_padrao(&config);
+    config.faixas[NORTE] = MAX_FAIXAS + 1;
+    errno = 0;
+    VERIFICAR(motor_criar(&config) == NULL && errno == EINVAL);
+
+    // Jusante: com mais carros no Norte-Sul a pressão abre esse eixo, a menos que a jusante dele esteja mais cheia que a montante
+    motor_config_padrao(&config);
+    config.politica = POLITICA_PRESSAO;
+    for(jusante_cheia = 0; jusante_cheia <= 1; jusante_cheia++){
+        m = motor_criar(&config);
+        for(dir = NORTE; dir < NUM_DIRECOES; dir++){
+            for(i = 0; i < (controle_eixo(dir) == FLUXO_NS ? 6 : 4); i++) VERIFICAR(motor_chegada(m, dir, TIPO_CARRO, 0) == 0);
+        }
+        if(jusante_cheia) VERIFICAR(motor_jusante(m, jusante) == 0);
+        VERIFICAR(motor_avancar(m, TEMPO_PAUSA) >= 0);
+        motor_estatisticas(m, &a);
+        VERIFICAR(a.estado_atual == (jusante_cheia ? FLUXO_LO : FLUXO_NS));
+        motor_destruir(m);
+    }
+    m = motor_criar(&config);
+    errno = 0;
+    VERIFICAR(motor_jusante(m, (const int[NUM_DIRECOES]){0, -1, 0, 0}) == -1 && errno == EINVAL);
+    VERIFICAR(motor_jusante(m, NULL) == 0);
+    motor_destruir(m);
+}
+
+int main(void){
+    testar_passagem();
+    testar_faixas();
+    testar_espera();
+    testar_verde();
+    testar_ambulancias();
+    testar_liberacao();
+    testar_motor();
+
+    printf("RESUMO verificacoes=%d falhas=%d\n", verificacoes, falhas);
+    return falhas > 0;
+}